@@ -54,6 +54,16 @@ enum
     INTERP_SPLINE        = 11
 };
 
+// Что делает муксер VideoWriter, когда буфер интерливинга заполнен (см. setInterleaving()).
+enum
+{
+    // Старые пакеты записываются, не дожидаясь отстающих потоков (нарушение порядка между потоками).
+    INTERLEAVE_FLUSH    = 1,
+    // Кодирование опережающих потоков со своим потоком кодирования (maxFramesInFlight > 0) ждет
+    // отстающие, пока опережение меньше maxDelay, затем INTERLEAVE_FLUSH. Синхронные потоки - INTERLEAVE_FLUSH.
+    INTERLEAVE_THROTTLE = 2
+};
+
 }
 
 #include <VideoIO/Errors.h>
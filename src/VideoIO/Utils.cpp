@@ -22,11 +22,10 @@ VIDEO_IO_API char const *pixelFormat(int elemType)
     if (elemType == CV_16UC3)
         return av_get_pix_fmt_name(AV_PIX_FMT_BGR48);
 
-    // MENKIN FIX
-    //if (elemType == CV_8UC4)
-        return av_get_pix_fmt_name(AV_PIX_FMT_YUV420P);
+    if (elemType == CV_8UC4)
+        return av_get_pix_fmt_name(AV_PIX_FMT_BGRA);
 
-    //return "";
+    return "";
 }
 
 VIDEO_IO_API double getTime()
@@ -89,7 +88,7 @@ int interpToSWSFlag(int interp)
 
 AVFrame *convertImage(AVFrame *src, AVFrame **dst, AVPixelFormat dstPixFmt, int dstWidth,
                       int dstHeight, unsigned char **dstBuf, std::ptrdiff_t *dstBufSize,
-                      int flags)
+                      int flags, SwsContext **convertCtx)
 {
     assert(src);
     assert(dst);
@@ -132,16 +131,20 @@ AVFrame *convertImage(AVFrame *src, AVFrame **dst, AVPixelFormat dstPixFmt, int
     avpicture_fill(reinterpret_cast<AVPicture *>(*dst), *dstBuf, dstPixFmt, dstWidth, dstHeight);
 
 
-    SwsContext  *convertCtx = sws_getCachedContext(0, src->width, src->height, srcPixFmt,
-                                                  dstWidth, dstHeight, dstPixFmt, flags, 0, 0, 0);
+    SwsContext  *ctx = sws_getCachedContext(convertCtx ? *convertCtx : 0, src->width, src->height,
+                                            srcPixFmt, dstWidth, dstHeight, dstPixFmt, flags, 0, 0, 0);
 
-    if (!convertCtx)
+    if (convertCtx)
+        *convertCtx = ctx; // Старый контекст освобожден sws_getCachedContext(), если был заменен.
+
+    if (!ctx)
         throw Error(ERR_CONVERT_IMAGE, "failed to initialize the image conversion context");
 
-    int err = sws_scale(convertCtx, src->data, src->linesize, 0, src->height,
+    int err = sws_scale(ctx, src->data, src->linesize, 0, src->height,
                         (*dst)->data, (*dst)->linesize);
 
-    sws_freeContext(convertCtx);
+    if (!convertCtx)
+        sws_freeContext(ctx);
     if (err < 0)
         throw Error(ERR_CONVERT_IMAGE, "image conversion failed");
 
@@ -8,6 +8,7 @@ extern "C" {
 #   include <libavcodec/avcodec.h>
 #   include <libavformat/avformat.h>
 #   include <libavutil/avutil.h>
+#   include <libavutil/imgutils.h>
 #   include <libavutil/opt.h>
 #   include <libavutil/pixdesc.h>
 #   include <libswscale/swscale.h>
@@ -21,9 +22,12 @@ int elemType(AVPixelFormat pixFmt);
 int interpToSWSFlag(int interp);
 
 // flags - флаги sws_getCachedContext().
+// convertCtx - контекст преобразования, сохраняемый между вызовами (пересоздается только при
+// изменении размеров, форматов или флагов, освобождается sws_freeContext()). convertCtx = 0 -
+// контекст создается и освобождается при каждом вызове.
 AVFrame *convertImage(AVFrame *src, AVFrame **dst, AVPixelFormat dstPixFmt, int dstWidth,
                       int dstHeight, unsigned char **dstBuf, std::ptrdiff_t *dstBufSize,
-                      int flags);
+                      int flags, SwsContext **convertCtx = 0);
 
 }
 
@@ -64,13 +64,24 @@ public:
         _frameNumbers.assign(_nbStreams, 0);
         _timestamps.assign(_nbStreams, 0.0);
 
+        int nbFileVideoStreams = 0;
+
+        for (int i = 0; i < _nbStreams; ++i)
+        {
+            if (codecContext(i)->codec_type == AVMEDIA_TYPE_VIDEO)
+                nbFileVideoStreams++;
+        }
+
+        if (nbThreads < 0)
+            nbThreads = std::max(1, cv::getNumberOfCPUs() / std::max(1, nbFileVideoStreams));
+
         for (int i = 0; i < _nbStreams; ++i)
         {
             AVCodecContext *codecCtx = codecContext(i);
 
             if (codecCtx->codec_type == AVMEDIA_TYPE_VIDEO)
             {
-                codecCtx->thread_count = nbThreads < 0 ? cv::getNumberOfCPUs() + 1 : nbThreads;
+                codecCtx->thread_count = nbThreads;
 
                 AVCodec *codec = avcodec_find_decoder(codecCtx->codec_id);
 
@@ -38,7 +38,8 @@ public:
 
     ~VideoReader();
 
-    // При nbThreads <= 0 число потоков выбирается автоматически.
+    // nbThreads - число потоков декодера каждого видеопотока. При nbThreads < 0 ядра делятся
+    // между видеопотоками файла, чтобы декодеры нескольких потоков не вытесняли друг друга.
     void open(std::string const &fileName, int nbThreads = -1);
 
     // Возвращает !metadata.empty().
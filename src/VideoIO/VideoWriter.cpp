@@ -1,10 +1,16 @@
 #include <VideoIO/VideoWriter.h>
 #include <VideoIO/UtilsInternal.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
 #include <limits>
+#include <mutex>
+#include <thread>
 #include <vector>
-// DEBUG
-#include <iostream>
 
 namespace video_io
 {
@@ -19,7 +25,11 @@ VideoWriter::VideoStreamParams::VideoStreamParams():
     bitRate(-1),
     bitRateTolerance(-1),
     gopSize(-1),
-    maxBFrames(-1)
+    maxBFrames(-1),
+    nbThreads(-1),
+    maxFramesInFlight(0),
+    interp(INTERP_LANCZOS),
+    accurateRounding(true)
 {
 }
 
@@ -31,12 +41,90 @@ public:
     typedef VideoWriter::Error Error;
     typedef VideoWriter::VideoStreamParams VideoStreamParams;
 
+    // Дополнительный вывод закодированных пакетов со своим муксером.
+    struct Output
+    {
+        AVFormatContext *formatContext;
+        std::string url;
+        std::string formatName;
+        // Индекс потока в выводе для каждого потока файла, -1 - поток не выводится.
+        std::vector<int> streamIndexes;
+        bool live;
+        // Счетчики и failed меняются потоком муксера.
+        std::atomic<bool> failed;
+        bool headerWritten;
+        std::atomic<long long> packetNumber;
+        std::atomic<long long> errorNumber;
+        // Вывод в память (url пустой).
+        std::vector<unsigned char> data;
+        std::mutex dataMutex;
+    };
+
+    // Кодирование потока: исходные кадры, принятые write(), кодируются в своем потоке
+    // (maxFramesInFlight > 0) или в потоке вызова write(). Пакеты передаются потоку муксера.
+    // Состояние одного потока не разделяется с другими: write() и skip() разных потоков можно
+    // вызывать одновременно.
+    struct Encoder
+    {
+        // Меняются только write() и skip() этого потока.
+        long long inputFrameNumber;
+        long long skippedFrameNumber;
+        int64_t timestamp;
+        // Метка времени (s) первого кадра.
+        double startTime;
+
+        int maxFramesInFlight;
+        // Формат пикселя изображений write(), AV_PIX_FMT_NONE - по типу изображения.
+        AVPixelFormat inputPixFmt;
+        std::atomic<int> interp;
+        bool accurateRounding;
+        // Преобразование формата пикселя, сохраняется между кадрами.
+        SwsContext *convertCtx;
+        AVFrame *dstFrame;
+        unsigned char *dstFrameBuf;
+        std::ptrdiff_t dstFrameBufSize;
+        // Кадры, ожидающие кодирования (первый кодируется), и свободные кадры.
+        std::deque<AVFrame *> frames;
+        std::vector<AVFrame *> freeFrames;
+        std::atomic<long long> outputFrameNumber;
+        // Время кодирования (us) и число кадров, переданных кодеку, меняются при кодировании.
+        std::atomic<long long> encodeTimeUs;
+        std::atomic<long long> encodedFrameNumber;
+        bool stopping;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::thread thread;
+    };
+
+    // Пакеты потока, ожидающие интерливинга, в порядке dts.
+    struct Interleave
+    {
+        std::deque<AVPacket *> packets;
+        long long bytes;
+        // Пакеты, записанные потоком муксера, и время записи последнего.
+        long long sentNumber;
+        std::chrono::steady_clock::time_point sentTime;
+    };
+
+    static const int OUTPUT_BUFFER_SIZE = 65536;
+    // Как max_interleave_delta муксера ffmpeg по умолчанию.
+    static const int DEFAULT_INTERLEAVE_DELAY_MS = 10000;
+    static const long long DEFAULT_INTERLEAVE_BYTES = 64LL * 1024 * 1024;
+
     VideoWriterImpl():
         _nbThreads(-1),
         _formatContext(0),
-        _dstFrame(0),
-        _dstFrameBuf(0),
-        _dstFrameBufSize(0),
+        _headerWritten(false),
+        _bytesWritten(0),
+        _interleaveBytes(0),
+        _interleaveFlushedNumber(0),
+        _interleaveForced(false),
+        _maxInterleaveDelay(DEFAULT_INTERLEAVE_DELAY_MS / 1000.0),
+        _maxInterleaveBytes(DEFAULT_INTERLEAVE_BYTES),
+        _interleavePolicy(INTERLEAVE_FLUSH),
+        _muxStopping(false),
+        _startTime(0),
         _failed(false)
     {
     }
@@ -51,6 +139,8 @@ public:
         catch(...)
         {
         }
+
+        deleteOutputs();
     }
 
     void open(std::string const &fileName, int nbThreads)
@@ -59,6 +149,7 @@ public:
         {
             FFMpeg::init();
             close();
+            deleteOutputs();
 
             int err = avformat_alloc_output_context2(&_formatContext, 0, 0, fileName.c_str());
             if (err == AVERROR(ENOMEM))
@@ -109,7 +200,7 @@ public:
     int addVideoStream(VideoStreamParams const &params)
     {
         assert(_formatContext);
-        assert(_srcFrames.empty()); // Header еще не записан?
+        assert(!_headerWritten);
 
         int streamId;
 
@@ -127,6 +218,9 @@ public:
             if (params.aspectRatio > 10)
                 throw Error(ERR_BAD_PARAM, "invalid aspect ratio");
 
+            if (!interpToSWSFlag(params.interp))
+                throw Error(ERR_BAD_PARAM, "invalid interpolation type");
+
             // Поиск кодека.
 
             AVCodecID codecId = AV_CODEC_ID_NONE;
@@ -167,10 +261,23 @@ public:
 
             // Выбор формата пикселя.
 
+            AVPixelFormat inputPixFmt = AV_PIX_FMT_NONE;
+
+            if (!params.inputPixelFormat.empty())
+            {
+                inputPixFmt = av_get_pix_fmt(params.inputPixelFormat.c_str());
+
+                if (inputPixFmt == AV_PIX_FMT_NONE)
+                    throw Error(ERR_FIND_PIX_FMT,
+                                "invalid input pixel format \"" + params.inputPixelFormat + "\"");
+            }
+
             AVPixelFormat userPixFmt = AV_PIX_FMT_NONE;
 
             if (!params.pixelFormat.empty())
                 userPixFmt = av_get_pix_fmt(params.pixelFormat.c_str());
+            else
+                userPixFmt = inputPixFmt;
 
             if (userPixFmt == AV_PIX_FMT_NONE)
                 throw Error(ERR_FIND_PIX_FMT,
@@ -180,7 +287,7 @@ public:
 
             if (codec->pix_fmts) // Список поддерживаемых форматов пикселей не пуст?
             {
-                if (params.findBestPixelFormat)
+                if (params.findBestPixelFormat || params.pixelFormat.empty())
                 {
                     AVPixelFormat *pixFmts = const_cast<AVPixelFormat *>(codec->pix_fmts);
                     pixFmt = avcodec_find_best_pix_fmt_of_list(pixFmts, userPixFmt,
@@ -229,7 +336,10 @@ public:
             if (!qFrameRate.num)
                 qFrameRate.num = 1;
 
-            codecCtx->thread_count = _nbThreads < 0 ? cv::getNumberOfCPUs() + 1 : _nbThreads;
+            if (params.nbThreads > 0)
+                codecCtx->thread_count = params.nbThreads;
+            else
+                codecCtx->thread_count = _nbThreads < 0 ? cv::getNumberOfCPUs() + 1 : _nbThreads;
             codecCtx->codec_id = codecId;
             codecCtx->time_base = av_inv_q(qFrameRate);
             codecCtx->pix_fmt = pixFmt;
@@ -277,6 +387,25 @@ public:
                 throw std::bad_alloc();
             if (err < 0)
                 throw Error(ERR_OPEN_CODEC, "failed to open encoder");
+
+            Encoder *encoder = new Encoder();
+            encoder->inputFrameNumber = 0;
+            encoder->skippedFrameNumber = 0;
+            encoder->timestamp = 0;
+            encoder->startTime = _startTime;
+            encoder->maxFramesInFlight = std::max(params.maxFramesInFlight, 0);
+            encoder->inputPixFmt = inputPixFmt;
+            encoder->interp = params.interp;
+            encoder->accurateRounding = params.accurateRounding;
+            encoder->convertCtx = 0;
+            encoder->dstFrame = 0;
+            encoder->dstFrameBuf = 0;
+            encoder->dstFrameBufSize = 0;
+            encoder->outputFrameNumber = 0;
+            encoder->encodeTimeUs = 0;
+            encoder->encodedFrameNumber = 0;
+            encoder->stopping = false;
+            _encoders.push_back(encoder);
         }
         catch (...)
         {
@@ -287,6 +416,96 @@ public:
         return streamId;
     }
 
+    void setStartTime(double startTime)
+    {
+        assert(!_headerWritten);
+
+        _startTime = startTime;
+
+        for (int i = 0; i < nbStreams(); ++i)
+            _encoders[i]->startTime = startTime;
+    }
+
+    void setStartTime(int id, double startTime)
+    {
+        assert(!_headerWritten);
+        assert(id >= 0);
+        assert(id < nbStreams());
+
+        _encoders[id]->startTime = startTime;
+    }
+
+    void setInterleaving(double maxDelay, long long maxBytes, int policy)
+    {
+        assert(!_headerWritten);
+
+        if (maxDelay < 0)
+            throw Error(ERR_BAD_PARAM, "invalid interleaving delay");
+
+        if (maxBytes <= 0)
+            throw Error(ERR_BAD_PARAM, "invalid interleaving buffer size");
+
+        if (policy != INTERLEAVE_FLUSH && policy != INTERLEAVE_THROTTLE)
+            throw Error(ERR_BAD_PARAM, "invalid interleaving policy");
+
+        _maxInterleaveDelay = maxDelay;
+        _maxInterleaveBytes = maxBytes;
+        _interleavePolicy = policy;
+    }
+
+    long long interleavedBytes(int id)
+    {
+        assert(id >= 0);
+        assert(id < nbStreams());
+
+        std::lock_guard<std::mutex> lock(_muxMutex);
+        return _interleaves.empty() ? 0 : _interleaves[id].bytes;
+    }
+
+    long long interleavedPacketNumber(int id)
+    {
+        assert(id >= 0);
+        assert(id < nbStreams());
+
+        std::lock_guard<std::mutex> lock(_muxMutex);
+        return _interleaves.empty() ? 0 : static_cast<long long>(_interleaves[id].packets.size());
+    }
+
+    long long interleaveFlushedPacketNumber()
+    {
+        std::lock_guard<std::mutex> lock(_muxMutex);
+        return _interleaveFlushedNumber;
+    }
+
+    double encodeTime(int id) const
+    {
+        assert(id >= 0);
+        assert(id < nbStreams());
+
+        return _encoders[id]->encodeTimeUs / 1e6;
+    }
+
+    long long encodedFrameNumber(int id) const
+    {
+        assert(id >= 0);
+        assert(id < nbStreams());
+
+        return _encoders[id]->encodedFrameNumber;
+    }
+
+    long long sentPacketNumber(int id, std::chrono::steady_clock::time_point &lastSentTime)
+    {
+        assert(id >= 0);
+        assert(id < nbStreams());
+
+        std::lock_guard<std::mutex> lock(_muxMutex);
+        if (_interleaves.empty())
+            return 0;
+
+        lastSentTime = _interleaves[id].sentTime;
+        return _interleaves[id].sentNumber;
+    }
+
     int nbStreams() const
     {
         assert(_formatContext);
@@ -353,7 +572,7 @@ public:
 
     int bitRate(int id) const
     {
-        return codecContext(id)->bit_rate;
+        return static_cast<int>(codecContext(id)->bit_rate);
     }
 
     int bitRateTolerance(int id) const
@@ -371,137 +590,248 @@ public:
         return codecContext(id)->max_b_frames;
     }
 
-    void write(cv::Mat &image, int id)
+    void setInterp(int id, int interp)
     {
-        try
-        {
-            AVCodecContext *codecCtx = codecContext(id);
-            int width = codecCtx->width;
-            int height = codecCtx->height;
+        assert(id >= 0);
+        assert(id < nbStreams());
 
-            if (width != image.size().width || height != image.size().height)
-                throw Error(ERR_IMAGE_SIZE, "inconsistent image size");
+        if (!interpToSWSFlag(interp))
+            throw Error(ERR_BAD_PARAM, "invalid interpolation type");
 
-            AVPixelFormat srcPixFmt = av_get_pix_fmt(video_io::pixelFormat(image.type()));
-            AVPixelFormat dstPixFmt = codecCtx->pix_fmt;
+        _encoders[id]->interp = interp;
+    }
 
-            if (srcPixFmt == AV_PIX_FMT_NONE)
-                throw Error(ERR_IMAGE_TYPE, "unsupported image type");
+    int interp(int id) const
+    {
+        assert(id >= 0);
+        assert(id < nbStreams());
 
-            if (_srcFrames.empty()) // Header еще не записан?
-            {
-                // Write the stream header, if any.
-                int err = avformat_write_header(_formatContext, 0);
-                if (err == AVERROR(ENOMEM))
-                    throw std::bad_alloc();
-                if (err < 0)
-                    throw Error(ERR_WRITE_HEADER, "failed to write video file header");
+        return _encoders[id]->interp;
+    }
 
-                _srcFrames.assign(nbStreams(), static_cast<AVFrame *>(0));
-            }
+    bool accurateRounding(int id) const
+    {
+        assert(id >= 0);
+        assert(id < nbStreams());
 
-            if (!_srcFrames[id])
-                if (!(_srcFrames[id] = av_frame_alloc()))
-                    throw std::bad_alloc();
+        return _encoders[id]->accurateRounding;
+    }
 
-            if (!_srcFrames[id]->data[0])
-            {
-                if (avpicture_alloc(reinterpret_cast<AVPicture *>(_srcFrames[id]), srcPixFmt,
-                                    width, height) < 0)
-                    throw std::bad_alloc();
+    int maxFramesInFlight(int id) const
+    {
+        assert(id >= 0);
+        assert(id < nbStreams());
 
-                _srcFrames[id]->format = srcPixFmt;
-                _srcFrames[id]->width = width;
-                _srcFrames[id]->height = height;
-            }
+        return _encoders[id]->maxFramesInFlight;
+    }
 
-            AVFrame *srcFrame = _srcFrames[id];
+    int addOutput(std::string const &url, std::string const &formatName, std::vector<int> const &ids, bool live)
+    {
+        assert(_formatContext);
+        assert(!_headerWritten);
+
+        for (std::size_t i = 0; i < ids.size(); ++i)
+            if (ids[i] < 0 || ids[i] >= nbStreams())
+                throw Error(ERR_BAD_PARAM, "invalid stream id");
+
+        if (url.empty() && formatName.empty())
+            throw Error(ERR_BAD_PARAM, "format of a memory output is not set");
+
+        if (!formatName.empty() ? !av_guess_format(formatName.c_str(), 0, 0) : !av_guess_format(0, url.c_str(), 0))
+            throw Error(ERR_GUESS_FORMAT, "could not deduce format of the output \"" + url + "\"");
+
+        Output *output = new Output();
+        output->formatContext = 0;
+        output->url = url;
+        output->formatName = formatName;
+        output->streamIndexes.assign(nbStreams(), -1);
+        for (std::size_t i = 0; i < ids.size(); ++i)
+            output->streamIndexes[ids[i]] = 0;
+        if (ids.empty())
+            output->streamIndexes.assign(nbStreams(), 0);
+        output->live = live;
+        output->failed = false;
+        output->headerWritten = false;
+        output->packetNumber = 0;
+        output->errorNumber = 0;
+
+        _outputs.push_back(output);
+        return static_cast<int>(_outputs.size()) - 1;
+    }
 
-            if (image.data != srcFrame->data[0]) // Равны, когда выполняется flush кодеков.
-                image.copyTo(cv::Mat(height, width, image.type(), srcFrame->data[0],
-                             srcFrame->linesize[0]));
+    int nbOutputs() const
+    {
+        return static_cast<int>(_outputs.size());
+    }
 
-            AVFrame *frame = srcFrame;
+    long long outputPacketNumber(int output) const
+    {
+        assert(output >= 0);
+        assert(output < nbOutputs());
 
-            if (dstPixFmt != srcPixFmt)
-            {
-                try
-                {
-                    convertImage(srcFrame, &_dstFrame, dstPixFmt, width, height, &_dstFrameBuf,
-                                 &_dstFrameBufSize, SWS_ACCURATE_RND | SWS_LANCZOS);
-                }
-                catch (video_io::Error &e)
-                {
-                    throw Error(e.code(), e.what());
-                }
+        return _outputs[output]->packetNumber;
+    }
 
-                frame = _dstFrame;
-            }
+    long long outputErrorNumber(int output) const
+    {
+        assert(output >= 0);
+        assert(output < nbOutputs());
 
-            if (_inputFrameNumbers.empty())
-                _inputFrameNumbers.assign(nbStreams(), 0);
+        return _outputs[output]->errorNumber;
+    }
 
-            if (_outputFrameNumbers.empty())
-                _outputFrameNumbers.assign(nbStreams(), 0);
+    bool outputFailed(int output) const
+    {
+        assert(output >= 0);
+        assert(output < nbOutputs());
 
-            if (_timestamps.empty())
-                _timestamps.assign(nbStreams(), 0);
+        return _outputs[output]->failed;
+    }
 
-            frame->pts = _timestamps[id];
-            _inputFrameNumbers[id]++;
-            _timestamps[id] += av_rescale_q(1, codecCtx->time_base, stream(id)->time_base);
+    void takeOutputData(int output, std::vector<unsigned char> &data)
+    {
+        assert(output >= 0);
+        assert(output < nbOutputs());
 
-            AVPacket pkt;
-            int err = 0;
+        std::lock_guard<std::mutex> lock(_outputs[output]->dataMutex);
+        data.clear();
+        data.swap(_outputs[output]->data);
+    }
 
-            av_init_packet(&pkt);
+    long long livePacketNumber() const
+    {
+        long long packetNumber = 0;
+
+        for (std::size_t i = 0; i < _outputs.size(); ++i)
+            if (_outputs[i]->live)
+                packetNumber += _outputs[i]->packetNumber;
+
+        return packetNumber;
+    }
+
+    bool liveStream(int id) const
+    {
+        assert(id >= 0);
+        assert(id < nbStreams());
 
-            if (_formatContext->oformat->flags & AVFMT_RAWPICTURE &&
-                    codecCtx->codec->id == AV_CODEC_ID_RAWVIDEO)
+        for (std::size_t i = 0; i < _outputs.size(); ++i)
+            if (_outputs[i]->live && _outputs[i]->streamIndexes[id] >= 0)
+                return true;
+
+        return false;
+    }
+
+    long long outputErrorNumber() const
+    {
+        long long errorNumber = 0;
+
+        for (std::size_t i = 0; i < _outputs.size(); ++i)
+            errorNumber += _outputs[i]->errorNumber;
+
+        return errorNumber;
+    }
+
+    void write(cv::Mat &image, int id)
+    {
+        // Неподходящее изображение отклоняется без изменения состояния записи.
+        Encoder &encoder = *_encoders[id];
+        AVCodecContext *codecCtx = codecContext(id);
+        int width = codecCtx->width;
+        int height = codecCtx->height;
+
+        AVPixelFormat srcPixFmt = encoder.inputPixFmt;
+
+        if (srcPixFmt == AV_PIX_FMT_NONE)
+        {
+            if (width != image.size().width || height != image.size().height)
+                throw Error(ERR_IMAGE_SIZE, "inconsistent image size");
+
+            srcPixFmt = av_get_pix_fmt(video_io::pixelFormat(image.type()));
+
+            if (srcPixFmt == AV_PIX_FMT_NONE)
+                throw Error(ERR_IMAGE_TYPE, "unsupported image type");
+        }
+
+        // Плоскости изображения: упакованный формат - одна плоскость со строками image,
+        // планарный - все плоскости подряд в непрерывном image.
+
+        uint8_t *srcData[4] = { 0 };
+        int srcLinesizes[4] = { 0 };
+
+        if (av_pix_fmt_count_planes(srcPixFmt) == 1)
+        {
+            if (image.rows != height ||
+                    static_cast<int>(image.cols * image.elemSize()) != av_image_get_linesize(srcPixFmt, width, 0))
+                throw Error(ERR_IMAGE_SIZE, "inconsistent image size");
+
+            srcData[0] = image.data;
+            srcLinesizes[0] = static_cast<int>(image.step[0]);
+        }
+        else
+        {
+            if (!image.isContinuous() ||
+                    static_cast<int>(image.cols * image.elemSize1()) != av_image_get_linesize(srcPixFmt, width, 0) ||
+                    static_cast<int>(image.total() * image.elemSize()) != av_image_get_buffer_size(srcPixFmt, width, height, 1))
+                throw Error(ERR_IMAGE_SIZE, "inconsistent image size");
+
+            if (av_image_fill_arrays(srcData, srcLinesizes, image.data, srcPixFmt, width, height, 1) < 0)
+                throw Error(ERR_IMAGE_TYPE, "unsupported image type");
+        }
+
+        try
+        {
+            writeHeader();
+            rethrowErrors(id);
+
+            AVFrame *frame = takeFrame(encoder, srcPixFmt, width, height);
+
+            av_image_copy(frame->data, frame->linesize, const_cast<uint8_t const **>(srcData),
+                          srcLinesizes, srcPixFmt, width, height);
+
+            frame->pts = encoder.timestamp;
+            encoder.inputFrameNumber++;
+            encoder.timestamp += av_rescale_q(1, codecCtx->time_base, stream(id)->time_base);
+
+            if (encoder.maxFramesInFlight > 0)
             {
-                // Raw pictures are written as AVPicture structure to avoid any copies.
-                pkt.flags |= AV_PKT_FLAG_KEY;
-                pkt.data = reinterpret_cast<uint8_t *>(frame);
-                pkt.size = sizeof(AVPicture);
-                pkt.stream_index = stream(id)->index;
-                err = av_interleaved_write_frame(_formatContext, &pkt);
-                _outputFrameNumbers[id]++;
+                // Кадр кодируется потоком кодирования, write() не ждет пакета.
+                std::lock_guard<std::mutex> lock(encoder.mutex);
+                encoder.frames.push_back(frame);
+                encoder.condition.notify_all();
             }
             else
             {
-                int gotPacket;
-
-                pkt.data = 0;
-                pkt.size = 0;
-                err = avcodec_encode_video2(codecCtx, &pkt, frame, &gotPacket);
-
-                if (err < 0)
+                try
                 {
-                    av_free_packet(&pkt);
-
-                    if (err == AVERROR(ENOMEM))
-                        throw std::bad_alloc();
-
-                    throw Error(ERR_ENC_DEC_VIDEO, "failed to encode video frame packet");
+                    encode(id, frame);
                 }
-
-                if (gotPacket)
+                catch (...)
                 {
-                    if (codecCtx->coded_frame->key_frame)
-                        pkt.flags |= AV_PKT_FLAG_KEY;
-
-                    pkt.stream_index = stream(id)->index;
-                    err = av_interleaved_write_frame(_formatContext, &pkt);
-                    _outputFrameNumbers[id]++;
+                    releaseFrame(encoder, frame);
+                    throw;
                 }
 
-                av_free_packet(&pkt);
+                releaseFrame(encoder, frame);
             }
+        }
+        catch (...)
+        {
+            _failed = true;
+            throw;
+        }
+    }
 
-            if (err == AVERROR(ENOMEM))
-                throw std::bad_alloc();
-            if (err < 0)
-                throw Error(ERR_RW_FRAME, "failed to write frame");
+    void skip(int id)
+    {
+        try
+        {
+            // Метки времени измеряются в time_base потока, который муксер задает при записи header.
+            writeHeader();
+
+            Encoder &encoder = *_encoders[id];
+
+            encoder.skippedFrameNumber++;
+            encoder.timestamp += av_rescale_q(1, codecContext(id)->time_base, stream(id)->time_base);
         }
         catch (...)
         {
@@ -515,7 +845,15 @@ public:
         assert(id >= 0);
         assert(id < nbStreams());
 
-        return _inputFrameNumbers[id];
+        return _encoders[id]->inputFrameNumber;
+    }
+
+    long long skippedFrameNumber(int id) const
+    {
+        assert(id >= 0);
+        assert(id < nbStreams());
+
+        return _encoders[id]->skippedFrameNumber;
     }
 
     double timestamp(int id) const
@@ -523,7 +861,16 @@ public:
         assert(id >= 0);
         assert(id < nbStreams());
 
-        return _timestamps[id] * av_q2d(stream(id)->time_base);
+        return !_headerWritten ? _encoders[id]->startTime : _encoders[id]->timestamp * av_q2d(stream(id)->time_base);
+    }
+
+    // Размер после последнего пакета, записанного потоком муксера.
+    long long bytesWritten() const
+    {
+        if (!_formatContext || !_formatContext->pb)
+            return 0;
+
+        return _bytesWritten;
     }
 
     void close()
@@ -556,124 +903,817 @@ private:
         return stream(id)->codec;
     }
 
-    void flushEncoders()
+    // Первый write() или skip() любого потока.
+    void writeHeader()
     {
-        try
-        {
-            if (!_formatContext || _failed || _srcFrames.empty())
-                return;
+        if (_headerWritten)
+            return;
 
-            assert(_srcFrames.size() == nbStreams());
-            assert(_inputFrameNumbers.size() == _srcFrames.size());
-            assert(_outputFrameNumbers.size() == _srcFrames.size());
+        std::lock_guard<std::mutex> lock(_headerMutex);
 
-            std::vector<long long> targetFrameNumbers(_inputFrameNumbers);
+        if (_headerWritten)
+            return;
 
-            while (true)
-            {
-                int i = 0;
+        // Write the stream header, if any.
+        int err = avformat_write_header(_formatContext, 0);
+        if (err == AVERROR(ENOMEM))
+            throw std::bad_alloc();
+        if (err < 0)
+            throw Error(ERR_WRITE_HEADER, "failed to write video file header");
 
-                for (; i < nbStreams(); ++i)
-                    if (_outputFrameNumbers[i] < targetFrameNumbers[i])
-                    {
-                        cv::Mat image(codecContext(i)->height, codecContext(i)->width,
-                                      elemType(static_cast<AVPixelFormat>(_srcFrames[i]->format)),
-                                      _srcFrames[i]->data[0], _srcFrames[i]->linesize[0]);
+        for (int i = 0; i < nbStreams(); ++i)
+            _encoders[i]->timestamp = static_cast<int64_t>(_encoders[i]->startTime / av_q2d(stream(i)->time_base) + 0.5);
 
-                        write(image, i);
-                        break;
-                    }
+        for (std::size_t i = 0; i < _outputs.size(); ++i)
+            openOutput(*_outputs[i]);
 
-                if (i == nbStreams())
-                    break;
+        if (_formatContext->pb)
+            _bytesWritten = avio_tell(_formatContext->pb);
+
+        Interleave interleave;
+        interleave.bytes = 0;
+        interleave.sentNumber = 0;
+        _interleaves.assign(nbStreams(), interleave);
+        _interleaveBytes = 0;
+        _interleaveFlushedNumber = 0;
+        _interleaveForced = false;
+        _muxStopping = false;
+        _muxThread = std::thread(&VideoWriterImpl::muxThread, this);
+
+        for (int i = 0; i < nbStreams(); ++i)
+            if (_encoders[i]->maxFramesInFlight > 0)
+            {
+                _encoders[i]->stopping = false;
+                _encoders[i]->thread = std::thread(&VideoWriterImpl::encoderThread, this, i);
             }
 
-            // !_srcFrames.empty(), следовательно, заголовок записан. Write the trailer, if any.
-            // The trailer must be written before you close the CodecContexts open when you
-            // wrote the header; otherwise av_write_trailer() may try to use memory that was
-            // freed on av_codec_close().
+        _headerWritten = true;
+    }
 
-            int err = av_write_trailer(_formatContext);
+    static AVFrame *allocFrame(AVPixelFormat pixFmt, int width, int height)
+    {
+        AVFrame *frame = av_frame_alloc();
+        if (!frame)
+            throw std::bad_alloc();
 
-            if (err == AVERROR(ENOMEM))
-                throw std::bad_alloc();
-            if (err < 0)
-                throw Error(ERR_WRITE_TRAILER, "failed to write video file trailer");
-        }
-        catch (...)
+        if (avpicture_alloc(reinterpret_cast<AVPicture *>(frame), pixFmt, width, height) < 0)
         {
-            _failed = true;
-            throw;
+            av_frame_free(&frame);
+            throw std::bad_alloc();
         }
+
+        frame->format = pixFmt;
+        frame->width = width;
+        frame->height = height;
+
+        return frame;
     }
 
-    void clear()
+    static void freeFrame(AVFrame *frame)
     {
-        if (!_formatContext)
+        if (!frame)
             return;
 
-      /*  if (err == AVERROR(ENOMEM))
-            throw std::bad_alloc();
-        if (err < 0)
-            throw Error(ERR_SET_METADATA, "failed to set metadata");*/
+        if (frame->data[0])
+            av_free(frame->data[0]);
+        av_frame_free(&frame);
+    }
 
+    // Свободный исходный кадр потока. Ждет, пока в очереди кодирования maxFramesInFlight кадров.
+    AVFrame *takeFrame(Encoder &encoder, AVPixelFormat pixFmt, int width, int height)
+    {
+        AVFrame *frame = 0;
 
-        av_dict_free(&_formatContext->metadata);
+        {
+            std::unique_lock<std::mutex> lock(encoder.mutex);
 
-        for (int i = 0; i < nbStreams(); ++i)
-            avcodec_close(codecContext(i));
+            if (encoder.maxFramesInFlight > 0)
+                encoder.condition.wait(lock, [&encoder]()
+                {
+                    return static_cast<int>(encoder.frames.size()) < encoder.maxFramesInFlight;
+                });
 
-        if (_formatContext->oformat && !(_formatContext->oformat->flags & AVFMT_NOFILE))
-            if (_formatContext->pb)
+            if (!encoder.freeFrames.empty())
             {
-                avio_close(_formatContext->pb);
-                _formatContext->pb = 0;
+                frame = encoder.freeFrames.back();
+                encoder.freeFrames.pop_back();
             }
+        }
 
-        avformat_free_context(_formatContext);
-        _formatContext = 0;
+        if (frame && frame->format != pixFmt)
+        {
+            freeFrame(frame);
+            frame = 0;
+        }
 
-        for (int i = 0; i < _srcFrames.size(); ++i)
-            if (_srcFrames[i])
-            {
-                if (_srcFrames[i]->data[0])
-                    av_free(_srcFrames[i]->data[0]);
-                av_frame_free(&_srcFrames[i]);
-            }
+        return frame ? frame : allocFrame(pixFmt, width, height);
+    }
+
+    void releaseFrame(Encoder &encoder, AVFrame *frame)
+    {
+        std::lock_guard<std::mutex> lock(encoder.mutex);
+
+        encoder.freeFrames.push_back(frame);
+    }
+
+    // Время кодирования считается без ожидания очереди кадров и муксера.
+    static void addEncodeTime(Encoder &encoder, std::chrono::steady_clock::time_point start)
+    {
+        encoder.encodeTimeUs += std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Кодирует исходный кадр потока id (pts задан) и передает готовые пакеты муксеру.
+    void encode(int id, AVFrame *srcFrame)
+    {
+        Encoder &encoder = *_encoders[id];
+        AVCodecContext *codecCtx = codecContext(id);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        AVFrame *frame = srcFrame;
+
+        if (codecCtx->pix_fmt != srcFrame->format)
+        {
+            try
+            {
+                int flags = interpToSWSFlag(encoder.interp);
+                if (encoder.accurateRounding)
+                    flags |= SWS_ACCURATE_RND;
+
+                frame = convertImage(srcFrame, &encoder.dstFrame, codecCtx->pix_fmt, codecCtx->width,
+                                     codecCtx->height, &encoder.dstFrameBuf, &encoder.dstFrameBufSize,
+                                     flags, &encoder.convertCtx);
+            }
+            catch (video_io::Error &e)
+            {
+                throw Error(e.code(), e.what());
+            }
+
+            frame->pts = srcFrame->pts;
+        }
+
+        // Кадр копируется кодеком, если нужен ему после возврата (B-кадры, frame threading).
+        int err = avcodec_send_frame(codecCtx, frame);
+
+        if (err == AVERROR(ENOMEM))
+            throw std::bad_alloc();
+        if (err < 0)
+            throw Error(ERR_ENC_DEC_VIDEO, "failed to encode video frame");
+
+        addEncodeTime(encoder, start);
+        encoder.encodedFrameNumber++;
+        receivePackets(id);
+    }
+
+    void receivePackets(int id)
+    {
+        AVCodecContext *codecCtx = codecContext(id);
+
+        while (true)
+        {
+            AVPacket pkt;
+
+            av_init_packet(&pkt);
+            pkt.data = 0;
+            pkt.size = 0;
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            int err = avcodec_receive_packet(codecCtx, &pkt);
+            addEncodeTime(*_encoders[id], start);
+
+            if (err == AVERROR(EAGAIN) || err == AVERROR_EOF)
+                break;
+            if (err == AVERROR(ENOMEM))
+                throw std::bad_alloc();
+            if (err < 0)
+                throw Error(ERR_ENC_DEC_VIDEO, "failed to encode video frame packet");
+
+            pkt.stream_index = stream(id)->index;
+            _encoders[id]->outputFrameNumber++;
+            mux(pkt);
+        }
+    }
+
+    // Поток кодирования: после ошибки кадры освобождаются без кодирования, ошибка генерируется
+    // следующим write() или close().
+    void encoderThread(int id)
+    {
+        Encoder &encoder = *_encoders[id];
+        std::unique_lock<std::mutex> lock(encoder.mutex);
+
+        while (true)
+        {
+            encoder.condition.wait(lock, [&encoder]() { return encoder.stopping || !encoder.frames.empty(); });
+
+            if (encoder.frames.empty())
+                break;
+
+            AVFrame *frame = encoder.frames.front();
+            bool failed = static_cast<bool>(encoder.error);
+            lock.unlock();
+
+            std::exception_ptr error;
+
+            if (!failed)
+            {
+                try
+                {
+                    encode(id, frame);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+            }
+
+            releaseFrame(encoder, frame);
+
+            lock.lock();
+            if (error)
+                encoder.error = error;
+            encoder.frames.pop_front();
+            encoder.condition.notify_all();
+        }
+    }
+
+    static int64_t packetTime(AVPacket const *pkt)
+    {
+        return pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+    }
+
+    bool interleaveFull() const
+    {
+        return _interleaveBytes > _maxInterleaveBytes;
+    }
+
+    // INTERLEAVE_THROTTLE ограничивает только потоки со своим потоком кодирования: поток вызова
+    // write() синхронного потока может быть и единственным писателем отстающих потоков.
+    bool throttled(int id) const
+    {
+        return _interleavePolicy == INTERLEAVE_THROTTLE && _encoders[id]->maxFramesInFlight > 0;
+    }
+
+    // Опережение (s времени медиа) пакета потока id над самым старым пакетом буфера интерливинга.
+    double interleaveLead(AVPacket const *pkt, int id) const
+    {
+        int64_t time = av_rescale_q(packetTime(pkt), stream(id)->time_base, av_get_time_base_q());
+        int64_t oldest = time;
+
+        for (int i = 0; i < static_cast<int>(_interleaves.size()); ++i)
+        {
+            std::deque<AVPacket *> const &packets = _interleaves[i].packets;
+
+            if (!packets.empty())
+                oldest = std::min(oldest, av_rescale_q(packetTime(packets.front()), stream(i)->time_base,
+                                                       av_get_time_base_q()));
+        }
+
+        return static_cast<double>(time - oldest) / AV_TIME_BASE;
+    }
+
+    // Забирает данные пакета. При заполненном буфере интерливинга ждет, пока поток муксера не
+    // запишет старые пакеты (INTERLEAVE_FLUSH), или, если поток ограничивается (throttled()) и
+    // опережает, пока отстающие потоки не догонят его. Кадры записываются в реальном времени,
+    // поэтому ожидание не дольше остатка maxDelay после опережения пакета: дальше nextPacket() и
+    // так запишет старые пакеты. Затем, как и для синхронных потоков, - INTERLEAVE_FLUSH.
+    void mux(AVPacket &pkt)
+    {
+        AVPacket *muxPkt = av_packet_alloc();
+        if (!muxPkt)
+        {
+            av_packet_unref(&pkt);
+            throw std::bad_alloc();
+        }
+
+        av_packet_move_ref(muxPkt, &pkt);
+
+        int id = muxPkt->stream_index;
+        std::unique_lock<std::mutex> lock(_muxMutex);
+        Interleave &interleave = _interleaves[id];
+
+        if (_interleavePolicy == INTERLEAVE_THROTTLE && !_interleaveForced && interleaveFull() &&
+                !interleave.packets.empty())
+        {
+            bool caughtUp = false;
+            double waitTime = throttled(id) ? _maxInterleaveDelay - interleaveLead(muxPkt, id) : 0;
+
+            if (waitTime > 0)
+                caughtUp = _muxCondition.wait_for(lock, std::chrono::duration<double>(waitTime),
+                                                  [this, &interleave]()
+                {
+                    return !interleaveFull() || interleave.packets.empty();
+                });
+
+            if (!caughtUp)
+            {
+                _interleaveForced = true;
+                _muxCondition.notify_all();
+            }
+        }
+
+        _muxCondition.wait(lock, [this, &interleave]()
+        {
+            return !interleaveFull() || (_interleavePolicy == INTERLEAVE_THROTTLE && !_interleaveForced &&
+                                         interleave.packets.empty());
+        });
+
+        interleave.packets.push_back(muxPkt);
+        interleave.bytes += muxPkt->size;
+        _interleaveBytes += muxPkt->size;
+        _muxCondition.notify_all();
+    }
+
+    // Поток следующего пакета для записи (наименьший dts среди первых пакетов потоков), -1 - ждать.
+    // Пакет пишется, когда пакеты есть у всех потоков, при остановке, когда отстающий поток
+    // задерживает его больше maxDelay или (INTERLEAVE_FLUSH) буфер заполнен.
+    int nextPacket(bool &flushed)
+    {
+        int next = -1;
+        bool complete = true;
+        int64_t newest = 0;
+        bool hasNewest = false;
+
+        flushed = false;
+
+        for (int i = 0; i < static_cast<int>(_interleaves.size()); ++i)
+        {
+            std::deque<AVPacket *> const &packets = _interleaves[i].packets;
+
+            if (packets.empty())
+            {
+                complete = false;
+                continue;
+            }
+
+            AVRational timeBase = stream(i)->time_base;
+
+            if (next < 0 || av_compare_ts(packetTime(packets.front()), timeBase,
+                                          packetTime(_interleaves[next].packets.front()),
+                                          stream(next)->time_base) < 0)
+                next = i;
+
+            int64_t time = av_rescale_q(packetTime(packets.back()), timeBase, av_get_time_base_q());
+            if (!hasNewest || time > newest)
+            {
+                newest = time;
+                hasNewest = true;
+            }
+        }
+
+        if (next < 0 || complete || _muxStopping)
+            return next;
+
+        int64_t oldest = av_rescale_q(packetTime(_interleaves[next].packets.front()), stream(next)->time_base,
+                                      av_get_time_base_q());
+
+        if (newest - oldest > static_cast<int64_t>(_maxInterleaveDelay * AV_TIME_BASE))
+            return next;
+
+        if (interleaveFull() && (_interleavePolicy == INTERLEAVE_FLUSH || _interleaveForced))
+        {
+            flushed = true;
+            return next;
+        }
+
+        return -1;
+    }
+
+    // Поток муксера: интерливинг и запись пакетов всех потоков в файл и дополнительные выводы.
+    // После ошибки пакеты освобождаются без записи.
+    void muxThread()
+    {
+        std::unique_lock<std::mutex> lock(_muxMutex);
+
+        while (true)
+        {
+            int id = -1;
+            bool flushed = false;
+
+            _muxCondition.wait(lock, [this, &id, &flushed]()
+            {
+                id = nextPacket(flushed);
+                return id >= 0 || _muxStopping;
+            });
+
+            if (id < 0)
+                break;
+
+            Interleave &interleave = _interleaves[id];
+            AVPacket *pkt = interleave.packets.front();
+            interleave.packets.pop_front();
+            interleave.bytes -= pkt->size;
+            _interleaveBytes -= pkt->size;
+            if (flushed)
+                _interleaveFlushedNumber++;
+            if (!interleaveFull())
+                _interleaveForced = false;
+            _muxCondition.notify_all();
+            bool failed = static_cast<bool>(_muxError);
+            lock.unlock();
+
+            std::exception_ptr error;
+            std::chrono::steady_clock::time_point sentTime;
+
+            if (!failed)
+            {
+                writeOutputs(*pkt, id);
+                // Порядок пакетов уже задан интерливингом.
+                int err = av_write_frame(_formatContext, pkt);
+
+                if (err == AVERROR(ENOMEM))
+                    error = std::make_exception_ptr(std::bad_alloc());
+                else if (err < 0)
+                    error = std::make_exception_ptr(Error(ERR_RW_FRAME, "failed to write frame"));
+
+                if (_formatContext->pb)
+                    _bytesWritten = avio_tell(_formatContext->pb);
+
+                sentTime = std::chrono::steady_clock::now();
+            }
+
+            av_packet_free(&pkt);
+
+            lock.lock();
+            if (error)
+                _muxError = error;
+            else if (!failed)
+            {
+                interleave.sentNumber++;
+                interleave.sentTime = sentTime;
+            }
+        }
+    }
+
+    // Ошибки потока кодирования id и муксера.
+    void rethrowErrors(int id)
+    {
+        std::exception_ptr error;
+
+        {
+            std::lock_guard<std::mutex> lock(_encoders[id]->mutex);
+            error = _encoders[id]->error;
+        }
+
+        if (!error)
+        {
+            std::lock_guard<std::mutex> lock(_muxMutex);
+            error = _muxError;
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    // Кодирует все принятые кадры и останавливает потоки кодирования.
+    void stopEncoders()
+    {
+        for (std::size_t i = 0; i < _encoders.size(); ++i)
+        {
+            Encoder &encoder = *_encoders[i];
+
+            if (!encoder.thread.joinable())
+                continue;
+
+            {
+                std::lock_guard<std::mutex> lock(encoder.mutex);
+                encoder.stopping = true;
+                encoder.condition.notify_all();
+            }
+
+            encoder.thread.join();
+        }
+    }
+
+    // Записывает все пакеты очереди и останавливает поток муксера.
+    void stopMux()
+    {
+        if (!_muxThread.joinable())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(_muxMutex);
+            _muxStopping = true;
+            _muxCondition.notify_all();
+        }
+
+        _muxThread.join();
+    }
+
+    // Запись в память: данные добавляются в Output::data.
+    static int writeOutputData(void *opaque, uint8_t *buf, int bufSize)
+    {
+        Output *output = static_cast<Output *>(opaque);
+        std::lock_guard<std::mutex> lock(output->dataMutex);
+        output->data.insert(output->data.end(), buf, buf + bufSize);
+        return bufSize;
+    }
+
+    // Ошибки дополнительных выводов не генерируют исключений: запись остальных выводов
+    // продолжается без них.
+    void openOutput(Output &output)
+    {
+        AVOutputFormat *format = output.formatName.empty() ? 0 : av_guess_format(output.formatName.c_str(), 0, 0);
+        int err = avformat_alloc_output_context2(&output.formatContext, format, 0,
+                                                 output.url.empty() ? 0 : output.url.c_str());
+
+        for (int i = 0; err >= 0 && i < nbStreams(); ++i)
+        {
+            if (output.streamIndexes[i] < 0)
+                continue;
+
+            AVStream *outputStream = avformat_new_stream(output.formatContext, 0);
+            if (!outputStream)
+            {
+                err = AVERROR(ENOMEM);
+                break;
+            }
+
+            err = avcodec_parameters_from_context(outputStream->codecpar, codecContext(i));
+            outputStream->codecpar->codec_tag = 0;
+            outputStream->time_base = codecContext(i)->time_base;
+            output.streamIndexes[i] = outputStream->index;
+        }
+
+        if (err >= 0 && output.live)
+        {
+            // Пакеты не задерживаются муксером и сразу отправляются.
+            output.formatContext->max_delay = 0;
+            output.formatContext->flush_packets = 1;
+        }
+
+        if (err >= 0 && output.url.empty())
+        {
+            unsigned char *buffer = static_cast<unsigned char *>(av_malloc(OUTPUT_BUFFER_SIZE));
+            if (buffer)
+                output.formatContext->pb = avio_alloc_context(buffer, OUTPUT_BUFFER_SIZE, 1, &output, 0,
+                                                              writeOutputData, 0);
+            if (!output.formatContext->pb)
+            {
+                av_free(buffer);
+                err = AVERROR(ENOMEM);
+            }
+            output.formatContext->flags |= AVFMT_FLAG_CUSTOM_IO;
+        }
+        else if (err >= 0 && !(output.formatContext->oformat->flags & AVFMT_NOFILE))
+            err = avio_open(&output.formatContext->pb, output.url.c_str(), AVIO_FLAG_WRITE);
+
+        if (err >= 0)
+            err = avformat_write_header(output.formatContext, 0);
+
+        if (err < 0)
+        {
+            closeOutput(output);
+            output.failed = true;
+            output.errorNumber++;
+            return;
+        }
+
+        output.headerWritten = true;
+    }
 
-        _srcFrames.clear();
+    void writeOutputs(AVPacket const &pkt, int id)
+    {
+        AVCodecContext *codecCtx = codecContext(id);
 
-        if (_dstFrame)
+        for (std::size_t i = 0; i < _outputs.size(); ++i)
         {
-            av_frame_free(&_dstFrame);
-            _dstFrame = 0;
+            Output &output = *_outputs[i];
+
+            if (output.failed || !output.formatContext || output.streamIndexes[id] < 0)
+                continue;
+
+            AVPacket outputPkt;
+            int err;
+
+            av_init_packet(&outputPkt);
+            outputPkt.data = 0;
+            outputPkt.size = 0;
+
+            // В файле заголовки MPEG потока хранятся отдельно (global header), а формату без них
+            // (например, сетевому потоку с подключением в любой момент) они нужны перед ключевыми кадрами.
+            bool prependHeaders = (pkt.flags & AV_PKT_FLAG_KEY) && (codecCtx->flags & CODEC_FLAG_GLOBAL_HEADER) &&
+                    !(output.formatContext->oformat->flags & AVFMT_GLOBALHEADER) && codecCtx->extradata_size > 0 &&
+                    (codecCtx->codec_id == AV_CODEC_ID_MPEG4 || codecCtx->codec_id == AV_CODEC_ID_MPEG1VIDEO ||
+                     codecCtx->codec_id == AV_CODEC_ID_MPEG2VIDEO);
+
+            if (prependHeaders)
+            {
+                err = av_new_packet(&outputPkt, codecCtx->extradata_size + pkt.size);
+                if (err >= 0)
+                {
+                    std::memcpy(outputPkt.data, codecCtx->extradata, codecCtx->extradata_size);
+                    std::memcpy(outputPkt.data + codecCtx->extradata_size, pkt.data, pkt.size);
+                    err = av_packet_copy_props(&outputPkt, &pkt);
+                }
+            }
+            else
+                err = av_packet_ref(&outputPkt, &pkt);
+
+            if (err >= 0)
+            {
+                AVStream *outputStream = output.formatContext->streams[output.streamIndexes[id]];
+                outputPkt.stream_index = outputStream->index;
+                av_packet_rescale_ts(&outputPkt, stream(id)->time_base, outputStream->time_base);
+                // Сетевой вывод - без интерливинга, каждый пакет отправляется сразу.
+                if (output.live)
+                    err = av_write_frame(output.formatContext, &outputPkt);
+                else
+                    err = av_interleaved_write_frame(output.formatContext, &outputPkt);
+            }
+
+            av_packet_unref(&outputPkt);
+
+            if (err < 0)
+            {
+                output.errorNumber++;
+                // Ошибка записи файла (например, диск заполнен) выключает только этот вывод.
+                // Сетевой вывод продолжает работу после ошибки отправки пакета.
+                if (!output.live)
+                    output.failed = true;
+            }
+            else
+                output.packetNumber++;
         }
+    }
+
+    void closeOutput(Output &output)
+    {
+        if (!output.formatContext)
+            return;
+
+        if (output.headerWritten && !output.failed)
+            if (av_write_trailer(output.formatContext) < 0)
+                output.errorNumber++;
 
-        if (_dstFrameBuf)
+        if (output.formatContext->flags & AVFMT_FLAG_CUSTOM_IO)
+        {
+            if (output.formatContext->pb)
+            {
+                avio_flush(output.formatContext->pb);
+                av_freep(&output.formatContext->pb->buffer);
+                av_freep(&output.formatContext->pb);
+            }
+        }
+        else if (!(output.formatContext->oformat->flags & AVFMT_NOFILE) && output.formatContext->pb)
         {
-            av_free(_dstFrameBuf);
-            _dstFrameBuf = 0;
+            if (avio_closep(&output.formatContext->pb) < 0)
+                output.errorNumber++;
         }
 
-        _dstFrameBufSize = 0;
+        avformat_free_context(output.formatContext);
+        output.formatContext = 0;
+        output.headerWritten = false;
+    }
+
+    // Счетчики и данные выводов доступны после close(), до следующего open().
+    void deleteOutputs()
+    {
+        for (std::size_t i = 0; i < _outputs.size(); ++i)
+        {
+            closeOutput(*_outputs[i]);
+            delete _outputs[i];
+        }
 
+        _outputs.clear();
+    }
 
-        _inputFrameNumbers.clear();
-        _outputFrameNumbers.clear();
+    void flushEncoders()
+    {
+        try
+        {
+            if (!_formatContext || !_headerWritten)
+                return;
 
+            // Трейлер после ошибки записи не пишется: файл неполный, close() сообщает об этом.
+            if (_failed)
+                throw Error(ERR_WRITE_TRAILER, "the file is incomplete: writing failed before close");
+
+            stopEncoders();
+
+            for (int i = 0; i < nbStreams(); ++i)
+                rethrowErrors(i);
+
+            // Drain: пустой кадр - кодек отдает все задержанные пакеты, файл содержит ровно
+            // записанные кадры.
+            for (int i = 0; i < nbStreams(); ++i)
+            {
+                int err = avcodec_send_frame(codecContext(i), 0);
+
+                if (err == AVERROR(ENOMEM))
+                    throw std::bad_alloc();
+                if (err < 0 && err != AVERROR_EOF)
+                    throw Error(ERR_ENC_DEC_VIDEO, "failed to flush encoder");
+
+                receivePackets(i);
+            }
+
+            stopMux();
+
+            for (int i = 0; i < nbStreams(); ++i)
+                rethrowErrors(i);
+
+            // Заголовок записан. Write the trailer, if any.
+            // The trailer must be written before you close the CodecContexts open when you
+            // wrote the header; otherwise av_write_trailer() may try to use memory that was
+            // freed on av_codec_close().
+
+            int err = av_write_trailer(_formatContext);
+
+            if (err == AVERROR(ENOMEM))
+                throw std::bad_alloc();
+            if (err < 0)
+                throw Error(ERR_WRITE_TRAILER, "failed to write video file trailer");
+
+            if (_formatContext->pb)
+                _bytesWritten = avio_tell(_formatContext->pb);
+        }
+        catch (...)
+        {
+            _failed = true;
+            throw;
+        }
+    }
+
+    void clear()
+    {
+        // После ошибки: потоки освобождают оставшиеся кадры и пакеты без кодирования и записи.
+        stopEncoders();
+        stopMux();
+
+        for (std::size_t i = 0; i < _outputs.size(); ++i)
+            closeOutput(*_outputs[i]);
+
+        if (!_formatContext)
+            return;
+
+        av_dict_free(&_formatContext->metadata);
+
+        for (int i = 0; i < nbStreams(); ++i)
+            avcodec_close(codecContext(i));
+
+        if (_formatContext->oformat && !(_formatContext->oformat->flags & AVFMT_NOFILE))
+            if (_formatContext->pb)
+            {
+                avio_close(_formatContext->pb);
+                _formatContext->pb = 0;
+            }
+
+        avformat_free_context(_formatContext);
+        _formatContext = 0;
+
+        for (std::size_t i = 0; i < _encoders.size(); ++i)
+        {
+            Encoder *encoder = _encoders[i];
+
+            for (std::size_t j = 0; j < encoder->freeFrames.size(); ++j)
+                freeFrame(encoder->freeFrames[j]);
+
+            if (encoder->dstFrame)
+                av_frame_free(&encoder->dstFrame);
+            if (encoder->dstFrameBuf)
+                av_free(encoder->dstFrameBuf);
+            sws_freeContext(encoder->convertCtx);
+
+            delete encoder;
+        }
+
+        _encoders.clear();
+
+        _interleaves.clear();
+        _interleaveBytes = 0;
+        _maxInterleaveDelay = DEFAULT_INTERLEAVE_DELAY_MS / 1000.0;
+        _maxInterleaveBytes = DEFAULT_INTERLEAVE_BYTES;
+        _interleavePolicy = INTERLEAVE_FLUSH;
+        _muxError = std::exception_ptr();
+        _headerWritten = false;
+        _bytesWritten = 0;
+        _startTime = 0;
         _failed = false;
     }
 
     int _nbThreads;
     AVFormatContext *_formatContext;
-    std::vector<AVFrame *> _srcFrames;
-    AVFrame *_dstFrame;
-    unsigned char *_dstFrameBuf;
-    std::ptrdiff_t _dstFrameBufSize;
-    std::vector<long long> _inputFrameNumbers;
-    std::vector<long long> _outputFrameNumbers;
-    std::vector<int64_t> _timestamps;
-    bool _failed;
+    std::atomic<bool> _headerWritten;
+    std::mutex _headerMutex;
+    std::atomic<long long> _bytesWritten;
+    std::vector<Encoder *> _encoders;
+    // Пакеты, ожидающие записи потоком муксера, по потокам.
+    std::vector<Interleave> _interleaves;
+    long long _interleaveBytes;
+    long long _interleaveFlushedNumber;
+    // Ожидание INTERLEAVE_THROTTLE превысило maxDelay, буфер освобождается как при INTERLEAVE_FLUSH.
+    bool _interleaveForced;
+    double _maxInterleaveDelay;
+    long long _maxInterleaveBytes;
+    int _interleavePolicy;
+    bool _muxStopping;
+    std::exception_ptr _muxError;
+    std::mutex _muxMutex;
+    std::condition_variable _muxCondition;
+    std::thread _muxThread;
+    double _startTime;
+    std::atomic<bool> _failed;
+    std::vector<Output *> _outputs;
 };
 
 VideoWriterImpl *videoWriterImpl(void *impl)
@@ -708,6 +1748,51 @@ int VideoWriter::addVideoStream(VideoStreamParams const &params)
     return videoWriterImpl(_impl)->addVideoStream(params);
 }
 
+void VideoWriter::setStartTime(double startTime)
+{
+    return videoWriterImpl(_impl)->setStartTime(startTime);
+}
+
+void VideoWriter::setStartTime(int id, double startTime)
+{
+    return videoWriterImpl(_impl)->setStartTime(id, startTime);
+}
+
+void VideoWriter::setInterleaving(double maxDelay, long long maxBytes, int policy)
+{
+    return videoWriterImpl(_impl)->setInterleaving(maxDelay, maxBytes, policy);
+}
+
+long long VideoWriter::interleavedBytes(int id) const
+{
+    return videoWriterImpl(_impl)->interleavedBytes(id);
+}
+
+long long VideoWriter::interleavedPacketNumber(int id) const
+{
+    return videoWriterImpl(_impl)->interleavedPacketNumber(id);
+}
+
+long long VideoWriter::interleaveFlushedPacketNumber() const
+{
+    return videoWriterImpl(_impl)->interleaveFlushedPacketNumber();
+}
+
+double VideoWriter::encodeTime(int id) const
+{
+    return videoWriterImpl(_impl)->encodeTime(id);
+}
+
+long long VideoWriter::encodedFrameNumber(int id) const
+{
+    return videoWriterImpl(_impl)->encodedFrameNumber(id);
+}
+
+long long VideoWriter::sentPacketNumber(int id, std::chrono::steady_clock::time_point &lastSentTime) const
+{
+    return videoWriterImpl(_impl)->sentPacketNumber(id, lastSentTime);
+}
+
 int VideoWriter::nbStreams() const
 {
     return videoWriterImpl(_impl)->nbStreams();
@@ -778,21 +1863,106 @@ int VideoWriter::maxBFrames(int id) const
     return videoWriterImpl(_impl)->maxBFrames(id);
 }
 
+void VideoWriter::setInterp(int id, int interp)
+{
+    return videoWriterImpl(_impl)->setInterp(id, interp);
+}
+
+int VideoWriter::interp(int id) const
+{
+    return videoWriterImpl(_impl)->interp(id);
+}
+
+bool VideoWriter::accurateRounding(int id) const
+{
+    return videoWriterImpl(_impl)->accurateRounding(id);
+}
+
+int VideoWriter::maxFramesInFlight(int id) const
+{
+    return videoWriterImpl(_impl)->maxFramesInFlight(id);
+}
+
+int VideoWriter::addOutput(std::string const &url, std::string const &formatName, std::vector<int> const &ids, bool live)
+{
+    return videoWriterImpl(_impl)->addOutput(url, formatName, ids, live);
+}
+
+void VideoWriter::setLiveOutput(std::string const &url, std::string const &formatName, int id)
+{
+    videoWriterImpl(_impl)->addOutput(url, formatName, std::vector<int>(1, id), true);
+}
+
+int VideoWriter::nbOutputs() const
+{
+    return videoWriterImpl(_impl)->nbOutputs();
+}
+
+long long VideoWriter::outputPacketNumber(int output) const
+{
+    return videoWriterImpl(_impl)->outputPacketNumber(output);
+}
+
+long long VideoWriter::outputErrorNumber(int output) const
+{
+    return videoWriterImpl(_impl)->outputErrorNumber(output);
+}
+
+bool VideoWriter::outputFailed(int output) const
+{
+    return videoWriterImpl(_impl)->outputFailed(output);
+}
+
+void VideoWriter::takeOutputData(int output, std::vector<unsigned char> &data)
+{
+    return videoWriterImpl(_impl)->takeOutputData(output, data);
+}
+
+long long VideoWriter::livePacketNumber() const
+{
+    return videoWriterImpl(_impl)->livePacketNumber();
+}
+
+bool VideoWriter::liveStream(int id) const
+{
+    return videoWriterImpl(_impl)->liveStream(id);
+}
+
+long long VideoWriter::outputErrorNumber() const
+{
+    return videoWriterImpl(_impl)->outputErrorNumber();
+}
+
 void VideoWriter::write(cv::Mat &image, int id)
 {
     return videoWriterImpl(_impl)->write(image, id);
 }
 
+void VideoWriter::skip(int id)
+{
+    return videoWriterImpl(_impl)->skip(id);
+}
+
 long long VideoWriter::frameNumber(int id) const
 {
     return videoWriterImpl(_impl)->frameNumber(id);
 }
 
+long long VideoWriter::skippedFrameNumber(int id) const
+{
+    return videoWriterImpl(_impl)->skippedFrameNumber(id);
+}
+
 double VideoWriter::timestamp(int id) const
 {
     return videoWriterImpl(_impl)->timestamp(id);
 }
 
+long long VideoWriter::bytesWritten() const
+{
+    return videoWriterImpl(_impl)->bytesWritten();
+}
+
 void VideoWriter::close()
 {
     return videoWriterImpl(_impl)->close();
@@ -3,6 +3,8 @@
 
 #include <VideoIO/Defs.h>
 #include <opencv2/core/core.hpp>
+#include <chrono>
+#include <vector>
 
 #include <VideoIO/AnnoyingWarningsOff.h>
 
@@ -34,9 +36,21 @@ public:
         double frameRate;
 
         // Строка, определяющая формат пикселя, используемый при кодировании и сохранении
-        // изображений в файле (см. libavutil/pixdesc.c). Обязательный параметр.
+        // изображений в файле (см. libavutil/pixdesc.c). Обязательный параметр, кроме случая
+        // заданного inputPixelFormat: пустая строка - inputPixelFormat, если он поддерживается
+        // кодеком (кадры кодируются без преобразования), иначе наилучший из поддерживаемых.
         std::string pixelFormat;
 
+        // Формат пикселя изображений, передаваемых в write() (см. libavutil/pixdesc.c).
+        // Упакованные форматы (bgra, bgr0, yuyv422, ...) - изображение height x width с
+        // элементом размером с пиксель (bgra - CV_8UC4, yuyv422 - CV_8UC2 на 2 пикселя).
+        // Планарные и полупланарные форматы (yuv420p, nv12, ...) - непрерывное изображение
+        // CV_8UC1 (CV_16UC1 для 16 бит) шириной width, все плоскости подряд (для 4:2:0 - height * 3 / 2
+        // строк). При совпадении с форматом кодека кадры не преобразуются.
+        // Пустая строка - формат определяется типом изображения (см. pixelFormat(int elemType)).
+        // Значение по умолчанию: inputPixelFormat = "".
+        std::string inputPixelFormat;
+
         // Если заданный формат пикселя не поддерживается кодеком, то автоматически выбрать
         // наилучший из числа поддерживаемых кодеком?
         // Значение по умолчанию: findBestPixelFormat = false.
@@ -77,6 +91,30 @@ public:
         // Значение по умолчанию: maxBFrames = -1.
         int maxBFrames;
 
+        // Число потоков кодека этого потока, например, доля общего бюджета ядер, поделенного
+        // между потоками по их стоимости кодирования.
+        // nbThreads <= 0 - использовать значение, заданное в open().
+        // Значение по умолчанию: nbThreads = -1.
+        int nbThreads;
+
+        // Число кадров потока, принятых write() и ожидающих кодирования в отдельном потоке
+        // кодирования: write() возвращается после копирования кадра, пока очередь не заполнена,
+        // кодеки с frame threading получают следующий кадр, не дожидаясь пакета предыдущего.
+        // Пакеты всех потоков записывает поток муксера. maxFramesInFlight <= 0 - кадр кодируется
+        // в потоке вызова write(). Ошибка кодирования генерируется следующим write() или close().
+        // Значение по умолчанию: maxFramesInFlight = 0.
+        int maxFramesInFlight;
+
+        // Тип интерполяции при преобразовании формата пикселя кадров (см. setInterp()).
+        // Для преобразования без изменения размера (например, BGR24 -> YUV420P) влияет только на
+        // субдискретизацию цветности: INTERP_FAST_BILINEAR и INTERP_BILINEAR намного быстрее.
+        // Значение по умолчанию: interp = INTERP_LANCZOS.
+        int interp;
+
+        // Точное округление при преобразовании формата пикселя (SWS_ACCURATE_RND, медленнее).
+        // Значение по умолчанию: accurateRounding = true.
+        bool accurateRounding;
+
         // Другие опции контекста кодека AVCodecContext (см. libavcodec/avcodec.h).
         // Формат строки: "опция1=значение1:опция2=значение2: ... :опцияN=значениеN".
         // Полный список опций находится в файле libavcodec/options_table.h.
@@ -97,6 +135,42 @@ public:
     // Добавляет видеопоток. Все потоки должны быть добавлены до записи первого кадра.
     int addVideoStream(VideoStreamParams const &params);
 
+    // Метка времени (s) первого кадра всех потоков, например, для продолжения предыдущего
+    // файла (сегмента). Задается до записи первого кадра.
+    // Значение по умолчанию: startTime = 0.
+    void setStartTime(double startTime);
+
+    // Метка времени (s) первого кадра потока id: потоки предыдущего сегмента могут закончиться
+    // на разных метках. Задается после addVideoStream() и до записи первого кадра.
+    void setStartTime(int id, double startTime);
+
+    // Интерливинг пакетов потоков в файле. Пакет записывается, когда пакеты есть у всех потоков
+    // (наименьший dts первым) или когда отстающий поток задерживает его больше maxDelay (s).
+    // Буфер больше maxBytes байт обрабатывается по policy: INTERLEAVE_FLUSH или
+    // INTERLEAVE_THROTTLE. Задается до записи первого кадра.
+    // Значения по умолчанию: maxDelay = 10, maxBytes = 64 MB, policy = INTERLEAVE_FLUSH.
+    void setInterleaving(double maxDelay, long long maxBytes, int policy);
+
+    // Байты и пакеты потока id в буфере интерливинга, можно вызывать из любого потока выполнения.
+    long long interleavedBytes(int id) const;
+
+    long long interleavedPacketNumber(int id) const;
+
+    // Число пакетов, записанных без ожидания отстающих потоков из-за заполненного буфера.
+    long long interleaveFlushedPacketNumber() const;
+
+    // Время (s) кодирования кадров потока id: преобразование формата и кодек, без ожидания очереди
+    // кадров и муксера. Измеряется там, где кадр кодируется (поток кодирования при
+    // maxFramesInFlight > 0), можно вызывать из любого потока выполнения.
+    double encodeTime(int id) const;
+
+    // Число кадров потока id, переданных кодеку.
+    long long encodedFrameNumber(int id) const;
+
+    // Число пакетов потока id, записанных потоком муксера в файл и дополнительные выводы, и время
+    // записи последнего из них. Можно вызывать из любого потока выполнения.
+    long long sentPacketNumber(int id, std::chrono::steady_clock::time_point &lastSentTime) const;
+
     // Полное число потоков.
     int nbStreams() const;
 
@@ -129,18 +203,90 @@ public:
 
     int maxBFrames(int id) const;
 
+    // Тип интерполяции при преобразовании формата пикселя кадров потока id, может меняться
+    // во время записи (быстрее - хуже качество).
+    // Значение по умолчанию: interp = INTERP_LANCZOS.
+    void setInterp(int id, int interp);
+
+    int interp(int id) const;
+
+    bool accurateRounding(int id) const;
+
+    int maxFramesInFlight(int id) const;
+
+    // Дополнительный вывод тех же закодированных пакетов (без повторного кодирования) со своим
+    // муксером: файл (например, копия на другом диске), pipe ("pipe:1", именованный канал),
+    // сетевой адрес или память (url пустой, данные - takeOutputData()). formatName пустой -
+    // формат определяется по url. ids - потоки вывода, пустой - все потоки. live - пакеты
+    // отправляются сразу, без интерливинга, ошибка отправки не выключает вывод.
+    // Задается до записи первого кадра. Ошибки выводов не генерируют исключений и не влияют на
+    // запись файла и других выводов: ошибка записи выключает только свой вывод (outputFailed()).
+    // Возвращает номер вывода.
+    int addOutput(std::string const &url, std::string const &formatName, std::vector<int> const &ids,
+                  bool live = false);
+
+    // Сетевой вывод потока id, например, formatName = "mpegts", url = "udp://127.0.0.1:5000"
+    // или formatName = "rtp_mpegts", url = "rtp://127.0.0.1:5000", см. addOutput().
+    // Для малой задержки кодек потока должен быть без B-кадров (maxBFrames = 0).
+    void setLiveOutput(std::string const &url, std::string const &formatName, int id);
+
+    // Число дополнительных выводов. Выводы и их счетчики доступны после close(), до open().
+    int nbOutputs() const;
+
+    // Число пакетов, записанных в вывод.
+    long long outputPacketNumber(int output) const;
+
+    // Число ошибок вывода (открытие, запись пакетов, трэйлер).
+    long long outputErrorNumber(int output) const;
+
+    // Вывод выключен после ошибки.
+    bool outputFailed(int output) const;
+
+    // Забирает данные вывода в память, записанные с прошлого вызова. Может вызываться из
+    // любого потока.
+    void takeOutputData(int output, std::vector<unsigned char> &data);
+
+    // Число пакетов, отправленных во все сетевые (live) выводы.
+    long long livePacketNumber() const;
+
+    // Поток id отправляется в сетевой (live) вывод.
+    bool liveStream(int id) const;
+
+    // Число ошибок всех дополнительных выводов.
+    long long outputErrorNumber() const;
+
     // Запись кадра в поток id. Из-за разной латентности кодеков порядок записи в файле кадров,
     // относящимся к РАЗНЫМ видеопотокам, будет отличаться от порядка их передачи на запись.
-    // Типы элементов входного кадра: CV_8UC1, CV_16UC1, CV_8UC3 (BGR24), CV_16UC3 (BGR48).
+    // Типы элементов входного кадра: CV_8UC1, CV_16UC1, CV_8UC3 (BGR24), CV_16UC3 (BGR48),
+    // CV_8UC4 (BGRA) или заданные inputPixelFormat. Кадр копируется, image можно менять после
+    // возврата; при maxFramesInFlight > 0 возврат - до кодирования кадра. Изображение
+    // неподходящего типа или размера отклоняется (ERR_IMAGE_TYPE, ERR_IMAGE_SIZE), запись
+    // продолжается.
+    // write() и skip() РАЗНЫХ потоков можно вызывать одновременно из разных потоков выполнения
+    // (например, цвет и глубина кодируются параллельно), у каждого потока свое состояние
+    // кодирования, пакеты записывает один поток муксера. Вызовы для одного потока id, close() и
+    // остальные методы не должны выполняться одновременно с ними.
     void write(cv::Mat &image, int id);
 
+    // Пропуск кадра потока id (например, повторяющегося): кадр не кодируется, но метка времени
+    // следующего кадра увеличивается так же, как после записи (variable frame rate).
+    void skip(int id);
+
     // Число записанных кадров.
     long long frameNumber(int id) const;
 
+    // Число пропущенных кадров.
+    long long skippedFrameNumber(int id) const;
+
     // Метки времени (s) последних записанных кадров.
     double timestamp(int id) const;
 
-    // Может сгенерировать исключение, т.к. выполняет flush кодеков и запись трэйлера.
+    // Число байт, записанных в файл (без данных, еще находящихся в буферах кодеков, очереди и
+    // буферах муксера).
+    long long bytesWritten() const;
+
+    // Может сгенерировать исключение, т.к. выполняет flush кодеков и запись трэйлера. Генерирует
+    // исключение и после неудачного write() или skip(): трейлер не записан, файл неполный.
     void close();
 
 private:
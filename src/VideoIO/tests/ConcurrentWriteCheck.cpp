@@ -0,0 +1,286 @@
+// Проверка и замер одновременной записи разных потоков одного VideoWriter: два потока (gray и
+// gray16le, ffv1 640x480, кодирование в потоке вызова write()) записываются сначала одним потоком
+// выполнения по очереди, затем двумя потоками выполнения одновременно, несколько раз. Каждый файл
+// читается VideoReader: кадры каждого потока должны вернуться по порядку, со своими метками времени
+// и содержимым (задано номером кадра), без кадров другого потока. Так же с INTERLEAVE_THROTTLE и
+// маленьким буфером интерливинга: одним потоком выполнения (синхронное кодирование, запись не
+// должна ждать maxDelay) и двумя (свои потоки кодирования, опережающий поток ждет отстающий).
+// Использование: ConcurrentWriteCheck [файл] (по умолчанию concurrent-write-check.mkv).
+// Код возврата 0 - успех.
+
+#include <VideoIO/VideoWriter.h>
+#include <VideoIO/VideoReader.h>
+#include <opencv2/core/core.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const int FRAME_NUMBER = 150;
+const int ROUND_NUMBER = 5;
+const double FRAME_RATE = 30;
+const int WIDTH = 640;
+const int HEIGHT = 480;
+const double THROTTLE_DELAY = 2;
+const long long THROTTLE_BYTES = 256 * 1024;
+
+struct Case
+{
+    char const *name;
+    bool concurrent;
+    int policy;
+    int maxFramesInFlight;
+};
+
+Case const cases[] =
+{
+    {"one thread", false, video_io::INTERLEAVE_FLUSH, 0},
+    {"two threads", true, video_io::INTERLEAVE_FLUSH, 0},
+    {"one thread, throttle", false, video_io::INTERLEAVE_THROTTLE, 0},
+    {"two threads, throttle", true, video_io::INTERLEAVE_THROTTLE, 2},
+};
+
+const int CASE_NUMBER = 4;
+
+// Пропуски потока: каждый 9-й кадр gray и каждый 13-й кадр gray16le.
+bool skipped(int id, int tick)
+{
+    return id == 0 ? tick % 9 == 4 : tick % 13 == 6;
+}
+
+// Кадр не постоянный, чтобы кодек работал, и однозначно задан номером кадра.
+cv::Mat makeFrame(int id, int tick)
+{
+    cv::Mat image(HEIGHT, WIDTH, id == 0 ? CV_8UC1 : CV_16UC1);
+
+    for (int y = 0; y < HEIGHT; ++y)
+        for (int x = 0; x < WIDTH; ++x)
+        {
+            if (id == 0)
+                image.at<unsigned char>(y, x) = static_cast<unsigned char>((tick + x + y * 3) % 256);
+            else
+                image.at<unsigned short>(y, x) = static_cast<unsigned short>((tick * 97 + x * y) % 65536);
+        }
+
+    return image;
+}
+
+void writeStream(video_io::VideoWriter *writer, int id, std::vector<cv::Mat> *frames)
+{
+    for (int tick = 0; tick < FRAME_NUMBER; ++tick)
+    {
+        if (skipped(id, tick))
+            writer->skip(id);
+        else
+            writer->write((*frames)[tick], id);
+    }
+}
+
+// Возвращает время записи (s) без открытия и закрытия файла.
+double writeFile(std::string const &fileName, Case const &writeCase, std::vector<cv::Mat> frames[])
+{
+    video_io::VideoWriter writer;
+    writer.open(fileName);
+
+    char const *pixelFormats[] = {"gray", "gray16le"};
+
+    for (int i = 0; i < 2; ++i)
+    {
+        video_io::VideoWriter::VideoStreamParams params;
+        params.codecName = "ffv1";
+        params.frameRate = FRAME_RATE;
+        params.pixelFormat = pixelFormats[i];
+        params.width = WIDTH;
+        params.height = HEIGHT;
+        params.nbThreads = 1;
+        params.maxFramesInFlight = writeCase.maxFramesInFlight;
+        writer.addVideoStream(params);
+    }
+
+    if (writeCase.policy == video_io::INTERLEAVE_THROTTLE)
+        writer.setInterleaving(THROTTLE_DELAY, THROTTLE_BYTES, video_io::INTERLEAVE_THROTTLE);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    if (writeCase.concurrent)
+    {
+        std::exception_ptr errors[2];
+        std::thread threads[2];
+
+        for (int id = 0; id < 2; ++id)
+            threads[id] = std::thread([&writer, &frames, &errors, id]()
+            {
+                try
+                {
+                    writeStream(&writer, id, &frames[id]);
+                }
+                catch (...)
+                {
+                    errors[id] = std::current_exception();
+                }
+            });
+
+        for (int id = 0; id < 2; ++id)
+            threads[id].join();
+        for (int id = 0; id < 2; ++id)
+            if (errors[id])
+                std::rethrow_exception(errors[id]);
+    }
+    else
+    {
+        for (int tick = 0; tick < FRAME_NUMBER; ++tick)
+            for (int id = 0; id < 2; ++id)
+            {
+                if (skipped(id, tick))
+                    writer.skip(id);
+                else
+                    writer.write(frames[id][tick], id);
+            }
+    }
+
+    std::chrono::duration<double> writeTime = std::chrono::steady_clock::now() - start;
+    writer.close();
+    return writeTime.count();
+}
+
+// Возвращает число ошибок.
+int checkFile(std::string const &fileName, std::vector<cv::Mat> const frames[])
+{
+    int errorNumber = 0;
+    video_io::VideoReader reader;
+    reader.open(fileName);
+
+    int ticks[2] = {0, 0};
+    cv::Mat image;
+
+    while (true)
+    {
+        int id = reader.read(image);
+
+        if (id == video_io::STS_EAGAIN)
+            continue;
+        if (id < 0)
+            break;
+        if (id > 1)
+        {
+            std::printf("unexpected stream %d\n", id);
+            ++errorNumber;
+            continue;
+        }
+
+        while (ticks[id] < FRAME_NUMBER && skipped(id, ticks[id]))
+            ++ticks[id];
+
+        int tick = ticks[id]++;
+
+        if (tick >= FRAME_NUMBER)
+        {
+            std::printf("stream %d: extra frame\n", id);
+            ++errorNumber;
+            continue;
+        }
+
+        if (std::fabs(reader.timestamp(id) - tick / FRAME_RATE) > 0.5 / FRAME_RATE)
+        {
+            std::printf("stream %d, tick %d: timestamp %f\n", id, tick, reader.timestamp(id));
+            ++errorNumber;
+        }
+
+        if (image.type() != frames[id][tick].type() || cv::norm(image, frames[id][tick], cv::NORM_INF) != 0)
+        {
+            std::printf("stream %d, tick %d: pixels differ\n", id, tick);
+            ++errorNumber;
+        }
+    }
+
+    reader.close();
+
+    for (int id = 0; id < 2; ++id)
+    {
+        while (ticks[id] < FRAME_NUMBER && skipped(id, ticks[id]))
+            ++ticks[id];
+
+        if (ticks[id] != FRAME_NUMBER)
+        {
+            std::printf("stream %d: read up to tick %d of %d\n", id, ticks[id], FRAME_NUMBER);
+            ++errorNumber;
+        }
+    }
+
+    return errorNumber;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    std::string fileName = argc > 1 ? argv[1] : "concurrent-write-check.mkv";
+    int errorNumber = 0;
+    double writeTimes[CASE_NUMBER] = {0, 0, 0, 0};
+
+    std::vector<cv::Mat> frames[2];
+
+    for (int id = 0; id < 2; ++id)
+        for (int tick = 0; tick < FRAME_NUMBER; ++tick)
+            frames[id].push_back(makeFrame(id, tick));
+
+    try
+    {
+        for (int round = 0; round < ROUND_NUMBER; ++round)
+        {
+            double roundTimes[CASE_NUMBER];
+
+            for (int c = 0; c < CASE_NUMBER; ++c)
+            {
+                roundTimes[c] = writeFile(fileName, cases[c], frames);
+                writeTimes[c] += roundTimes[c];
+
+                int fileErrorNumber = checkFile(fileName, frames);
+
+                if (fileErrorNumber > 0)
+                    std::printf("round %d, %s: %d errors\n", round, cases[c].name, fileErrorNumber);
+                errorNumber += fileErrorNumber;
+            }
+
+            // Синхронный поток с INTERLEAVE_THROTTLE не ждет: ожидание остановило бы и отстающий поток.
+            if (roundTimes[2] > roundTimes[0] + THROTTLE_DELAY)
+            {
+                std::printf("round %d, %s: %.2f s, %.2f s without throttle\n", round, cases[2].name,
+                            roundTimes[2], roundTimes[0]);
+                ++errorNumber;
+            }
+        }
+    }
+    catch (std::exception &e)
+    {
+        std::printf("error: %s\n", e.what());
+        return 1;
+    }
+
+    std::remove(fileName.c_str());
+
+    int frameNumber = 0;
+
+    for (int id = 0; id < 2; ++id)
+        for (int tick = 0; tick < FRAME_NUMBER; ++tick)
+            if (!skipped(id, tick))
+                frameNumber += ROUND_NUMBER;
+
+    for (int c = 0; c < CASE_NUMBER; ++c)
+        std::printf("%-22s %.1f frames/s\n", cases[c].name, frameNumber / writeTimes[c]);
+
+    if (errorNumber > 0)
+    {
+        std::printf("FAILED: %d errors\n", errorNumber);
+        return 1;
+    }
+
+    std::printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,146 @@
+// Измерение преобразования формата пикселя при записи: BGRA 1920x1080 -> yuv420p для каждого типа
+// интерполяции с точным округлением и без. Кодек rawvideo почти ничего не стоит, поэтому
+// encodeTime() потока - время преобразования. Качество - PSNR исходных кадров и кадров,
+// прочитанных VideoReader (обратное преобразование одно и то же для всех вариантов).
+// Использование: ConversionBench [файл] (по умолчанию conversion-bench.avi). Код возврата 0 - успех.
+
+#include <VideoIO/VideoWriter.h>
+#include <VideoIO/VideoReader.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const int FRAME_NUMBER = 60;
+const int WIDTH = 1920;
+const int HEIGHT = 1080;
+
+struct Interp
+{
+    int interp;
+    char const *name;
+};
+
+// Кадр с плавными градиентами, резкими цветными границами и шумом, как у камеры.
+cv::Mat makeFrame(int n)
+{
+    cv::Mat image(HEIGHT, WIDTH, CV_8UC4);
+
+    for (int y = 0; y < HEIGHT; ++y)
+    {
+        uchar *row = image.ptr<uchar>(y);
+
+        for (int x = 0; x < WIDTH; ++x)
+        {
+            int block = ((x + n * 4) / 16 + y / 16) % 3;
+
+            row[x * 4] = static_cast<uchar>(x * 255 / WIDTH);
+            row[x * 4 + 1] = static_cast<uchar>(y * 255 / HEIGHT);
+            row[x * 4 + 2] = static_cast<uchar>(block == 0 ? 230 : block == 1 ? 120 : 20);
+            row[x * 4 + 3] = 255;
+        }
+    }
+
+    cv::Mat noise(HEIGHT, WIDTH, CV_8UC4);
+    cv::theRNG().state = n + 1;
+    cv::randu(noise, cv::Scalar::all(0), cv::Scalar(12, 12, 12, 0));
+    image += noise;
+
+    return image;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    std::string fileName = argc > 1 ? argv[1] : "conversion-bench.avi";
+
+    Interp const interps[] =
+    {
+        {video_io::INTERP_FAST_BILINEAR, "fast bilinear"},
+        {video_io::INTERP_BILINEAR, "bilinear"},
+        {video_io::INTERP_BICUBIC, "bicubic"},
+        {video_io::INTERP_AREA, "area"},
+        {video_io::INTERP_LANCZOS, "lanczos"},
+    };
+
+    std::vector<cv::Mat> frames;
+
+    for (int n = 0; n < FRAME_NUMBER; ++n)
+        frames.push_back(makeFrame(n));
+
+    std::printf("%-14s %-9s %12s %10s\n", "interp", "accurate", "ms/frame", "PSNR dB");
+
+    try
+    {
+        for (std::size_t i = 0; i < sizeof(interps) / sizeof(interps[0]); ++i)
+            for (int accurate = 0; accurate < 2; ++accurate)
+            {
+                video_io::VideoWriter writer;
+                writer.open(fileName);
+
+                video_io::VideoWriter::VideoStreamParams params;
+                params.codecName = "rawvideo";
+                params.pixelFormat = "yuv420p";
+                params.inputPixelFormat = "bgra";
+                params.frameRate = 30;
+                params.width = WIDTH;
+                params.height = HEIGHT;
+                params.interp = interps[i].interp;
+                params.accurateRounding = accurate != 0;
+                writer.addVideoStream(params);
+
+                for (int n = 0; n < FRAME_NUMBER; ++n)
+                    writer.write(frames[n], 0);
+
+                double encodeTime = writer.encodeTime(0);
+                writer.close();
+
+                video_io::VideoReader reader;
+                reader.open(fileName);
+
+                cv::Mat image;
+                cv::Mat source;
+                double psnrSum = 0;
+                int readNumber = 0;
+
+                while (readNumber < FRAME_NUMBER)
+                {
+                    int id = reader.read(image);
+
+                    if (id == video_io::STS_EAGAIN)
+                        continue;
+                    if (id < 0)
+                        break;
+
+                    cv::cvtColor(frames[readNumber], source, cv::COLOR_BGRA2BGR);
+                    psnrSum += cv::PSNR(source, image);
+                    ++readNumber;
+                }
+
+                reader.close();
+
+                if (readNumber != FRAME_NUMBER)
+                {
+                    std::printf("%s: %d frames read, %d written\n", interps[i].name, readNumber, FRAME_NUMBER);
+                    return 1;
+                }
+
+                std::printf("%-14s %-9s %12.3f %10.2f\n", interps[i].name, accurate ? "yes" : "no",
+                            encodeTime * 1000 / FRAME_NUMBER, psnrSum / FRAME_NUMBER);
+            }
+    }
+    catch (std::exception &e)
+    {
+        std::printf("error: %s\n", e.what());
+        return 1;
+    }
+
+    std::remove(fileName.c_str());
+    return 0;
+}
@@ -0,0 +1,167 @@
+// Проверка записи: файл, записанный VideoWriter (кадры в очереди кодирования, пропуски кадров,
+// начальная метка времени), читается VideoReader, каждый записанный кадр должен вернуться со своей
+// меткой времени и содержимым. Кодек без потерь (ffv1), номер кадра - значение всех пикселей.
+// Использование: ReadBackCheck [файл] (по умолчанию readback-check.mkv). Код возврата 0 - успех.
+
+#include <VideoIO/VideoWriter.h>
+#include <VideoIO/VideoReader.h>
+#include <opencv2/core/core.hpp>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const int FRAME_NUMBER = 100;
+const double FRAME_RATE = 25;
+const double START_TIME = 1.5;
+const int WIDTH = 64;
+const int HEIGHT = 48;
+
+// Пропуски потока: каждый 7-й кадр цвета и каждый 11-й кадр глубины.
+bool skipped(int id, int tick)
+{
+    return id == 0 ? tick % 7 == 3 : tick % 11 == 5;
+}
+
+int pixelValue(int id, int tick)
+{
+    return id == 0 ? tick % 256 : tick * 100;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    std::string fileName = argc > 1 ? argv[1] : "readback-check.mkv";
+    int errorNumber = 0;
+
+    try
+    {
+        video_io::VideoWriter writer;
+        writer.open(fileName);
+
+        char const *pixelFormats[] = {"gray", "gray16le"};
+        int types[] = {CV_8UC1, CV_16UC1};
+
+        for (int i = 0; i < 2; ++i)
+        {
+            video_io::VideoWriter::VideoStreamParams params;
+            params.codecName = "ffv1";
+            params.frameRate = FRAME_RATE;
+            params.pixelFormat = pixelFormats[i];
+            params.width = WIDTH;
+            params.height = HEIGHT;
+            params.maxFramesInFlight = 2;
+            writer.addVideoStream(params);
+        }
+
+        writer.setStartTime(START_TIME);
+
+        // Ожидаемые кадры потоков в порядке записи: номер такта (метка времени) каждого кадра.
+        std::vector<int> expected[2];
+
+        for (int tick = 0; tick < FRAME_NUMBER; ++tick)
+            for (int id = 0; id < 2; ++id)
+            {
+                if (skipped(id, tick))
+                {
+                    writer.skip(id);
+                    continue;
+                }
+
+                cv::Mat image(HEIGHT, WIDTH, types[id], cv::Scalar(pixelValue(id, tick)));
+                writer.write(image, id);
+                expected[id].push_back(tick);
+            }
+
+        writer.close();
+
+        video_io::VideoReader reader;
+        reader.open(fileName);
+
+        if (reader.nbVideoStreams() != 2)
+        {
+            std::printf("video streams: %d, expected 2\n", reader.nbVideoStreams());
+            return 1;
+        }
+
+        std::size_t readNumbers[2] = {0, 0};
+        cv::Mat image;
+
+        while (true)
+        {
+            int id = reader.read(image);
+
+            if (id == video_io::STS_EAGAIN)
+                continue;
+            if (id < 0)
+                break;
+            if (id > 1)
+            {
+                std::printf("unexpected stream %d\n", id);
+                ++errorNumber;
+                continue;
+            }
+
+            std::size_t n = readNumbers[id]++;
+
+            if (n >= expected[id].size())
+            {
+                std::printf("stream %d: extra frame %d\n", id, static_cast<int>(n));
+                ++errorNumber;
+                continue;
+            }
+
+            int tick = expected[id][n];
+            double timestamp = START_TIME + tick / FRAME_RATE;
+
+            if (std::fabs(reader.timestamp(id) - timestamp) > 0.5 / FRAME_RATE)
+            {
+                std::printf("stream %d, frame %d: timestamp %f, expected %f\n", id, static_cast<int>(n),
+                            reader.timestamp(id), timestamp);
+                ++errorNumber;
+            }
+
+            double minValue = 0;
+            double maxValue = 0;
+            cv::minMaxLoc(image.reshape(1), &minValue, &maxValue);
+
+            if (minValue != pixelValue(id, tick) || maxValue != pixelValue(id, tick))
+            {
+                std::printf("stream %d, frame %d: pixels %f..%f, expected %d\n", id, static_cast<int>(n),
+                            minValue, maxValue, pixelValue(id, tick));
+                ++errorNumber;
+            }
+        }
+
+        for (int id = 0; id < 2; ++id)
+            if (readNumbers[id] != expected[id].size())
+            {
+                std::printf("stream %d: %d frames read, %d written\n", id, static_cast<int>(readNumbers[id]),
+                            static_cast<int>(expected[id].size()));
+                ++errorNumber;
+            }
+
+        reader.close();
+    }
+    catch (std::exception &e)
+    {
+        std::printf("error: %s\n", e.what());
+        return 1;
+    }
+
+    std::remove(fileName.c_str());
+
+    if (errorNumber > 0)
+    {
+        std::printf("FAILED: %d errors\n", errorNumber);
+        return 1;
+    }
+
+    std::printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,212 @@
+// Сравнение потоков кодеков для записи цвета и глубины рекордером: wmv2 960x540 (BGRA -> yuv420p) и
+// ffv1 512x424 gray16, кадры пишутся из одного потока выполнения. Сначала каждому кодеку дается
+// CPUs + 1 потоков (прежнее поведение), затем бюджет CPUs - 1 делится между кодеками по стоимости
+// кадра (время кодирования x потоки), измеренной в первом прогоне, как это делает ThreadBudget
+// рекордера. Оба варианта - с 2 кадрами в очереди кодирования каждого потока и с синхронным
+// кодированием в write() (maxFramesInFlight = 0): кадры/s и время одного вызова write().
+// Использование: ThreadSplitBench [файл] (по умолчанию thread-split-bench.mkv). Код возврата 0 - успех.
+
+#include <VideoIO/VideoWriter.h>
+#include <opencv2/core/core.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const int FRAME_NUMBER = 300;
+const int PATTERN_NUMBER = 30;
+const double FRAME_RATE = 30;
+
+struct Stream
+{
+    char const *codecName;
+    char const *pixelFormat;
+    char const *inputPixelFormat;
+    int width;
+    int height;
+    int type;
+};
+
+Stream const streams[] =
+{
+    {"wmv2", "yuv420p", "bgra", 960, 540, CV_8UC4},
+    {"ffv1", "gray16", "gray16", 512, 424, CV_16UC1},
+};
+
+const int STREAM_NUMBER = 2;
+
+struct Result
+{
+    double seconds;
+    double writeTimeSumMs;
+    double writeTimeMaxMs;
+    int threadNumbers[STREAM_NUMBER];
+    double encodeTimesMs[STREAM_NUMBER];
+};
+
+// Движущийся узор с шумом: у кодеков есть работа, кадры повторяются с периодом PATTERN_NUMBER.
+cv::Mat makeFrame(Stream const &stream, int n)
+{
+    cv::Mat image(stream.height, stream.width, stream.type);
+
+    for (int y = 0; y < stream.height; ++y)
+    {
+        if (stream.type == CV_8UC4)
+        {
+            unsigned char *row = image.ptr<unsigned char>(y);
+
+            for (int x = 0; x < stream.width; ++x)
+            {
+                row[x * 4] = static_cast<unsigned char>((x + n * 8) * 255 / stream.width);
+                row[x * 4 + 1] = static_cast<unsigned char>((y + n * 4) % 256);
+                row[x * 4 + 2] = static_cast<unsigned char>(((x / 32 + y / 32 + n) % 2) * 200 + (x * y + n) % 17);
+                row[x * 4 + 3] = 255;
+            }
+        }
+        else
+        {
+            unsigned short *row = image.ptr<unsigned short>(y);
+
+            for (int x = 0; x < stream.width; ++x)
+                row[x] = static_cast<unsigned short>(500 + (x * 7 + y * 3 + n * 11) % 4000 + (x * y + n) % 13);
+        }
+    }
+
+    return image;
+}
+
+Result run(std::string const &fileName, int const threadNumbers[], int maxFramesInFlight,
+           std::vector<cv::Mat> frames[])
+{
+    Result result;
+    result.writeTimeSumMs = 0;
+    result.writeTimeMaxMs = 0;
+    video_io::VideoWriter writer;
+    writer.open(fileName);
+
+    for (int i = 0; i < STREAM_NUMBER; ++i)
+    {
+        video_io::VideoWriter::VideoStreamParams params;
+        params.codecName = streams[i].codecName;
+        params.pixelFormat = streams[i].pixelFormat;
+        params.inputPixelFormat = streams[i].inputPixelFormat;
+        params.frameRate = FRAME_RATE;
+        params.width = streams[i].width;
+        params.height = streams[i].height;
+        params.findBestPixelFormat = false;
+        params.nbThreads = threadNumbers[i];
+        params.interp = video_io::INTERP_BILINEAR;
+        params.accurateRounding = false;
+        params.maxFramesInFlight = maxFramesInFlight;
+        writer.addVideoStream(params);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (int n = 0; n < FRAME_NUMBER; ++n)
+        for (int i = 0; i < STREAM_NUMBER; ++i)
+        {
+            std::chrono::steady_clock::time_point writeStart = std::chrono::steady_clock::now();
+            writer.write(frames[i][n % PATTERN_NUMBER], i);
+            std::chrono::duration<double, std::milli> writeTime = std::chrono::steady_clock::now() - writeStart;
+
+            result.writeTimeSumMs += writeTime.count();
+            result.writeTimeMaxMs = std::max(result.writeTimeMaxMs, writeTime.count());
+        }
+
+    // Время кодирования и потоки читаются до close(), без кадров, еще стоящих в очереди кодирования.
+    for (int i = 0; i < STREAM_NUMBER; ++i)
+    {
+        long long encodedNumber = std::max(writer.encodedFrameNumber(i), 1LL);
+
+        result.threadNumbers[i] = writer.nbThreads(i);
+        result.encodeTimesMs[i] = writer.encodeTime(i) * 1000 / encodedNumber;
+    }
+
+    writer.close();
+
+    std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+    result.seconds = time.count();
+    return result;
+}
+
+void print(char const *name, Result const &result)
+{
+    std::printf("%-30s %8.1f fps   write() %6.2f ms, max %7.2f ms", name, FRAME_NUMBER / result.seconds,
+                result.writeTimeSumMs / (FRAME_NUMBER * STREAM_NUMBER), result.writeTimeMaxMs);
+
+    for (int i = 0; i < STREAM_NUMBER; ++i)
+        std::printf("   %s: %2d threads %7.2f ms/frame", streams[i].codecName, result.threadNumbers[i],
+                    result.encodeTimesMs[i]);
+
+    std::printf("\n");
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    std::string fileName = argc > 1 ? argv[1] : "thread-split-bench.mkv";
+    int cpuNumber = cv::getNumberOfCPUs();
+
+    std::vector<cv::Mat> frames[STREAM_NUMBER];
+
+    for (int i = 0; i < STREAM_NUMBER; ++i)
+        for (int n = 0; n < PATTERN_NUMBER; ++n)
+            frames[i].push_back(makeFrame(streams[i], n));
+
+    try
+    {
+        int oldThreadNumbers[STREAM_NUMBER];
+
+        for (int i = 0; i < STREAM_NUMBER; ++i)
+            oldThreadNumbers[i] = cpuNumber + 1;
+
+        Result old = run(fileName, oldThreadNumbers, 2, frames);
+        Result oldSync = run(fileName, oldThreadNumbers, 0, frames);
+
+        // Каждому кодеку хотя бы один поток, остаток бюджета - по доле стоимости.
+        int budget = std::max(STREAM_NUMBER, cpuNumber - 1);
+        double costs[STREAM_NUMBER];
+        double costSum = 0;
+
+        for (int i = 0; i < STREAM_NUMBER; ++i)
+        {
+            costs[i] = std::max(old.encodeTimesMs[i] * old.threadNumbers[i], 1e-3);
+            costSum += costs[i];
+        }
+
+        int splitThreadNumbers[STREAM_NUMBER];
+        int allocatedNumber = 0;
+
+        for (int i = 0; i < STREAM_NUMBER; ++i)
+        {
+            splitThreadNumbers[i] = 1 + static_cast<int>((budget - STREAM_NUMBER) * costs[i] / costSum);
+            allocatedNumber += splitThreadNumbers[i];
+        }
+
+        splitThreadNumbers[costs[0] >= costs[1] ? 0 : 1] += budget - allocatedNumber;
+
+        Result split = run(fileName, splitThreadNumbers, 2, frames);
+        Result splitSync = run(fileName, splitThreadNumbers, 0, frames);
+
+        std::printf("CPUs: %d, frames: %d per stream\n", cpuNumber, FRAME_NUMBER);
+        print("CPUs + 1 per stream", old);
+        print("CPUs + 1 per stream, sync", oldSync);
+        print("budget CPUs - 1 split", split);
+        print("budget CPUs - 1 split, sync", splitSync);
+    }
+    catch (std::exception &e)
+    {
+        std::printf("error: %s\n", e.what());
+        return 1;
+    }
+
+    std::remove(fileName.c_str());
+    return 0;
+}
@@ -99,13 +99,249 @@ void ConsoleController::Command(const string commandLine)
                 }
             }
         }
+        if (command.compare(COMMAND_SET_TIME_LAPSE) == 0)
+        {
+            if (argc == 2 || argc == 3)
+            {
+                int method = TimeLapseAccumulator::METHOD_NTH;
+                if (argc == 3)
+                {
+                    if (args->at(2).compare(TIME_LAPSE_MEAN) == 0)
+                    {
+                        method = TimeLapseAccumulator::METHOD_MEAN;
+                    }
+                    else if (args->at(2).compare(TIME_LAPSE_MEDIAN) == 0)
+                    {
+                        method = TimeLapseAccumulator::METHOD_MEDIAN;
+                    }
+                    else if (args->at(2).compare(TIME_LAPSE_NTH) != 0)
+                    {
+                        method = -1;
+                    }
+                }
+                if (method >= 0)
+                {
+                    try
+                    {
+                        _pKinect2Recorder->SetTimeLapse(std::stoi(args->at(1)), method);
+                    }
+                    catch(...)
+                    {
+                    }
+                }
+            }
+        }
+        if (command.compare(COMMAND_SET_TRIGGER) == 0)
+        {
+            if (argc == 4)
+            {
+                try
+                {
+                    _pKinect2Recorder->SetTrigger(std::stoi(args->at(1)), std::stoi(args->at(2)), std::stoi(args->at(3)));
+                }
+                catch(...)
+                {
+                }
+            }
+        }
+        if (command.compare(COMMAND_SET_DUPLICATE) == 0)
+        {
+            if (argc == 2)
+            {
+                if (args->at(1).compare(DUPLICATE_OFF) == 0)
+                {
+                    _pKinect2Recorder->SetDuplicateThreshold(-1.0);
+                }
+                else if (args->at(1).compare(DUPLICATE_EXACT) == 0)
+                {
+                    _pKinect2Recorder->SetDuplicateThreshold(0.0);
+                }
+                else
+                {
+                    try
+                    {
+                        double threshold = std::stod(args->at(1));
+                        if (threshold >= 0)
+                        {
+                            _pKinect2Recorder->SetDuplicateThreshold(threshold);
+                        }
+                    }
+                    catch(...)
+                    {
+                    }
+                }
+            }
+        }
+        if (command.compare(COMMAND_SET_PRE_ROLL) == 0)
+        {
+            if (argc == 2 || argc == 3)
+            {
+                try
+                {
+                    int maxMegabytes = argc == 3 ? std::stoi(args->at(2)) : 0;
+                    _pKinect2Recorder->SetPreRoll(std::stoi(args->at(1)), maxMegabytes);
+                }
+                catch(...)
+                {
+                }
+            }
+        }
+        if (command.compare(COMMAND_SET_ENCODE_QUEUE) == 0)
+        {
+            if (argc == 2)
+            {
+                try
+                {
+                    _pKinect2Recorder->SetEncodeQueue(std::stoi(args->at(1)));
+                }
+                catch(...)
+                {
+                }
+            }
+        }
+        if (command.compare(COMMAND_SET_SPILL) == 0)
+        {
+            if (argc == 2 && args->at(1).compare(SPILL_OFF) == 0)
+            {
+                _pKinect2Recorder->SetSpill(string(), 0);
+            }
+            else if (argc == 2 || argc == 3)
+            {
+                try
+                {
+                    int maxMegabytes = argc == 3 ? std::stoi(args->at(2)) : 0;
+                    _pKinect2Recorder->SetSpill(args->at(1), maxMegabytes);
+                }
+                catch(...)
+                {
+                }
+            }
+        }
+        if (command.compare(COMMAND_SET_EXPORT) == 0)
+        {
+            if (argc == 2 && args->at(1).compare(EXPORT_OFF) == 0)
+            {
+                _pKinect2Recorder->SetExport(string(), 1, 0);
+            }
+            else if (argc >= 2 && argc <= 4)
+            {
+                try
+                {
+                    int interval = argc >= 3 ? std::stoi(args->at(2)) : 1;
+                    int width = argc == 4 ? std::stoi(args->at(3)) : 0;
+                    _pKinect2Recorder->SetExport(args->at(1), interval, width);
+                }
+                catch(...)
+                {
+                }
+            }
+        }
+        if (command.compare(COMMAND_SHARED_MEMORY) == 0)
+        {
+            if (argc == 2 && args->at(1).compare(SHARED_MEMORY_ON) == 0)
+            {
+                _pKinect2Recorder->SetSharedMemory(true);
+            }
+            if (argc == 2 && args->at(1).compare(SHARED_MEMORY_OFF) == 0)
+            {
+                _pKinect2Recorder->SetSharedMemory(false);
+            }
+        }
+        if (command.compare(COMMAND_LIVE) == 0)
+        {
+            if (argc == 2 && args->at(1).compare(LIVE_OFF) == 0)
+            {
+                _pKinect2Recorder->SetLive(string(), string());
+            }
+            else if (argc == 2)
+            {
+                _pKinect2Recorder->SetLive(args->at(1), LIVE_DEFAULT_FORMAT);
+            }
+            else if (argc == 3)
+            {
+                _pKinect2Recorder->SetLive(args->at(1), args->at(2));
+            }
+        }
+        if (command.compare(COMMAND_MIRROR) == 0)
+        {
+            if (argc == 2 && args->at(1).compare(MIRROR_OFF) == 0)
+            {
+                _pKinect2Recorder->SetMirror(string());
+            }
+            else if (argc == 2)
+            {
+                _pKinect2Recorder->SetMirror(args->at(1));
+            }
+        }
+        if (command.compare(COMMAND_PROXY) == 0)
+        {
+            if (argc == 2 && args->at(1).compare(PROXY_ON) == 0)
+            {
+                _pKinect2Recorder->SetProxy(true);
+            }
+            if (argc == 2 && args->at(1).compare(PROXY_OFF) == 0)
+            {
+                _pKinect2Recorder->SetProxy(false);
+            }
+        }
+        if (command.compare(COMMAND_SET_THREADS) == 0)
+        {
+            if (argc == 2)
+            {
+                try
+                {
+                    _pKinect2Recorder->SetThreads(std::stoi(args->at(1)));
+                }
+                catch(...)
+                {
+                }
+            }
+        }
+        if (command.compare(COMMAND_SET_SEGMENT) == 0)
+        {
+            if (argc == 2 || argc == 3)
+            {
+                try
+                {
+                    int megabytes = argc == 3 ? std::stoi(args->at(2)) : 0;
+                    _pKinect2Recorder->SetSegment(std::stoi(args->at(1)), megabytes);
+                }
+                catch(...)
+                {
+                }
+            }
+        }
         if (command.compare(COMMAND_START) == 0)
         {
             if (argc == 1)
             {
                 _pKinect2Recorder->Start();
             }
-            if (argc == 2)
+            if (argc == 2 && args->at(1).compare(START_TRIGGER) == 0)
+            {
+                _pKinect2Recorder->StartTriggered();
+            }
+            else if (argc == 3 && args->at(1).compare(START_STOP_AT) == 0)
+            {
+                try
+                {
+                    _pKinect2Recorder->StartAt(std::stoll(args->at(2)));
+                }
+                catch(...)
+                {
+                }
+            }
+            else if (argc == 3 && args->at(1).compare(START_FRAMES) == 0)
+            {
+                try
+                {
+                    _pKinect2Recorder->StartFrames(std::stoll(args->at(2)));
+                }
+                catch(...)
+                {
+                }
+            }
+            else if (argc == 2)
             {
                 try
                 {
@@ -118,12 +354,61 @@ void ConsoleController::Command(const string commandLine)
         }
         if (command.compare(COMMAND_STOP) == 0)
         {
-            _pKinect2Recorder->Stop();
+            if (argc == 1)
+            {
+                _pKinect2Recorder->Stop();
+            }
+            if (argc == 3 && args->at(1).compare(START_STOP_AT) == 0)
+            {
+                try
+                {
+                    _pKinect2Recorder->StopAt(std::stoll(args->at(2)));
+                }
+                catch(...)
+                {
+                }
+            }
         }
         if (command.compare(COMMAND_END) == 0)
         {
             _pKinect2Recorder->Deactivate();
         }
+        if (command.compare(COMMAND_STATS) == 0)
+        {
+            _pKinect2Recorder->LogStats();
+        }
+        if (command.compare(COMMAND_PREVIEW) == 0)
+        {
+            if (argc == 2 && args->at(1).compare(PREVIEW_ON) == 0)
+            {
+                _pKinect2Recorder->SetPreview(true);
+            }
+            if (argc == 2 && args->at(1).compare(PREVIEW_OFF) == 0)
+            {
+                _pKinect2Recorder->SetPreview(false);
+            }
+            if (argc == 3)
+            {
+                try
+                {
+                    _pKinect2Recorder->SetPreviewRate(std::stoi(args->at(1)), std::stoi(args->at(2)));
+                }
+                catch(...)
+                {
+                }
+            }
+        }
+        if (command.compare(COMMAND_GOVERNOR) == 0)
+        {
+            if (argc == 2 && args->at(1).compare(GOVERNOR_ON) == 0)
+            {
+                _pKinect2Recorder->SetGovernor(true);
+            }
+            if (argc == 2 && args->at(1).compare(GOVERNOR_OFF) == 0)
+            {
+                _pKinect2Recorder->SetGovernor(false);
+            }
+        }
     delete(args);
     args = nullptr;
 }
@@ -20,11 +20,48 @@ private:
     const string COMMAND_SET_MODE = "mode";
     const string COMMAND_SET_SIZE = "size";
     const string COMMAND_SET_FPS = "fps";
+    const string COMMAND_SET_TIME_LAPSE = "timelapse";
+    const string COMMAND_SET_TRIGGER = "trigger";
+    const string COMMAND_SET_DUPLICATE = "dedup";
+    const string COMMAND_SET_PRE_ROLL = "preroll";
+    const string COMMAND_SET_SEGMENT = "segment";
+    const string COMMAND_SET_ENCODE_QUEUE = "queue";
+    const string COMMAND_SET_SPILL = "spill";
+    const string SPILL_OFF = "off";
+    const string COMMAND_SET_THREADS = "threads";
+    const string COMMAND_SET_EXPORT = "export";
+    const string EXPORT_OFF = "off";
+    const string COMMAND_SHARED_MEMORY = "share";
+    const string SHARED_MEMORY_ON = "on";
+    const string SHARED_MEMORY_OFF = "off";
+    const string COMMAND_LIVE = "live";
+    const string LIVE_OFF = "off";
+    const string LIVE_DEFAULT_FORMAT = "mpegts";
+    const string COMMAND_MIRROR = "mirror";
+    const string MIRROR_OFF = "off";
+    const string COMMAND_PROXY = "proxy";
+    const string PROXY_ON = "on";
+    const string PROXY_OFF = "off";
     const string COMMAND_START = "start";
     const string COMMAND_STOP = "stop";
+    const string START_TRIGGER = "trigger";
+    const string START_STOP_AT = "at";
+    const string START_FRAMES = "frames";
     const string COMMAND_END = "end";
+    const string COMMAND_STATS = "stats";
+    const string COMMAND_PREVIEW = "preview";
+    const string PREVIEW_ON = "on";
+    const string PREVIEW_OFF = "off";
+    const string COMMAND_GOVERNOR = "governor";
+    const string GOVERNOR_ON = "on";
+    const string GOVERNOR_OFF = "off";
     const string MODE_COLOR = "c";
     const string MODE_DEPTH = "d";
+    const string TIME_LAPSE_NTH = "nth";
+    const string TIME_LAPSE_MEAN = "mean";
+    const string TIME_LAPSE_MEDIAN = "median";
+    const string DUPLICATE_OFF = "off";
+    const string DUPLICATE_EXACT = "exact";
     Kinect2Recorder * _pKinect2Recorder;
     vector<string> * ParseLine(const string line);
 public:    
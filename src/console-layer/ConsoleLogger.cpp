@@ -80,6 +80,346 @@ void ConsoleLogger::LogSetFailedFPSWhenIncorrectValue()
     std::cout << LOG_PREFIX << "Failed FPS setting, incorrect value" << std::endl;
 }
 
+void ConsoleLogger::LogSetTimeLapse(int factor)
+{
+    std::cout << LOG_PREFIX << "Success, one video frame per " << factor << " Kinect2 frames" << std::endl;
+}
+
+void ConsoleLogger::LogFailedSetTimeLapse()
+{
+    std::cout << LOG_PREFIX << "Failed time-lapse setting, incorrect value" << std::endl;
+}
+
+void ConsoleLogger::LogSetTrigger()
+{
+    std::cout << LOG_PREFIX << "Success" << std::endl;
+}
+
+void ConsoleLogger::LogFailedSetTrigger()
+{
+    std::cout << LOG_PREFIX << "Failed trigger setting, incorrect value" << std::endl;
+}
+
+void ConsoleLogger::LogTriggerOn()
+{
+    std::cout << LOG_PREFIX << "Activity trigger ON, waiting for activity" << std::endl;
+}
+
+void ConsoleLogger::LogTriggerOff()
+{
+    std::cout << LOG_PREFIX << "Activity trigger OFF" << std::endl;
+}
+
+void ConsoleLogger::LogFailedTriggerWhenNoDepth()
+{
+    std::cout << LOG_PREFIX << "Failed activity trigger, depth mode is required" << std::endl;
+}
+
+void ConsoleLogger::LogSetDuplicateThreshold()
+{
+    std::cout << LOG_PREFIX << "Success" << std::endl;
+}
+
+void ConsoleLogger::LogFailedSetDuplicateThreshold()
+{
+    std::cout << LOG_PREFIX << "Failed duplicate frame setting, incorrect value" << std::endl;
+}
+
+void ConsoleLogger::LogSkippedFrames(const std::string& path, int modeNumber, long long number)
+{
+    std::cout << LOG_PREFIX << "Skipped duplicate frames: " << number << ", path: " << path << " mode: " << modeNumber << std::endl;
+}
+
+void ConsoleLogger::LogStats(const kinect2recorder::Kinect2RecorderStats& stats)
+{
+    double commandLatencyAverageMs = stats.commandNumber > 0 ? stats.commandLatencySumMs / stats.commandNumber : 0.0;
+    double updateTimeAverageMs = stats.updateNumber > 0 ? stats.updateTimeSumMs / stats.updateNumber : 0.0;
+    std::cout << LOG_PREFIX << "Device time: " << stats.frameTimestamp << " us" << std::endl;
+    std::cout << LOG_PREFIX << "Commands: " << stats.commandNumber << ", latency average: " << commandLatencyAverageMs
+              << " ms, max: " << stats.commandLatencyMaxMs << " ms" << std::endl;
+    double postTimeAverageUs = stats.postNumber > 0 ? stats.postTimeSumUs / stats.postNumber : 0.0;
+    std::cout << LOG_PREFIX << "Command posts: " << stats.postNumber << ", caller wait average: " << postTimeAverageUs
+              << " us, max: " << stats.postTimeMaxUs << " us" << std::endl;
+    std::cout << LOG_PREFIX << "Loop (preview " << (stats.preview ? "on" : "off") << "): " << stats.updateNumber
+              << ", time average: " << updateTimeAverageMs << " ms, max: " << stats.updateTimeMaxMs << " ms" << std::endl;
+    double preRollEncodeTimeAverageMs = stats.preRollEncodedNumber > 0 ? stats.preRollEncodeTimeSumMs / stats.preRollEncodedNumber : 0.0;
+    std::cout << LOG_PREFIX << "Pre-roll: " << stats.preRollFrameNumber << " frames, " << stats.preRollBytes / (1024 * 1024)
+              << " MB, encoded: " << stats.preRollEncodedNumber << ", dropped: " << stats.preRollDroppedNumber
+              << ", encode time average: " << preRollEncodeTimeAverageMs << " ms, total: " << stats.preRollEncodeTimeSumMs << " ms" << std::endl;
+    std::cout << LOG_PREFIX << "Pre-roll flushes: " << stats.preRollFlushNumber << ", time max: " << stats.preRollFlushTimeMaxMs << " ms" << std::endl;
+    std::cout << LOG_PREFIX << "Quality level: " << stats.qualityLevel << ", load: " << stats.qualityLoad
+              << ", lost frames: " << stats.lostFrameNumber << ", skipped color frames: " << stats.governorSkippedNumber << std::endl;
+    std::cout << LOG_PREFIX << "Encode queue: " << stats.encodeQueueBytes / (1024 * 1024) << " MB, spill file: "
+              << stats.encodeSpillBytes / (1024 * 1024) << " MB, spilled frames: " << stats.encodeSpilledNumber
+              << ", dropped: " << stats.encodeDroppedNumber << std::endl;
+    const kinect2recorder::LatencyHistogram& latency = stats.wakeupLatency;
+    std::cout << LOG_PREFIX << "Wakeup latency: " << latency.GetNumber() << ", p50 < " << latency.GetPercentile(50.0)
+              << " us, p99 < " << latency.GetPercentile(99.0) << " us, p99.9 < " << latency.GetPercentile(99.9)
+              << " us, max: " << latency.GetMax() << " us" << std::endl;
+    std::cout << LOG_PREFIX << "Wakeup latency histogram (us):";
+    for (int i = 0; i < kinect2recorder::LatencyHistogram::BUCKET_NUMBER; i++)
+    {
+        if (latency.GetCount(i) > 0)
+        {
+            std::cout << " <" << kinect2recorder::LatencyHistogram::GetBucketLimit(i) << ": " << latency.GetCount(i);
+        }
+    }
+    std::cout << std::endl;
+    for (size_t i = 0; i < stats.pipelineNodes.size(); i++)
+    {
+        const kinect2recorder::PipelineNodeStats& node = stats.pipelineNodes[i];
+        double nodeTimeAverageMs = node.processedNumber > 0 ? node.timeSumMs / node.processedNumber : 0.0;
+        std::cout << LOG_PREFIX << "Pipeline node '" << node.name << "': " << node.processedNumber << ", time average: "
+                  << nodeTimeAverageMs << " ms, max: " << node.timeMaxMs << " ms, dropped: " << node.droppedNumber
+                  << ", failed: " << node.failedNumber << std::endl;
+    }
+    if (stats.livePacketNumber > 0 || stats.outputErrorNumber > 0)
+    {
+        const kinect2recorder::LatencyHistogram& liveLatency = stats.liveLatency;
+        std::cout << LOG_PREFIX << "Live packets: " << stats.livePacketNumber << ", output errors (live, mirror): " << stats.outputErrorNumber
+                  << ", latency p50 < " << liveLatency.GetPercentile(50.0) << " us, p99 < " << liveLatency.GetPercentile(99.0)
+                  << " us, max: " << liveLatency.GetMax() << " us" << std::endl;
+    }
+    std::cout << LOG_PREFIX << "Muxer interleaving: " << stats.interleaveBytes << " bytes, " << stats.interleavePacketNumber
+              << " packets, flushed early (buffer full): " << stats.interleaveFlushedNumber << std::endl;
+    std::cout << LOG_PREFIX << "Proxy frames: " << stats.proxyWrittenNumber << ", skipped (proxy behind): "
+              << stats.proxyDroppedNumber << std::endl;
+    std::cout << LOG_PREFIX << "Subscriber frames: " << stats.subscriberDeliveredNumber << ", dropped: "
+              << stats.subscriberDroppedNumber << ", failed callbacks: " << stats.subscriberFailedNumber << std::endl;
+    std::cout << LOG_PREFIX << "Shared memory frames not published (ring can not be created or a reader keeps a smaller one open): "
+              << stats.sharedMemoryFailedNumber << std::endl;
+    std::cout << LOG_PREFIX << "Codec thread budget: " << stats.threadBudget << std::endl;
+    for (int i = 0; i < 2; i++)
+    {
+        double encodeTimeAverageMs = stats.encodedNumbers[i] > 0 ? stats.encodeTimeSumsMs[i] / stats.encodedNumbers[i] : 0.0;
+        std::cout << LOG_PREFIX << "Encoded (mode " << i << "): " << stats.encodedNumbers[i] << " frames, time average: "
+                  << encodeTimeAverageMs << " ms, codec threads: " << stats.encodeThreadNumbers[i] << std::endl;
+    }
+    std::cout << LOG_PREFIX << "Closed videos: " << stats.finalizedNumber << ", close time max: " << stats.finalizeTimeMaxMs
+              << " ms, closing now: " << stats.finalizePendingNumber << std::endl;
+}
+
+void ConsoleLogger::LogSetPreview()
+{
+    std::cout << LOG_PREFIX << "Success" << std::endl;
+}
+
+void ConsoleLogger::LogFailedSetPreview()
+{
+    std::cout << LOG_PREFIX << "Failed preview setting, incorrect value" << std::endl;
+}
+
+void ConsoleLogger::LogSetSegment()
+{
+    std::cout << LOG_PREFIX << "Success" << std::endl;
+}
+
+void ConsoleLogger::LogFailedSetSegment()
+{
+    std::cout << LOG_PREFIX << "Failed segment setting, incorrect value" << std::endl;
+}
+
+void ConsoleLogger::LogSegment(const std::string& path, int modeNumber, long long frameNumber, double startTime, double endTime)
+{
+    std::cout << LOG_PREFIX << "Segment frames: " << frameNumber << ", time: " << startTime << " - " << endTime
+              << " s, path: " << path << " mode: " << modeNumber << std::endl;
+}
+
+void ConsoleLogger::LogFailedSegment(const std::string& path)
+{
+    std::cout << LOG_PREFIX << "Failed next segment opening, writing goes on without rotation, path: " << path << std::endl;
+}
+
+void ConsoleLogger::LogFinalized(const std::string& path, double closeTimeMs)
+{
+    std::cout << LOG_PREFIX << "New video: " << path << " (closed in " << closeTimeMs << " ms)" << std::endl;
+}
+
+void ConsoleLogger::LogStartScheduled(long long timestamp)
+{
+    std::cout << LOG_PREFIX << "Writing will start at device time " << timestamp << " us" << std::endl;
+}
+
+void ConsoleLogger::LogStopScheduled(long long timestamp)
+{
+    std::cout << LOG_PREFIX << "Writing will stop at device time " << timestamp << " us" << std::endl;
+}
+
+void ConsoleLogger::LogScheduleCanceled()
+{
+    std::cout << LOG_PREFIX << "Scheduled start canceled" << std::endl;
+}
+
+void ConsoleLogger::LogFailedSchedule()
+{
+    std::cout << LOG_PREFIX << "Failed scheduling, incorrect value" << std::endl;
+}
+
+void ConsoleLogger::LogRecordedFrames(const std::string& path, long long frameNumber, long long firstTimestamp, long long lastTimestamp)
+{
+    std::cout << LOG_PREFIX << "Recorded frames: " << frameNumber << ", device time: " << firstTimestamp << " - " << lastTimestamp
+              << " us, path: " << path << std::endl;
+}
+
+void ConsoleLogger::LogSetGovernor()
+{
+    std::cout << LOG_PREFIX << "Success" << std::endl;
+}
+
+void ConsoleLogger::LogQualityLevel(int oldLevel, int level, double load, long long lostFrameNumber, long long skippedFrameNumber)
+{
+    std::cout << LOG_PREFIX << "Quality level: " << oldLevel << " -> " << level << ", load: " << load
+              << ", lost frames: " << lostFrameNumber << ", skipped color frames: " << skippedFrameNumber << std::endl;
+}
+
+void ConsoleLogger::LogSetPreRoll()
+{
+    std::cout << LOG_PREFIX << "Success" << std::endl;
+}
+
+void ConsoleLogger::LogFailedSetPreRoll()
+{
+    std::cout << LOG_PREFIX << "Failed pre-roll setting, incorrect value" << std::endl;
+}
+
+void ConsoleLogger::LogPreRollFlush(const std::string& path, long long frameNumber, double timeMs)
+{
+    std::cout << LOG_PREFIX << "Pre-roll frames written: " << frameNumber << " in " << timeMs << " ms, path: " << path << std::endl;
+}
+
+void ConsoleLogger::LogSetEncodeQueue()
+{
+    std::cout << LOG_PREFIX << "Success" << std::endl;
+}
+
+void ConsoleLogger::LogFailedSetEncodeQueue()
+{
+    std::cout << LOG_PREFIX << "Failed encode queue setting, incorrect value" << std::endl;
+}
+
+void ConsoleLogger::LogSetSpill()
+{
+    std::cout << LOG_PREFIX << "Success" << std::endl;
+}
+
+void ConsoleLogger::LogFailedSetSpill(const std::string& directoryPath)
+{
+    std::cout << LOG_PREFIX << "Failed spill setting, incorrect value or the file can not be created in: " << directoryPath << std::endl;
+}
+
+void ConsoleLogger::LogFailedSetSpillWhenEncoding(long long spilledPendingNumber)
+{
+    std::cout << LOG_PREFIX << "Failed spill setting, the previous recording is still being encoded (spilled frames left: " << spilledPendingNumber << "), try again later" << std::endl;
+}
+
+void ConsoleLogger::LogSpill(const std::string& path)
+{
+    std::cout << LOG_PREFIX << "Encoder is behind, frames go to the spill file, path: " << path << std::endl;
+}
+
+void ConsoleLogger::LogSpillDrained(const std::string& path, long long frameNumber)
+{
+    std::cout << LOG_PREFIX << "Spill file drained, frames: " << frameNumber << ", path: " << path << std::endl;
+}
+
+void ConsoleLogger::LogEncodeDroppedFrames(const std::string& path, long long frameNumber)
+{
+    std::cout << LOG_PREFIX << "Encode queue full, frames dropped: " << frameNumber << ", path: " << path << std::endl;
+}
+
+void ConsoleLogger::LogSetThreads()
+{
+    std::cout << LOG_PREFIX << "Success (from the next file)" << std::endl;
+}
+
+void ConsoleLogger::LogFailedSetThreads()
+{
+    std::cout << LOG_PREFIX << "Failed codec threads setting, incorrect value" << std::endl;
+}
+
+void ConsoleLogger::LogCodecThreads(const std::string& path, int modeNumber, int threadNumber, double costMs)
+{
+    std::cout << LOG_PREFIX << "Codec threads: " << threadNumber << ", measured cost: " << costMs
+              << " thread ms/frame, path: " << path << " mode: " << modeNumber << std::endl;
+}
+
+void ConsoleLogger::LogCodecThreadsStale(const std::string& path, bool rotating)
+{
+    std::cout << LOG_PREFIX << "Codec thread split is stale, "
+              << (rotating ? "the next segment is started with a new split" : "a new split waits for the next file (no segment rotation)")
+              << ", path: " << path << std::endl;
+}
+
+void ConsoleLogger::LogSetAcquisitionThread(int core, bool isolated, bool highPriority)
+{
+    std::cout << LOG_PREFIX << "Acquisition thread core: " << core << (isolated ? " (other threads on the remaining cores)" : "")
+              << ", priority: " << (highPriority ? "high" : "normal") << std::endl;
+}
+
+void ConsoleLogger::LogFailedSetAcquisitionThread(int core)
+{
+    std::cout << LOG_PREFIX << "Failed acquisition thread placement, core: " << core << std::endl;
+}
+
+void ConsoleLogger::LogSetExport()
+{
+    std::cout << LOG_PREFIX << "Success" << std::endl;
+}
+
+void ConsoleLogger::LogFailedSetExport()
+{
+    std::cout << LOG_PREFIX << "Failed export setting, incorrect value" << std::endl;
+}
+
+void ConsoleLogger::LogSetSharedMemory(bool enabled)
+{
+    std::cout << LOG_PREFIX << "Shared memory frames " << (enabled ? "on" : "off") << std::endl;
+}
+
+void ConsoleLogger::LogSetLive(std::string url, std::string format)
+{
+    if (url.empty())
+    {
+        std::cout << LOG_PREFIX << "Live output off" << std::endl;
+    }
+    else
+    {
+        std::cout << LOG_PREFIX << "Live output " << format << " to " << url << " (from the next file)" << std::endl;
+    }
+}
+
+void ConsoleLogger::LogSetMirror(std::string directoryPath)
+{
+    if (directoryPath.empty())
+    {
+        std::cout << LOG_PREFIX << "Mirror off" << std::endl;
+    }
+    else
+    {
+        std::cout << LOG_PREFIX << "Mirror to " << directoryPath << " (from the next file)" << std::endl;
+    }
+}
+
+void ConsoleLogger::LogFailedAddOutput(std::string path)
+{
+    std::cout << LOG_PREFIX << "Failed additional output " << path << ", the recording goes on without it" << std::endl;
+}
+
+void ConsoleLogger::LogSetProxy(bool enabled)
+{
+    std::cout << LOG_PREFIX << "Proxy files " << (enabled ? "on" : "off") << std::endl;
+}
+
+void ConsoleLogger::LogFailedProxy(std::string path)
+{
+    std::cout << LOG_PREFIX << "Failed proxy file " << path << ", the recording goes on without it" << std::endl;
+}
+
+void ConsoleLogger::LogFailedSetLive()
+{
+    std::cout << LOG_PREFIX << "Failed live output setting, incorrect value" << std::endl;
+}
+
 void ConsoleLogger::LogKinectOff()
 {
 	std::cout << LOG_PREFIX << "Error: failed Kinect2Wrapper Update" << std::endl;
@@ -120,7 +460,7 @@ void ConsoleLogger::LogFailedStartWhenAddVideoStream(const std::string& path, in
 void ConsoleLogger::LogStop(const std::string& path)
 {
 	std::cout << LOG_PREFIX << "Writing OFF" << std::endl;
-	std::cout << LOG_PREFIX << "New video: " << path << std::endl;
+	std::cout << LOG_PREFIX << "Closing video: " << path << std::endl;
 }
 
 void ConsoleLogger::LogFailedStopWhenClose(const std::string& path)
@@ -28,6 +28,57 @@ public:
 	void LogFailedSetSize();
     void LogSetFPS();
     void LogSetFailedFPSWhenIncorrectValue();
+    void LogSetTimeLapse(int factor);
+    void LogFailedSetTimeLapse();
+    void LogSetTrigger();
+    void LogFailedSetTrigger();
+    void LogTriggerOn();
+    void LogTriggerOff();
+    void LogFailedTriggerWhenNoDepth();
+    void LogSetDuplicateThreshold();
+    void LogFailedSetDuplicateThreshold();
+    void LogSkippedFrames(const std::string& path, int modeNumber, long long number);
+    void LogStats(const kinect2recorder::Kinect2RecorderStats& stats);
+    void LogSetPreview();
+    void LogFailedSetPreview();
+    void LogSetSegment();
+    void LogFailedSetSegment();
+    void LogSegment(const std::string& path, int modeNumber, long long frameNumber, double startTime, double endTime);
+    void LogFailedSegment(const std::string& path);
+    void LogFinalized(const std::string& path, double closeTimeMs);
+    void LogStartScheduled(long long timestamp);
+    void LogStopScheduled(long long timestamp);
+    void LogScheduleCanceled();
+    void LogFailedSchedule();
+    void LogRecordedFrames(const std::string& path, long long frameNumber, long long firstTimestamp, long long lastTimestamp);
+    void LogSetGovernor();
+    void LogQualityLevel(int oldLevel, int level, double load, long long lostFrameNumber, long long skippedFrameNumber);
+    void LogSetPreRoll();
+    void LogFailedSetPreRoll();
+    void LogPreRollFlush(const std::string& path, long long frameNumber, double timeMs);
+    void LogSetEncodeQueue();
+    void LogFailedSetEncodeQueue();
+    void LogSetSpill();
+    void LogFailedSetSpill(const std::string& directoryPath);
+    void LogFailedSetSpillWhenEncoding(long long spilledPendingNumber);
+    void LogSpill(const std::string& path);
+    void LogSpillDrained(const std::string& path, long long frameNumber);
+    void LogEncodeDroppedFrames(const std::string& path, long long frameNumber);
+    void LogSetThreads();
+    void LogFailedSetThreads();
+    void LogCodecThreads(const std::string& path, int modeNumber, int threadNumber, double costMs);
+    void LogCodecThreadsStale(const std::string& path, bool rotating);
+    void LogSetAcquisitionThread(int core, bool isolated, bool highPriority);
+    void LogFailedSetAcquisitionThread(int core);
+    void LogSetExport();
+    void LogFailedSetExport();
+    void LogSetSharedMemory(bool enabled);
+    void LogSetLive(std::string url, std::string format);
+    void LogFailedSetLive();
+    void LogSetMirror(std::string directoryPath);
+    void LogFailedAddOutput(std::string path);
+    void LogSetProxy(bool enabled);
+    void LogFailedProxy(std::string path);
 	void LogKinectOff();
 	void LogFailedWrite(const std::string& path, int modeNumber);
 	void LogStart(const std::string& path);
@@ -7,42 +7,180 @@
 #include "Kinect2Recorder.h"
 #include "mat-stream/Kinect2RgbMatStream.h"
 #include "mat-stream/Kinect2Gray16MatStream.h"
+#include "mat-stream/SyntheticMatStream.h"
+#include "pipeline/PreviewSinkNode.h"
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include "VideoIO/VideoWriter.h"
 #include <iostream>
+#include <fstream>
 #include <ctime>
+#include <algorithm>
+#include <cmath>
 
 namespace kinect2recorder
 {
 
-    Kinect2Recorder::Kinect2Recorder(Kinect2RecorderLogger& kinect2RecorderLogger) :
+    Kinect2Recorder::Kinect2Recorder(Kinect2RecorderLogger& kinect2RecorderLogger, bool synthetic, bool headless) :
             _active(false),
             _writing(false),
             _pKinect2Wrapper(nullptr),
+            _pSyntheticSource(nullptr),
             _fps(DEFAULT_FPS),
+            _timeLapseFactor(1),
+            _timeLapseMethod(TimeLapseAccumulator::METHOD_NTH),
+            _triggerArmed(false),
+            _triggerThreshold(DEFAULT_TRIGGER_THRESHOLD),
+            _triggerPreSeconds(DEFAULT_TRIGGER_PRE_SECONDS),
+            _triggerPostSeconds(DEFAULT_TRIGGER_POST_SECONDS),
+            _pActivityDetector(nullptr),
+            _triggerActivityTimestamp(-1),
+            _preRoll(),
+            _preRollSeconds(0),
+            _preRollMaxMegabytes(DEFAULT_PRE_ROLL_MAX_MEGABYTES),
+            _duplicateThreshold(-1.0),
             _directoryPath(DEFAULT_DIRECTORY_PATH),
             _lastPath(),
+            _liveUrl(),
+            _liveFormat(),
+            _mirrorDirectoryPath(),
             _pVideoWriter(nullptr),
+            _segmentSeconds(0),
+            _segmentMegabytes(0),
+            _segmentTimer(),
+            _segmentFailed(false),
+            _resplitPending(false),
+            _resplitReported(false),
+            _writingFrameRate(DEFAULT_FPS),
+            _writerPreparer(),
+            _writerFinalizer(MAX_PENDING_FINALIZATIONS),
+            _encodeQueue(),
+            _proxyWriter(PROXY_MAX_FRAMES),
+            _proxyEnabled(false),
+            _encodeQueueMegabytes(DEFAULT_ENCODE_QUEUE_MEGABYTES),
+            _spillDirectoryPath(),
+            _spillMaxMegabytes(DEFAULT_SPILL_MAX_MEGABYTES),
+            _spilling(false),
+            _spillFrameNumber(0),
+            _droppingNumber(0),
+            _threadBudget(MODES_NUMBER),
+            _updateEnd(),
+            _updateEnded(false),
             _logger(kinect2RecorderLogger),
-            _mseconds(0),
-            _elapsedTimer(),
-            _isTimer(false),
-            _mutex()
+            _frameTimestamp(-1),
+            _startTimestamp(-1),
+            _stopTimestamp(-1),
+            _stopDuration(-1),
+            _frameLimit(-1),
+            _liveFrameNumber(0),
+            _firstFrameTimestamp(-1),
+            _lastFrameTimestamp(-1),
+            _preview(),
+            _previewRate(0),
+            _pipeline(),
+            _pipelineInput(-1),
+            _pipelineFrameNumber(0),
+            _pExportResizeNode(nullptr),
+            _pImageExportNode(nullptr),
+            _pFrameSubscribers(nullptr),
+            _pSharedFrameSinkNode(nullptr),
+            _matsAdopted(false),
+            _qualityGovernor(),
+            _governorEnabled(true),
+            _colorBitRate(-1),
+            _colorRateDivisor(1),
+            _colorFrameCounter(0),
+            _frameLostNumber(0),
+            _lostFrameNumber(0),
+            _governorSkippedNumber(0),
+            _deactivating(false),
+            _status(0),
+            _commandQueue(),
+            _postNumber(0),
+            _postTimeSumNs(0),
+            _postTimeMaxNs(0),
+            _stats()
     {
-        try
+        if (synthetic)
+        {
+            _pSyntheticSource = new SyntheticSource(SyntheticSource::DEFAULT_FPS);
+            _pFrameStreams[0] = new SyntheticMatStream(_pSyntheticSource, false, cv::Size(SYNTHETIC_COLOR_WIDTH, SYNTHETIC_COLOR_HEIGHT));
+            _pFrameStreams[1] = new SyntheticMatStream(_pSyntheticSource, true, cv::Size(SYNTHETIC_DEPTH_WIDTH, SYNTHETIC_DEPTH_HEIGHT));
+        }
+        else
+        {
+            try
+            {
+                _pKinect2Wrapper = new kinect2reader::Kinect2Wrapper();
+            }
+            catch (kinect2reader::Kinect2WrapperInitException)
+            {
+                _logger.LogFailedInit();
+                throw Kinect2RecorderInitException();
+            }
+            _pFrameStreams[0] = new RgbMatStream(_pKinect2Wrapper);
+            _pFrameStreams[1] = new Gray16MatStream(_pKinect2Wrapper);
+        }
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            _previewWindows[i] = _preview.AddWindow(_windowNames[i], _modes[i] == MODE_DEPTH);
+        }
+        if (!headless)
+        {
+            _preview.Start();
+        }
+        _previewRate = _preview.GetRate();
+        _pipelineInput = _pipeline.AddNode("input", new InputNode(), PIPELINE_INPUT_QUEUE);
+        for (int i = 0; i < MODES_NUMBER; i++)
         {
-            _pKinect2Wrapper = new kinect2reader::Kinect2Wrapper();
+            int previewNode = _pipeline.AddNode("preview " + _windowNames[i],
+                new PreviewSinkNode(_preview, _previewWindows[i], i), PIPELINE_PREVIEW_QUEUE);
+            _pipeline.Connect(_pipelineInput, previewNode);
         }
-        catch (kinect2reader::Kinect2WrapperInitException)
+        _pExportResizeNode = new ResizeNode(0);
+        int exportResizeNode = _pipeline.AddNode("export resize", _pExportResizeNode, PIPELINE_EXPORT_QUEUE);
+        _pImageExportNode = new ImageExportNode();
+        int exportNode = _pipeline.AddNode("export", _pImageExportNode, PIPELINE_EXPORT_QUEUE);
+        _pipeline.Connect(_pipelineInput, exportResizeNode);
+        _pipeline.Connect(exportResizeNode, exportNode);
+        _pFrameSubscribers = new FrameSubscribers();
+        int subscribersNode = _pipeline.AddNode("subscribers", _pFrameSubscribers, PIPELINE_SUBSCRIBERS_QUEUE);
+        _pipeline.Connect(_pipelineInput, subscribersNode);
+        std::vector<bool> depths;
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            depths.push_back(_modes[i] == MODE_DEPTH);
+        }
+        _pSharedFrameSinkNode = new SharedFrameSinkNode(depths);
+        int sharedMemoryNode = _pipeline.AddNode("shared memory", _pSharedFrameSinkNode, PIPELINE_SHARED_MEMORY_QUEUE);
+        _pipeline.Connect(_pipelineInput, sharedMemoryNode);
+        _pipeline.Start(PIPELINE_THREAD_NUMBER);
+        for (int i = 0; i < MODES_NUMBER; i++)
         {
-            _logger.LogFailedInit();
-            throw Kinect2RecorderInitException();
+            std::vector<int> params;
+            if (_modes[i] == MODE_DEPTH)
+            {
+                /* Lossless, depth values must survive the pre-roll */
+                params.push_back(cv::IMWRITE_PNG_COMPRESSION);
+                params.push_back(PRE_ROLL_PNG_COMPRESSION);
+            }
+            else
+            {
+                params.push_back(cv::IMWRITE_JPEG_QUALITY);
+                params.push_back(PRE_ROLL_JPEG_QUALITY);
+            }
+            _preRoll.AddStream(_pre_roll_extensions[i], params);
         }
-        _pFrameStreams[0] = new RgbMatStream(_pKinect2Wrapper);
-        _pFrameStreams[1] = new Gray16MatStream(_pKinect2Wrapper);
+        _preRoll.Start();
+        _writerFinalizer.Start();
+        _encodeQueue.SetMaxBytes(static_cast<size_t>(_encodeQueueMegabytes) * 1024 * 1024);
+        _encodeQueue.Start();
+        _proxyWriter.Start();
+        /* One core is left for acquisition and preview */
+        _threadBudget.SetThreadNumber(std::max(1, cv::getNumberOfCPUs() - 1));
         _active = true;
+        PublishStatus();
         _logger.LogInit();
     }
 
@@ -53,18 +191,32 @@ namespace kinect2recorder
 
     void Kinect2Recorder::InnerDeactivate()
     {
+        _writerPreparer.Discard();
         if (_pVideoWriter != nullptr)
         {
-            try
-            {
-                _pVideoWriter->close();
-            }
-            catch (...)
-            {
-
-            }
-            delete(_pVideoWriter);
+            video_io::VideoWriter * pVideoWriter = _pVideoWriter;
+            std::string path = _lastPath;
+            _encodeQueue.Call([this, pVideoWriter, path]() { _writerFinalizer.Finalize(pVideoWriter, path); });
             _pVideoWriter = nullptr;
+            _writing = false;
+        }
+        /* Waits for every queued frame (spilled ones too), then for every pending finalization */
+        _encodeQueue.Stop();
+        _encodeQueue.SetSpill(std::string(), 0);
+        _proxyWriter.Stop();
+        InnerPollEncodeQueue();
+        _writerFinalizer.Stop();
+        InnerPollFinalizer();
+        _pipeline.Stop();
+        _preview.Stop();
+        DeleteTimeLapseAccumulators();
+        DeleteDuplicateFrameFilters();
+        _triggerArmed = false;
+        _preRoll.Stop();
+        if (_pActivityDetector != nullptr)
+        {
+            delete(_pActivityDetector);
+            _pActivityDetector = nullptr;
         }
         if (_pFrameStreams[0] != nullptr)
         {
@@ -81,7 +233,14 @@ namespace kinect2recorder
             delete(_pKinect2Wrapper);
             _pKinect2Wrapper = nullptr;
         }
+        if (_pSyntheticSource != nullptr)
+        {
+            delete(_pSyntheticSource);
+            _pSyntheticSource = nullptr;
+        }
+        _startTimestamp = -1;
         _active = false;
+        PublishStatus();
         _logger.LogNotActive();
     }
 
@@ -110,81 +269,153 @@ namespace kinect2recorder
             _logger.LogFailedStartWhenNoneMode();
             return false;
         }
-        _pVideoWriter = new video_io::VideoWriter();
-        std::time_t time;
-        std::tm* timeinfo;
-        char nameBuffer [80];
-        std::time(&time);
-        timeinfo = std::localtime(&time);
-        std::strftime(nameBuffer,80,"%Y-%m-%d-%H-%M-%S",timeinfo);
-        _lastPath = _directoryPath + std::string(nameBuffer) + std::string(".") + _extension;
-        try
-        {
-            _pVideoWriter->open(_lastPath.c_str());
-        }
-        catch (...)
-        {
-            _logger.LogFailedStartWhenOpenWithPath(_lastPath);
-            return false;
-        }
-        try
-        {
-            video_io::Metadata metadata;
-            metadata.insert(video_io::Metadata::value_type("title", "title"));
-            metadata.insert(video_io::Metadata::value_type("Camera0", "f: 1000, k: 1, m0: (255, 270), gamma: 1"));
-            metadata.insert(video_io::Metadata::value_type("Camera1", "f: 2000, k: 1, m0: (235, 288), gamma: 1"));
-            metadata.insert(video_io::Metadata::value_type("Camera2", "f: 2500, k: 1, m0: (225, 271), gamma: 1"));
-            _pVideoWriter->setMetadata(metadata);
-        }
-        catch (...)
+        _lastPath = InnerNextPath();
+        std::vector<int> streamModeNumbers;
+        std::vector<video_io::VideoWriter::VideoStreamParams> params = InnerGetVideoStreamParams(streamModeNumbers);
+        int failure;
+        int failedStreamNumber;
+        _pVideoWriter = WriterPreparer::Open(_lastPath, InnerGetMetadata(), params, failure, failedStreamNumber);
+        if (_pVideoWriter == nullptr)
         {
-            _logger.LogFailedStartWhenOpenWithPath(_lastPath);
-            try
+            if (failure == WriterPreparer::FAILED_ADD_VIDEO_STREAM)
             {
-                _pVideoWriter->close();
+                _logger.LogFailedStartWhenAddVideoStream(_lastPath, streamModeNumbers[failedStreamNumber]);
             }
-            catch (...)
+            else
             {
+                _logger.LogFailedStartWhenOpenWithPath(_lastPath);
             }
-            delete(_pVideoWriter);
-            _pVideoWriter = nullptr;
             return false;
         }
-
-        for (int i = 0; i < MODES_NUMBER; i++)
+        if (_timeLapseFactor > 1)
         {
-            try
+            for (int i = 0; i < MODES_NUMBER; i++)
             {
                 if (_modesActivity[i])
                 {
-                    video_io::VideoWriter::VideoStreamParams videoStreamParams;
-                    videoStreamParams.codecName = _codec_names[i];
-                    videoStreamParams.pixelFormat = _pix_fmt_names[i];
-                    videoStreamParams.frameRate = _fps;
-                    videoStreamParams.width = _pFrameStreams[i]->GetWidth();
-                    videoStreamParams.height = _pFrameStreams[i]->GetHeight();
-                    videoStreamParams.findBestPixelFormat = false;
-                    _pVideoWriter->addVideoStream(videoStreamParams);
+                    /* The median window holds factor frames: depth only, color takes the mean */
+                    int method = _timeLapseMethod;
+                    if (method == TimeLapseAccumulator::METHOD_MEDIAN && _modes[i] != MODE_DEPTH)
+                    {
+                        method = TimeLapseAccumulator::METHOD_MEAN;
+                    }
+                    _pTimeLapseAccumulators[i] = new TimeLapseAccumulator(_timeLapseFactor, method, _modes[i] == MODE_DEPTH);
                 }
             }
-            catch (...)
+        }
+        if (_duplicateThreshold >= 0)
+        {
+            for (int i = 0; i < MODES_NUMBER; i++)
             {
-                _logger.LogFailedStartWhenAddVideoStream(_lastPath, i);
-                try
-                {
-                    _pVideoWriter->close();
-                }
-                catch (...)
+                if (_modesActivity[i])
                 {
+                    _pDuplicateFrameFilters[i] = new DuplicateFrameFilter(_duplicateThreshold);
                 }
-                delete(_pVideoWriter);
-                _pVideoWriter = nullptr;
-                return false;
             }
         }
+        InnerAddOutputs(_pVideoWriter, _lastPath);
+        InnerOpenProxy(_lastPath, std::vector<double>(params.size(), 0.0));
+        _segmentTimer.restart();
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            _segmentStartTimes[i] = 0.0;
+        }
+        _segmentFailed = false;
+        _writingFrameRate = params[0].frameRate;
+        InnerSetStreamThreadNumbers();
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            _segmentFrameNumbers[i] = 0;
+            _segmentTickNumbers[i] = 0;
+        }
+        _liveFrameNumber = 0;
+        _firstFrameTimestamp = -1;
+        _lastFrameTimestamp = -1;
+        int colorStreamNumber = InnerGetVideoStreamNumber(0);
+        _colorBitRate = colorStreamNumber >= 0 ? _pVideoWriter->bitRate(colorStreamNumber) : -1;
+        _colorFrameCounter = 0;
+        _lostFrameNumber = 0;
+        _governorSkippedNumber = 0;
+        _qualityGovernor.Reset();
+        InnerApplyQualityLevel();
         return true;
     }
 
+    std::string Kinect2Recorder::InnerNextPath()
+    {
+        std::time_t time;
+        std::tm* timeinfo;
+        char nameBuffer [80];
+        std::time(&time);
+        timeinfo = std::localtime(&time);
+        std::strftime(nameBuffer,80,"%Y-%m-%d-%H-%M-%S",timeinfo);
+        std::string basePath = _directoryPath + std::string(nameBuffer);
+        std::string path = basePath + std::string(".") + _extension;
+        /* Several recordings may start within one second (activity trigger, segments) */
+        for (int n = 1; std::ifstream(path).good(); n++)
+        {
+            path = basePath + std::string("-") + std::to_string(n) + std::string(".") + _extension;
+        }
+        return path;
+    }
+
+    video_io::Metadata Kinect2Recorder::InnerGetMetadata()
+    {
+        video_io::Metadata metadata;
+        metadata.insert(video_io::Metadata::value_type("title", "title"));
+        metadata.insert(video_io::Metadata::value_type("Camera0", "f: 1000, k: 1, m0: (255, 270), gamma: 1"));
+        metadata.insert(video_io::Metadata::value_type("Camera1", "f: 2000, k: 1, m0: (235, 288), gamma: 1"));
+        metadata.insert(video_io::Metadata::value_type("Camera2", "f: 2500, k: 1, m0: (225, 271), gamma: 1"));
+        return metadata;
+    }
+
+    std::vector<video_io::VideoWriter::VideoStreamParams> Kinect2Recorder::InnerGetVideoStreamParams(std::vector<int>& streamModeNumbers)
+    {
+        std::vector<video_io::VideoWriter::VideoStreamParams> params;
+        streamModeNumbers.clear();
+        std::vector<double> pixelNumbers;
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            if (_modesActivity[i])
+            {
+                streamModeNumbers.push_back(i);
+                pixelNumbers.push_back(static_cast<double>(_pFrameStreams[i]->GetWidth()) * _pFrameStreams[i]->GetHeight());
+            }
+        }
+        std::vector<int> threadNumbers = _threadBudget.Allocate(streamModeNumbers, pixelNumbers);
+        for (size_t n = 0; n < streamModeNumbers.size(); n++)
+        {
+            int i = streamModeNumbers[n];
+            video_io::VideoWriter::VideoStreamParams videoStreamParams;
+            videoStreamParams.codecName = _codec_names[i];
+            videoStreamParams.pixelFormat = _pix_fmt_names[i];
+            videoStreamParams.inputPixelFormat = _input_pix_fmt_names[i];
+            videoStreamParams.frameRate = static_cast<double>(_fps) / _timeLapseFactor;
+            videoStreamParams.width = _pFrameStreams[i]->GetWidth();
+            videoStreamParams.height = _pFrameStreams[i]->GetHeight();
+            videoStreamParams.findBestPixelFormat = false;
+            videoStreamParams.nbThreads = threadNumbers[n];
+            videoStreamParams.interp = CONVERSION_INTERP;
+            videoStreamParams.accurateRounding = CONVERSION_ACCURATE_ROUNDING;
+            videoStreamParams.maxFramesInFlight = ENCODER_FRAMES_IN_FLIGHT;
+            if (!_liveUrl.empty() && _modes[i] == MODE_COLOR)
+            {
+                /* No B-frames: a packet leaves with its frame; a key frame every second for the receivers joining later */
+                videoStreamParams.codecName = _live_codec_name;
+                videoStreamParams.maxBFrames = 0;
+                videoStreamParams.gopSize = std::max(1, static_cast<int>(videoStreamParams.frameRate + 0.5));
+            }
+            /* The level when the next segment is prepared */
+            if (_writing && _modes[i] == MODE_COLOR && _colorBitRate > 0 &&
+                _qualityGovernor.GetLevel() >= QualityGovernor::LEVEL_LOW_BIT_RATE)
+            {
+                videoStreamParams.bitRate = _colorBitRate / 2;
+            }
+            params.push_back(videoStreamParams);
+        }
+        return params;
+    }
+
     bool Kinect2Recorder::InnerStop()
     {
         if (!_active)
@@ -197,277 +428,1634 @@ namespace kinect2recorder
             _logger.LogFailedWhenWritingOff();
             return false;
         }
-        _isTimer = false;
-        try
-        {
-            _pVideoWriter->close();
-        }
-        catch (...)
+        _stopTimestamp = -1;
+        _stopDuration = -1;
+        _frameLimit = -1;
+        if (_liveFrameNumber > 0)
         {
-            _logger.LogFailedStopWhenClose(_lastPath);
-            delete(_pVideoWriter);
-            _pVideoWriter = nullptr;
-            _writing = false;
-            return false;
+            _logger.LogRecordedFrames(_lastPath, _liveFrameNumber, _firstFrameTimestamp, _lastFrameTimestamp);
         }
-        delete(_pVideoWriter);
+        _writerPreparer.Discard();
+        DeleteTimeLapseAccumulators();
+        DeleteDuplicateFrameFilters();
+        InnerLogSegment();
+        /* Closing may take seconds on a large file, it is reported later by InnerPollFinalizer.
+           The writer is handed over after its queued frames are encoded */
+        video_io::VideoWriter * pVideoWriter = _pVideoWriter;
+        std::string path = _lastPath;
+        _encodeQueue.Call([this, pVideoWriter, path]() { _writerFinalizer.Finalize(pVideoWriter, path); });
+        _proxyWriter.Close();
         _pVideoWriter = nullptr;
         _writing = false;
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            _streamThreadNumbers[i] = 0;
+        }
+        _qualityGovernor.Reset();
+        InnerApplyQualityLevel();
         _logger.LogStop(_lastPath);
         return true;
     }
 
-    bool Kinect2Recorder::IsActive()
+    /* Counted when frames are queued, the encoder may still be behind */
+    void Kinect2Recorder::InnerLogSegment()
     {
-        return _active;
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            if (_modesActivity[i])
+            {
+                _logger.LogSegment(_lastPath, i, _segmentFrameNumbers[i],
+                    _segmentStartTimes[i], _segmentStartTimes[i] + _segmentTickNumbers[i] / _writingFrameRate);
+            }
+        }
     }
 
-    void Kinect2Recorder::SetDirectoryPath(std::string directoryPath)
+    /* The next file is opened a little before the limit, the switch happens when it is ready, so no frame is lost */
+    void Kinect2Recorder::InnerUpdateSegment()
     {
-        _mutex.lock();
-        if (!_active)
+        if (!_writing || _segmentFailed || (_segmentSeconds <= 0 && _segmentMegabytes <= 0))
         {
-            _logger.LogFailedWhenNotActive();
-            _mutex.unlock();
             return;
         }
-        if (_writing)
+        long long elapsed = _segmentTimer.elapsed();
+        long long bytes = _encodeQueue.GetBytesWritten(_pVideoWriter);
+        long long maxBytes = static_cast<long long>(_segmentMegabytes) * 1024 * 1024;
+        bool full = _resplitPending || (_segmentSeconds > 0 && elapsed >= 1000LL * _segmentSeconds) ||
+            (maxBytes > 0 && bytes >= maxBytes);
+        bool nearlyFull = full ||
+            (_segmentSeconds > 0 && elapsed >= 1000LL * _segmentSeconds - SEGMENT_PREPARE_LEAD_MSECONDS) ||
+            (maxBytes > 0 && bytes >= maxBytes / 100 * SEGMENT_PREPARE_PERCENT);
+        if (nearlyFull && !_writerPreparer.IsPreparing())
         {
-            _logger.LogFailedWhenWritingOn();
-            _mutex.unlock();
-            return;
+            std::vector<int> streamModeNumbers;
+            _writerPreparer.Prepare(InnerNextPath(), InnerGetMetadata(), InnerGetVideoStreamParams(streamModeNumbers));
+        }
+        if (full && _writerPreparer.IsReady())
+        {
+            InnerSwitchSegment();
         }
-        _directoryPath = directoryPath + std::string("\\");
-        _logger.LogDirectoryPath(directoryPath);
-        _mutex.unlock();
     }
 
-    void Kinect2Recorder::SetMode(int mode)
+    void Kinect2Recorder::InnerSwitchSegment()
     {
-        _mutex.lock();
-        if (!_active)
+        std::string nextPath = _writerPreparer.GetPath();
+        int failure;
+        int failedStreamNumber;
+        video_io::VideoWriter * pNextVideoWriter = _writerPreparer.Take(failure, failedStreamNumber);
+        if (pNextVideoWriter == nullptr)
         {
-            _logger.LogFailedWhenNotActive();
-            _mutex.unlock();
-            return;
-        }
-        if (_writing)
-        {
-            _logger.LogFailedWhenWritingOn();
-            _mutex.unlock();
+            /* The current file goes on without rotation */
+            _segmentFailed = true;
+            _logger.LogFailedSegment(nextPath);
             return;
         }
-        DWORD frameSourceTypes = FrameSourceTypes::FrameSourceTypes_None;
-        for (int i = 0; i < MODES_NUMBER; i++)
-        {
-            _modesActivity[i] = false;
-        }
+        /* Every stream of the next file continues its own timestamps of the previous one (the streams may have
+           different ticks), the next writer is not queued yet */
+        double startTimes[MODES_NUMBER];
+        std::vector<double> streamStartTimes;
         for (int i = 0; i < MODES_NUMBER; i++)
         {
-            if (_modes[i] & mode)
+            startTimes[i] = _segmentStartTimes[i] + _segmentTickNumbers[i] / _writingFrameRate;
+            if (_modesActivity[i])
             {
-                _modesActivity[i] = true;
-                frameSourceTypes = frameSourceTypes | _frame_source_types[i];
+                pNextVideoWriter->setStartTime(static_cast<int>(streamStartTimes.size()), startTimes[i]);
+                streamStartTimes.push_back(startTimes[i]);
             }
         }
-        try
+        InnerAddOutputs(pNextVideoWriter, nextPath);
+        InnerOpenProxy(nextPath, streamStartTimes);
+        InnerLogSegment();
+        video_io::VideoWriter * pVideoWriter = _pVideoWriter;
+        std::string path = _lastPath;
+        _encodeQueue.Call([this, pVideoWriter, path]() { _writerFinalizer.Finalize(pVideoWriter, path); });
+        for (int i = 0; i < MODES_NUMBER; i++)
         {
-            _pKinect2Wrapper->SetFrameSourceTypes(frameSourceTypes);
+            _segmentFrameNumbers[i] = 0;
+            _segmentTickNumbers[i] = 0;
         }
-        catch (kinect2reader::Kinect2WrapperFailedException)
+        _pVideoWriter = pNextVideoWriter;
+        _lastPath = nextPath;
+        InnerSetStreamThreadNumbers();
+        for (int i = 0; i < MODES_NUMBER; i++)
         {
-            _logger.LogFailedSetMode();
-            InnerDeactivate();
-            _mutex.unlock();
-            return;
+            _segmentStartTimes[i] = startTimes[i];
         }
-        _logger.LogSetMode();
-        _mutex.unlock();
+        _segmentTimer.restart();
+        InnerApplyQualityLevel();
+        _logger.LogStart(_lastPath);
     }
 
-    void Kinect2Recorder::SetSize(int mode, int width, int height)
+    void Kinect2Recorder::InnerPollFinalizer()
     {
-        _mutex.lock();
-        if (!_active)
+        WriterFinalizer::Result result;
+        while (_writerFinalizer.Poll(result))
         {
-            _logger.LogFailedWhenNotActive();
-            _mutex.unlock();
-            return;
+            _stats.finalizedNumber++;
+            if (result.closeTimeMs > _stats.finalizeTimeMaxMs)
+            {
+                _stats.finalizeTimeMaxMs = result.closeTimeMs;
+            }
+            if (result.closed)
+            {
+                _logger.LogFinalized(result.path, result.closeTimeMs);
+            }
+            else
+            {
+                _logger.LogFailedStopWhenClose(result.path);
+            }
         }
-        if (_writing)
+    }
+
+    void Kinect2Recorder::InnerPollEncodeQueue()
+    {
+        int modeNumber;
+        while (_encodeQueue.TakeFailure(modeNumber))
         {
-            _logger.LogFailedWhenWritingOn();
-            _mutex.unlock();
-            return;
+            _logger.LogFailedWrite(_lastPath, modeNumber);
         }
-        if (width <= 0 || height <= 0)
+        std::string proxyPath;
+        while (_proxyWriter.TakeFailure(proxyPath))
         {
-            _logger.LogFailedSetSize();
-            _mutex.unlock();
-            return;
+            _logger.LogFailedProxy(proxyPath);
         }
-        cv::Size size(width, height);
-        for(int i = 0; i < MODES_NUMBER; i++)
+        long long flushFrameNumber;
+        double flushTimeMs;
+        while (_preRoll.TakeFlush(flushFrameNumber, flushTimeMs))
         {
-            if (_modes[i] & mode)
+            _stats.preRollFlushNumber++;
+            if (flushTimeMs > _stats.preRollFlushTimeMaxMs)
             {
-                _pFrameStreams[i]->SetSize(size);
+                _stats.preRollFlushTimeMaxMs = flushTimeMs;
             }
+            _logger.LogPreRollFlush(_lastPath, flushFrameNumber, flushTimeMs);
         }
-        _logger.LogSetSize();
-        _mutex.unlock();
-    }
-
-    void Kinect2Recorder::SetFPS(int fps)
-    {
-        _mutex.lock();
-        if (fps <= 0)
+        long long spilledNumber;
+        long long droppedNumber;
+        _encodeQueue.TakeStats(spilledNumber, droppedNumber);
+        _stats.encodeSpilledNumber += spilledNumber;
+        _stats.encodeDroppedNumber += droppedNumber;
+        _spillFrameNumber += spilledNumber;
+        /* Reported once, when the spill file is drained or when dropping ends */
+        bool spilling = _encodeQueue.GetSpilledPendingNumber() > 0;
+        if (spilling && !_spilling)
         {
-            _logger.LogSetFailedFPSWhenIncorrectValue();
-            _mutex.unlock();
-            return;
+            _logger.LogSpill(_lastPath);
         }
-        _fps = fps;
-        _logger.LogSetFPS();
-        _mutex.unlock();
-    }
-
-    void Kinect2Recorder::Update()
-    {
-        _mutex.lock();
-        if (!_active)
+        if (!spilling && _spilling)
         {
-            _mutex.unlock();
-            return;
+            _logger.LogSpillDrained(_lastPath, _spillFrameNumber);
+            _spillFrameNumber = 0;
         }
-        if (_isTimer)
+        _spilling = spilling;
+        /* Costs measured with the threads of the current file, they set the split of the next one */
+        std::vector<double> encodeTimeSumsMs;
+        std::vector<long long> encodedNumbers;
+        _encodeQueue.TakeModeStats(encodeTimeSumsMs, encodedNumbers);
+        for (size_t i = 0; i < encodedNumbers.size(); i++)
         {
-            if (_elapsedTimer.elapsed() >= _mseconds)
+            if (encodedNumbers[i] > 0)
             {
-                InnerStop();
+                _threadBudget.Report(static_cast<int>(i), encodeTimeSumsMs[i] / encodedNumbers[i], _streamThreadNumbers[i]);
+                _stats.encodedNumbers[i] += encodedNumbers[i];
+                _stats.encodeTimeSumsMs[i] += encodeTimeSumsMs[i];
             }
         }
-        for(int i = 0; i < MODES_NUMBER; i++)
+        InnerCheckThreadSplit();
+        _droppingNumber += droppedNumber;
+        if (droppedNumber == 0 && _droppingNumber > 0)
         {
-            if (_oldModesActivity[i] != _modesActivity[i])
-            {
-                if (_oldModesActivity[i])
-                {
-                    cv::destroyWindow(_windowNames[i]);
-                }
-                _oldModesActivity[i] = _modesActivity[i];
-            }
+            _logger.LogEncodeDroppedFrames(_lastPath, _droppingNumber);
+            _droppingNumber = 0;
         }
-        try
+    }
+
+    /* The writer is not queued yet, so it is read here */
+    void Kinect2Recorder::InnerSetStreamThreadNumbers()
+    {
+        _resplitPending = false;
+        _resplitReported = false;
+        int videoStreamNumber = 0;
+        for (int i = 0; i < MODES_NUMBER; i++)
         {
-            _pKinect2Wrapper->Update();
+            _streamThreadNumbers[i] = 0;
+            if (_modesActivity[i])
+            {
+                _streamThreadNumbers[i] = _pVideoWriter->nbThreads(videoStreamNumber);
+                _logger.LogCodecThreads(_lastPath, i, _streamThreadNumbers[i], _threadBudget.GetCost(i));
+                videoStreamNumber++;
+            }
         }
-        catch(kinect2reader::Kinect2WrapperFailedException)
+    }
+
+    /* The costs measured with the threads of the current file may ask for another split, a codec takes its threads
+       only when opened: the next segment is started early, without rotation the split waits for the next file */
+    void Kinect2Recorder::InnerCheckThreadSplit()
+    {
+        if (!_writing || _resplitPending || _resplitReported || _segmentTimer.elapsed() < RESPLIT_MIN_MSECONDS)
         {
-            _logger.LogKinectOff();
-            InnerDeactivate();
-            _mutex.unlock();
             return;
         }
-        cv::Mat * mats[MODES_NUMBER];
-        bool allMats = true;
+        std::vector<int> streamModeNumbers;
         for (int i = 0; i < MODES_NUMBER; i++)
         {
-            mats[i] = nullptr;
             if (_modesActivity[i])
             {
-                cv::Mat * pMat = _pFrameStreams[i]->GetMat();
-                if (pMat != nullptr)
-                {
-                    mats[i] = pMat;
-                }
-                else
-                {
-                    allMats = false;
-                }
+                streamModeNumbers.push_back(i);
             }
         }
-        for (int i = 0; i < MODES_NUMBER; i++)
+        if (!_threadBudget.IsStale(streamModeNumbers))
         {
-            if (mats[i] != nullptr)
-            {
-                cv::imshow(_windowNames[i], *(mats[i]));
-                cv::waitKey(1);
-            }
+            return;
         }
-        if (_writing && allMats)
+        bool rotating = !_segmentFailed && (_segmentSeconds > 0 || _segmentMegabytes > 0);
+        _resplitPending = rotating;
+        _resplitReported = true;
+        _logger.LogCodecThreadsStale(_lastPath, rotating);
+    }
+
+    void Kinect2Recorder::DeleteTimeLapseAccumulators()
+    {
+        for (int i = 0; i < MODES_NUMBER; i++)
         {
-            int videoStreamNumber = 0;
-            for(int i = 0; i < MODES_NUMBER; i++)
+            if (_pTimeLapseAccumulators[i] != nullptr)
             {
-                if (_modesActivity[i])
-                {
-                    try
-                    {
-                        _pVideoWriter->write(*(mats[i]), videoStreamNumber);
-                    }
-                    catch (...)
-                    {
-                        _logger.LogFailedWrite(_lastPath, i);
-                    }
-                    videoStreamNumber++;
-                }
+                delete(_pTimeLapseAccumulators[i]);
+                _pTimeLapseAccumulators[i] = nullptr;
             }
         }
+    }
+
+    void Kinect2Recorder::DeleteDuplicateFrameFilters()
+    {
         for (int i = 0; i < MODES_NUMBER; i++)
         {
-            if (mats[i] != nullptr)
+            if (_pDuplicateFrameFilters[i] != nullptr)
             {
-                delete(mats[i]);
-                mats[i] = nullptr;
+                _logger.LogSkippedFrames(_lastPath, i, _pDuplicateFrameFilters[i]->GetSkipped());
+                delete(_pDuplicateFrameFilters[i]);
+                _pDuplicateFrameFilters[i] = nullptr;
             }
         }
-        _mutex.unlock();
     }
 
-    void Kinect2Recorder::Start()
+    /* The caller waits here instead of for the recorder mutex: the node allocation and the lock-free push */
+    void Kinect2Recorder::Post(std::function<void()> function)
     {
-        _mutex.lock();
-        if (InnerStart())
+        std::chrono::steady_clock::time_point postTime = std::chrono::steady_clock::now();
+        Command command;
+        command.function = std::move(function);
+        command.postTime = postTime;
+        _commandQueue.Push(std::move(command));
+        long long postTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - postTime).count();
+        _postNumber++;
+        _postTimeSumNs += postTimeNs;
+        long long postTimeMaxNs = _postTimeMaxNs.load();
+        while (postTimeNs > postTimeMaxNs && !_postTimeMaxNs.compare_exchange_weak(postTimeMaxNs, postTimeNs))
         {
-            _logger.LogStart(_lastPath);
-            _writing = true;
         }
-        _mutex.unlock();
     }
 
-    void Kinect2Recorder::Start(int seconds)
+    void Kinect2Recorder::ApplyCommands()
     {
-        _mutex.lock();
-        if (seconds <= 0)
+        Command command;
+        while (_commandQueue.Pop(command))
         {
-            _logger.LogFailedStartWhenIncorrectTime();
-            _mutex.unlock();
-            return;
-        }
-        if (InnerStart())
+            std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - command.postTime;
+            _stats.commandNumber++;
+            _stats.commandLatencySumMs += latency.count();
+            if (latency.count() > _stats.commandLatencyMaxMs)
+            {
+                _stats.commandLatencyMaxMs = latency.count();
+            }
+            /* One guard for every command: the ones posted before deactivation and applied after it fail */
+            if (!_active)
+            {
+                _logger.LogFailedWhenNotActive();
+                continue;
+            }
+            command.function();
+        }
+        PublishStatus();
+    }
+
+    void Kinect2Recorder::PublishStatus()
+    {
+        unsigned status = 0;
+        if (_active)
+        {
+            status |= STATUS_ACTIVE;
+        }
+        if (_writing)
+        {
+            status |= STATUS_WRITING;
+        }
+        if (_triggerArmed)
+        {
+            status |= STATUS_TRIGGER_ARMED;
+        }
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            if (_modesActivity[i])
+            {
+                status |= static_cast<unsigned>(_modes[i]) << STATUS_MODE_SHIFT;
+            }
+        }
+        _status.store(status, std::memory_order_release);
+    }
+
+    bool Kinect2Recorder::IsActive()
+    {
+        return !_deactivating.load(std::memory_order_acquire) &&
+            (_status.load(std::memory_order_acquire) & STATUS_ACTIVE) != 0;
+    }
+
+    Kinect2RecorderStatus Kinect2Recorder::GetStatus()
+    {
+        unsigned status = _status.load(std::memory_order_acquire);
+        Kinect2RecorderStatus snapshot;
+        snapshot.active = (status & STATUS_ACTIVE) != 0 && !_deactivating.load(std::memory_order_acquire);
+        snapshot.writing = (status & STATUS_WRITING) != 0;
+        snapshot.triggerArmed = (status & STATUS_TRIGGER_ARMED) != 0;
+        snapshot.mode = static_cast<int>(status >> STATUS_MODE_SHIFT);
+        return snapshot;
+    }
+
+    void Kinect2Recorder::SetDirectoryPath(std::string directoryPath)
+    {
+        Post([this, directoryPath]() { ApplySetDirectoryPath(directoryPath); });
+    }
+
+    void Kinect2Recorder::SetMode(int mode)
+    {
+        Post([this, mode]() { ApplySetMode(mode); });
+    }
+
+    void Kinect2Recorder::SetSize(int mode, int width, int height)
+    {
+        Post([this, mode, width, height]() { ApplySetSize(mode, width, height); });
+    }
+
+    void Kinect2Recorder::SetFPS(int fps)
+    {
+        Post([this, fps]() { ApplySetFPS(fps); });
+    }
+
+    void Kinect2Recorder::SetTimeLapse(int factor, int method)
+    {
+        Post([this, factor, method]() { ApplySetTimeLapse(factor, method); });
+    }
+
+    void Kinect2Recorder::SetTrigger(int threshold, int preSeconds, int postSeconds)
+    {
+        Post([this, threshold, preSeconds, postSeconds]() { ApplySetTrigger(threshold, preSeconds, postSeconds); });
+    }
+
+    void Kinect2Recorder::SetDuplicateThreshold(double threshold)
+    {
+        Post([this, threshold]() { ApplySetDuplicateThreshold(threshold); });
+    }
+
+    void Kinect2Recorder::SetSegment(int seconds, int megabytes)
+    {
+        Post([this, seconds, megabytes]() { ApplySetSegment(seconds, megabytes); });
+    }
+
+    void Kinect2Recorder::SetPreRoll(int seconds, int maxMegabytes)
+    {
+        Post([this, seconds, maxMegabytes]() { ApplySetPreRoll(seconds, maxMegabytes); });
+    }
+
+    void Kinect2Recorder::SetEncodeQueue(int megabytes)
+    {
+        Post([this, megabytes]() { ApplySetEncodeQueue(megabytes); });
+    }
+
+    void Kinect2Recorder::SetSpill(std::string directoryPath, int maxMegabytes)
+    {
+        Post([this, directoryPath, maxMegabytes]() { ApplySetSpill(directoryPath, maxMegabytes); });
+    }
+
+    void Kinect2Recorder::SetThreads(int threadNumber)
+    {
+        Post([this, threadNumber]() { ApplySetThreads(threadNumber); });
+    }
+
+    void Kinect2Recorder::SetAcquisitionThread(int core, bool highPriority)
+    {
+        Post([this, core, highPriority]() { ApplySetAcquisitionThread(core, highPriority); });
+    }
+
+    void Kinect2Recorder::SetExport(std::string directoryPath, int interval, int width)
+    {
+        Post([this, directoryPath, interval, width]() { ApplySetExport(directoryPath, interval, width); });
+    }
+
+    int Kinect2Recorder::Subscribe(int mode, int format, int rate, int maxQueue, const FrameCallback& callback)
+    {
+        if (maxQueue < 0)
+        {
+            return -1;
+        }
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            if (_modes[i] == mode)
+            {
+                return _pFrameSubscribers->Subscribe(i, mode, format, rate, maxQueue > 0 ? maxQueue : DEFAULT_SUBSCRIBER_QUEUE, callback);
+            }
+        }
+        return -1;
+    }
+
+    void Kinect2Recorder::Unsubscribe(int id)
+    {
+        _pFrameSubscribers->Unsubscribe(id);
+    }
+
+    void Kinect2Recorder::SetSharedMemory(bool enabled)
+    {
+        Post([this, enabled]() { ApplySetSharedMemory(enabled); });
+    }
+
+    void Kinect2Recorder::SetLive(std::string url, std::string format)
+    {
+        Post([this, url, format]() { ApplySetLive(url, format); });
+    }
+
+    void Kinect2Recorder::SetMirror(std::string directoryPath)
+    {
+        Post([this, directoryPath]() { ApplySetMirror(directoryPath); });
+    }
+
+    void Kinect2Recorder::SetProxy(bool enabled)
+    {
+        Post([this, enabled]() { ApplySetProxy(enabled); });
+    }
+
+    void Kinect2Recorder::Start()
+    {
+        Post([this]() { ApplyStart(); });
+    }
+
+    void Kinect2Recorder::Start(int seconds)
+    {
+        Post([this, seconds]() { ApplyStart(seconds); });
+    }
+
+    void Kinect2Recorder::StartTriggered()
+    {
+        Post([this]() { ApplyStartTriggered(); });
+    }
+
+    void Kinect2Recorder::StartAt(long long timestamp)
+    {
+        Post([this, timestamp]() { ApplyStartAt(timestamp); });
+    }
+
+    void Kinect2Recorder::StartFrames(long long frameNumber)
+    {
+        Post([this, frameNumber]() { ApplyStartFrames(frameNumber); });
+    }
+
+    void Kinect2Recorder::StopAt(long long timestamp)
+    {
+        Post([this, timestamp]() { ApplyStopAt(timestamp); });
+    }
+
+    void Kinect2Recorder::Stop()
+    {
+        Post([this]() { ApplyStop(); });
+    }
+
+    void Kinect2Recorder::Deactivate()
+    {
+        /* IsActive() becomes false at once, so the loop calling Update() may end before the command is applied */
+        _deactivating.store(true, std::memory_order_release);
+        Post([this]() { InnerDeactivate(); });
+    }
+
+    void Kinect2Recorder::SetPreview(bool enabled)
+    {
+        Post([this, enabled]() { ApplySetPreview(enabled); });
+    }
+
+    void Kinect2Recorder::SetPreviewRate(int rate, int width)
+    {
+        Post([this, rate, width]() { ApplySetPreviewRate(rate, width); });
+    }
+
+    void Kinect2Recorder::SetGovernor(bool enabled)
+    {
+        Post([this, enabled]() { ApplySetGovernor(enabled); });
+    }
+
+    void Kinect2Recorder::LogStats()
+    {
+        Post([this]() { ApplyLogStats(); });
+    }
+
+    void Kinect2Recorder::ApplySetPreview(bool enabled)
+    {
+        if (enabled)
+        {
+            _preview.Start();
+        }
+        else
+        {
+            _preview.Stop();
+        }
+        _logger.LogSetPreview();
+    }
+
+    void Kinect2Recorder::ApplySetPreviewRate(int rate, int width)
+    {
+        if (rate <= 0 || rate > MAX_PREVIEW_RATE || width < MIN_PREVIEW_WIDTH)
+        {
+            _logger.LogFailedSetPreview();
+            return;
+        }
+        _previewRate = rate;
+        _preview.SetWidth(width);
+        InnerApplyQualityLevel();
+        _logger.LogSetPreview();
+    }
+
+    void Kinect2Recorder::ApplySetGovernor(bool enabled)
+    {
+        _governorEnabled = enabled;
+        if (!enabled)
+        {
+            _qualityGovernor.Reset();
+        }
+        InnerApplyQualityLevel();
+        _logger.LogSetGovernor();
+    }
+
+    /* Counters are printed and reset, so every 'stats' covers the time since the previous one */
+    void Kinect2Recorder::ApplyLogStats()
+    {
+        _stats.preview = _preview.IsRunning();
+        _stats.frameTimestamp = _frameTimestamp;
+        _stats.postNumber = _postNumber.exchange(0);
+        _stats.postTimeSumUs = _postTimeSumNs.exchange(0) / 1000.0;
+        _stats.postTimeMaxUs = _postTimeMaxNs.exchange(0) / 1000.0;
+        _stats.qualityLevel = _qualityGovernor.GetLevel();
+        _stats.qualityLoad = _qualityGovernor.GetLoad();
+        _stats.finalizePendingNumber = static_cast<long long>(_writerFinalizer.GetPendingNumber());
+        _stats.encodeQueueBytes = static_cast<long long>(_encodeQueue.GetBytes());
+        _stats.encodeSpillBytes = _encodeQueue.GetSpillBytes();
+        _stats.threadBudget = _threadBudget.GetThreadNumber();
+        _stats.pipelineNodes = _pipeline.TakeStats();
+        _encodeQueue.TakeOutputStats(_stats.liveLatency, _stats.livePacketNumber, _stats.outputErrorNumber);
+        _proxyWriter.TakeStats(_stats.proxyWrittenNumber, _stats.proxyDroppedNumber);
+        _stats.interleaveBytes = 0;
+        _stats.interleavePacketNumber = 0;
+        _stats.interleaveFlushedNumber = 0;
+        if (_pVideoWriter != nullptr)
+        {
+            /* The interleaving counters of the writer are safe to read from any thread */
+            for (int i = 0; i < _pVideoWriter->nbStreams(); i++)
+            {
+                _stats.interleaveBytes += _pVideoWriter->interleavedBytes(i);
+                _stats.interleavePacketNumber += _pVideoWriter->interleavedPacketNumber(i);
+            }
+            _stats.interleaveFlushedNumber = _pVideoWriter->interleaveFlushedPacketNumber();
+        }
+        _stats.sharedMemoryFailedNumber = _pSharedFrameSinkNode->TakeFailedNumber();
+        _pFrameSubscribers->TakeStats(_stats.subscriberDeliveredNumber, _stats.subscriberDroppedNumber, _stats.subscriberFailedNumber);
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            _stats.encodeThreadNumbers[i] = _streamThreadNumbers[i];
+        }
+        _stats.preRollFrameNumber = static_cast<long long>(_preRoll.GetFrameNumber());
+        _stats.preRollBytes = static_cast<long long>(_preRoll.GetBytes());
+        _preRoll.TakeEncodeStats(_stats.preRollEncodedNumber, _stats.preRollDroppedNumber, _stats.preRollEncodeTimeSumMs);
+        _logger.LogStats(_stats);
+        _stats = Kinect2RecorderStats();
+    }
+
+    void Kinect2Recorder::ApplySetDirectoryPath(std::string directoryPath)
+    {
+        if (InnerIsBusy())
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        _directoryPath = directoryPath + std::string("\\");
+        _logger.LogDirectoryPath(directoryPath);
+    }
+
+    void Kinect2Recorder::ApplySetMode(int mode)
+    {
+        if (InnerIsBusy())
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        DWORD frameSourceTypes = FrameSourceTypes::FrameSourceTypes_None;
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            _modesActivity[i] = false;
+        }
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            if (_modes[i] & mode)
+            {
+                _modesActivity[i] = true;
+                frameSourceTypes = frameSourceTypes | _frame_source_types[i];
+            }
+        }
+        try
+        {
+            if (_pKinect2Wrapper != nullptr)
+            {
+                _pKinect2Wrapper->SetFrameSourceTypes(frameSourceTypes);
+            }
+        }
+        catch (kinect2reader::Kinect2WrapperFailedException)
+        {
+            _logger.LogFailedSetMode();
+            InnerDeactivate();
+            return;
+        }
+        _preRoll.Clear();
+        _logger.LogSetMode();
+    }
+
+    void Kinect2Recorder::ApplySetSize(int mode, int width, int height)
+    {
+        if (InnerIsBusy())
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        if (width <= 0 || height <= 0)
+        {
+            _logger.LogFailedSetSize();
+            return;
+        }
+        cv::Size size(width, height);
+        for(int i = 0; i < MODES_NUMBER; i++)
+        {
+            if (_modes[i] & mode)
+            {
+                _pFrameStreams[i]->SetSize(size);
+            }
+        }
+        /* Held frames of the old size can not be written any more */
+        _preRoll.Clear();
+        _logger.LogSetSize();
+    }
+
+    void Kinect2Recorder::ApplySetFPS(int fps)
+    {
+        if (fps <= 0)
+        {
+            _logger.LogSetFailedFPSWhenIncorrectValue();
+            return;
+        }
+        _fps = fps;
+        InnerUpdatePreRollCapacity();
+        _logger.LogSetFPS();
+    }
+
+    void Kinect2Recorder::ApplySetTimeLapse(int factor, int method)
+    {
+        if (InnerIsBusy())
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        if (factor <= 0 || factor > _fps * MAX_TIME_LAPSE_SECONDS)
+        {
+            _logger.LogFailedSetTimeLapse();
+            return;
+        }
+        if (method == TimeLapseAccumulator::METHOD_MEDIAN && factor > MAX_TIME_LAPSE_MEDIAN_FACTOR)
+        {
+            _logger.LogFailedSetTimeLapse();
+            return;
+        }
+        _timeLapseFactor = factor;
+        _timeLapseMethod = method;
+        _logger.LogSetTimeLapse(factor);
+    }
+
+    void Kinect2Recorder::ApplySetTrigger(int threshold, int preSeconds, int postSeconds)
+    {
+        if (InnerIsBusy())
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        if (threshold <= 0 || preSeconds < 0 || preSeconds > MAX_TRIGGER_HOLD_SECONDS ||
+            postSeconds < 0 || postSeconds > MAX_TRIGGER_HOLD_SECONDS)
+        {
+            _logger.LogFailedSetTrigger();
+            return;
+        }
+        _triggerThreshold = threshold;
+        _triggerPreSeconds = preSeconds;
+        _triggerPostSeconds = postSeconds;
+        _logger.LogSetTrigger();
+    }
+
+    void Kinect2Recorder::ApplySetDuplicateThreshold(double threshold)
+    {
+        if (InnerIsBusy())
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        /* -1 or a finite non-negative value, NaN fails every comparison */
+        if (threshold != -1.0 && !(threshold >= 0.0 && std::isfinite(threshold)))
+        {
+            _logger.LogFailedSetDuplicateThreshold();
+            return;
+        }
+        _duplicateThreshold = threshold;
+        _logger.LogSetDuplicateThreshold();
+    }
+
+    void Kinect2Recorder::ApplySetSegment(int seconds, int megabytes)
+    {
+        if (InnerIsBusy())
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        if (seconds < 0 || megabytes < 0 || (seconds > 0 && seconds < MIN_SEGMENT_SECONDS))
+        {
+            _logger.LogFailedSetSegment();
+            return;
+        }
+        _segmentSeconds = seconds;
+        _segmentMegabytes = megabytes;
+        _logger.LogSetSegment();
+    }
+
+    void Kinect2Recorder::ApplySetPreRoll(int seconds, int maxMegabytes)
+    {
+        if (InnerIsBusy())
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        if (seconds < 0 || seconds > MAX_PRE_ROLL_SECONDS || maxMegabytes < 0)
+        {
+            _logger.LogFailedSetPreRoll();
+            return;
+        }
+        _preRollSeconds = seconds;
+        if (maxMegabytes > 0)
+        {
+            _preRollMaxMegabytes = maxMegabytes;
+        }
+        InnerUpdatePreRollCapacity();
+        _logger.LogSetPreRoll();
+    }
+
+    void Kinect2Recorder::ApplySetEncodeQueue(int megabytes)
+    {
+        if (InnerIsBusy())
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        if (megabytes < 0)
+        {
+            _logger.LogFailedSetEncodeQueue();
+            return;
+        }
+        _encodeQueueMegabytes = megabytes;
+        _encodeQueue.SetMaxBytes(static_cast<size_t>(megabytes) * 1024 * 1024);
+        _logger.LogSetEncodeQueue();
+    }
+
+    void Kinect2Recorder::ApplySetSpill(std::string directoryPath, int maxMegabytes)
+    {
+        if (InnerIsBusy())
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        if (maxMegabytes < 0)
+        {
+            _logger.LogFailedSetSpill(directoryPath);
+            return;
+        }
+        if (maxMegabytes > 0)
+        {
+            _spillMaxMegabytes = maxMegabytes;
+        }
+        /* The previous recording may still be encoding its backlog, waiting for it here would lose device frames */
+        if (!_encodeQueue.IsIdle())
+        {
+            _logger.LogFailedSetSpillWhenEncoding(_encodeQueue.GetSpilledPendingNumber());
+            return;
+        }
+        std::string path = directoryPath.empty() ? std::string() : directoryPath + std::string("\\") + _spill_file_name;
+        if (!_encodeQueue.SetSpill(path, static_cast<long long>(_spillMaxMegabytes) * 1024 * 1024))
+        {
+            _spillDirectoryPath.clear();
+            _logger.LogFailedSetSpill(directoryPath);
+            return;
+        }
+        _spillDirectoryPath = directoryPath;
+        _logger.LogSetSpill();
+    }
+
+    /* Codec threads are fixed when a codec is opened, so the new budget applies from the next file (segment) */
+    void Kinect2Recorder::ApplySetThreads(int threadNumber)
+    {
+        if (threadNumber < 0 || threadNumber > MAX_CODEC_THREADS)
+        {
+            _logger.LogFailedSetThreads();
+            return;
+        }
+        _threadBudget.SetThreadNumber(threadNumber);
+        _logger.LogSetThreads();
+    }
+
+    /* Applied in Update(), so it is the acquisition thread that is placed */
+    void Kinect2Recorder::ApplySetAcquisitionThread(int core, bool highPriority)
+    {
+        int placement = ThreadPlacement::PlaceCurrentThread(core, highPriority);
+        if (placement == ThreadPlacement::PLACEMENT_FAILED)
+        {
+            _logger.LogFailedSetAcquisitionThread(core);
+            return;
+        }
+        _logger.LogSetAcquisitionThread(core, placement == ThreadPlacement::PLACEMENT_ISOLATED, highPriority);
+    }
+
+    void Kinect2Recorder::ApplySetExport(std::string directoryPath, int interval, int width)
+    {
+        if (interval <= 0 || width < 0 || (width > 0 && width < MIN_PREVIEW_WIDTH))
+        {
+            _logger.LogFailedSetExport();
+            return;
+        }
+        _pExportResizeNode->SetWidth(width);
+        _pImageExportNode->Set(directoryPath, interval);
+        _logger.LogSetExport();
+    }
+
+    void Kinect2Recorder::ApplySetSharedMemory(bool enabled)
+    {
+        _pSharedFrameSinkNode->SetEnabled(enabled);
+        _logger.LogSetSharedMemory(enabled);
+    }
+
+    void Kinect2Recorder::ApplySetLive(std::string url, std::string format)
+    {
+        if (InnerIsBusy())
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        if (!url.empty() && format.empty())
+        {
+            _logger.LogFailedSetLive();
+            return;
+        }
+        _liveUrl = url;
+        _liveFormat = format;
+        _logger.LogSetLive(url, format);
+    }
+
+    void Kinect2Recorder::ApplySetMirror(std::string directoryPath)
+    {
+        if (InnerIsBusy())
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        _mirrorDirectoryPath = directoryPath;
+        _logger.LogSetMirror(directoryPath);
+    }
+
+    void Kinect2Recorder::ApplySetProxy(bool enabled)
+    {
+        if (InnerIsBusy())
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        _proxyEnabled = enabled;
+        _logger.LogSetProxy(enabled);
+    }
+
+    /* The previous proxy file is closed by the proxy thread */
+    void Kinect2Recorder::InnerOpenProxy(const std::string& path, const std::vector<double>& startTimes)
+    {
+        if (!_proxyEnabled)
+        {
+            return;
+        }
+        std::vector<int> streamModeNumbers;
+        std::vector<video_io::VideoWriter::VideoStreamParams> params = InnerGetVideoStreamParams(streamModeNumbers);
+        std::vector<int> levels;
+        for (size_t n = 0; n < streamModeNumbers.size(); n++)
+        {
+            levels.push_back(ProxyWriter::GetLevels(params[n].width, _proxy_widths[streamModeNumbers[n]]));
+        }
+        std::string proxyPath = path.substr(0, path.size() - _extension.size() - 1) + _proxy_suffix + std::string(".") + _extension;
+        _proxyWriter.Open(proxyPath, InnerGetMetadata(), params, levels, startTimes);
+    }
+
+    /* Before the writer is queued. The outputs are muxed from the packets of the file, their failures never stop
+       the file (or each other) and are counted in 'stats' */
+    void Kinect2Recorder::InnerAddOutputs(video_io::VideoWriter * pVideoWriter, const std::string& path)
+    {
+        int colorStreamNumber = InnerGetVideoStreamNumber(0);
+        if (!_liveUrl.empty() && colorStreamNumber >= 0)
+        {
+            try
+            {
+                pVideoWriter->setLiveOutput(_liveUrl, _liveFormat, colorStreamNumber);
+            }
+            catch (...)
+            {
+                _logger.LogFailedAddOutput(_liveUrl);
+            }
+        }
+        if (!_mirrorDirectoryPath.empty())
+        {
+            std::string mirrorPath = _mirrorDirectoryPath + std::string("\\") + path.substr(path.find_last_of("\\/") + 1);
+            try
+            {
+                pVideoWriter->addOutput(mirrorPath, std::string(), std::vector<int>());
+            }
+            catch (...)
+            {
+                _logger.LogFailedAddOutput(mirrorPath);
+            }
+        }
+    }
+
+    /* A mode without a frame this time is an empty mat; device buffers are copied once, see Pipeline::Adopt */
+    /* Without a sink taking frames nothing is copied or pushed */
+    bool Kinect2Recorder::InnerIsPipelineActive()
+    {
+        return _preview.IsRunning() || _pImageExportNode->IsEnabled() || _pFrameSubscribers->HasSubscribers() ||
+            _pSharedFrameSinkNode->IsActive();
+    }
+
+    void Kinect2Recorder::InnerPushPipeline(cv::Mat * mats[])
+    {
+        std::shared_ptr<PipelineFrame> pFrame = std::make_shared<PipelineFrame>();
+        pFrame->mats.resize(MODES_NUMBER);
+        bool anyMat = false;
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            if (mats[i] != nullptr)
+            {
+                pFrame->mats[i] = Pipeline::Adopt(*(mats[i]));
+                anyMat = true;
+            }
+        }
+        if (!anyMat)
+        {
+            return;
+        }
+        pFrame->timestamp = InnerGetFrameTimestamp(mats);
+        pFrame->number = _pipelineFrameNumber++;
+        _pipeline.Push(_pipelineInput, pFrame);
+    }
+
+    /* The trigger keeps its own pre-record time, otherwise the pre-roll one is used */
+    void Kinect2Recorder::InnerUpdatePreRollCapacity()
+    {
+        int seconds = _triggerArmed ? _triggerPreSeconds : _preRollSeconds;
+        _preRoll.SetCapacity(static_cast<size_t>(seconds) * _fps, static_cast<size_t>(_preRollMaxMegabytes) * 1024 * 1024);
+    }
+
+    void Kinect2Recorder::InnerWrite(cv::Mat * mats[])
+    {
+        int videoStreamNumber = 0;
+        cv::Mat timeLapseMat;
+        for(int i = 0; i < MODES_NUMBER; i++)
+        {
+            if (_modesActivity[i])
+            {
+                cv::Mat * pMat = mats[i];
+                if (_pTimeLapseAccumulators[i] != nullptr)
+                {
+                    if (!_pTimeLapseAccumulators[i]->Add(*(mats[i]), timeLapseMat))
+                    {
+                        videoStreamNumber++;
+                        continue;
+                    }
+                    pMat = &timeLapseMat;
+                }
+                bool governorSkip = false;
+                if (_modes[i] == MODE_COLOR && _colorRateDivisor > 1)
+                {
+                    governorSkip = (_colorFrameCounter % _colorRateDivisor) != 0;
+                    _colorFrameCounter++;
+                }
+                if (governorSkip)
+                {
+                    InnerSkipMat(i, videoStreamNumber);
+                    _governorSkippedNumber++;
+                    _stats.governorSkippedNumber++;
+                }
+                else if (_pDuplicateFrameFilters[i] != nullptr && _pDuplicateFrameFilters[i]->IsDuplicate(*pMat))
+                {
+                    InnerSkipMat(i, videoStreamNumber);
+                }
+                else
+                {
+                    InnerWriteMat(i, videoStreamNumber, *pMat, _matsAdopted && pMat == mats[i]);
+                }
+                videoStreamNumber++;
+            }
+        }
+    }
+
+    /* Encoding happens in the encode queue thread, failures are reported by InnerPollEncodeQueue */
+    void Kinect2Recorder::InnerWriteMat(int modeNumber, int videoStreamNumber, const cv::Mat& mat, bool share)
+    {
+        if (_proxyEnabled)
+        {
+            /* The proxy shares the copy of the encode queue */
+            cv::Mat copy;
+            _encodeQueue.Write(_pVideoWriter, videoStreamNumber, modeNumber, mat, &copy, share);
+            if (copy.empty())
+            {
+                _proxyWriter.Skip(videoStreamNumber);
+            }
+            else
+            {
+                _proxyWriter.Write(videoStreamNumber, copy);
+            }
+        }
+        else
+        {
+            _encodeQueue.Write(_pVideoWriter, videoStreamNumber, modeNumber, mat, nullptr, share);
+        }
+        _segmentFrameNumbers[modeNumber]++;
+        _segmentTickNumbers[modeNumber]++;
+    }
+
+    void Kinect2Recorder::InnerSkipMat(int modeNumber, int videoStreamNumber)
+    {
+        _encodeQueue.Skip(_pVideoWriter, videoStreamNumber);
+        if (_proxyEnabled)
+        {
+            _proxyWriter.Skip(videoStreamNumber);
+        }
+        _segmentTickNumbers[modeNumber]++;
+    }
+
+    void Kinect2Recorder::InnerPushPreHold(cv::Mat * mats[])
+    {
+        std::vector<cv::Mat> preRollMats(MODES_NUMBER);
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            if (_modesActivity[i])
+            {
+                preRollMats[i] = *(mats[i]);
+            }
+        }
+        _preRoll.PushGap(static_cast<size_t>(_frameLostNumber));
+        _preRoll.Push(preRollMats);
+    }
+
+    /* Held frames are decoded and written in the encode queue thread before the live frames queued after them,
+       acquisition goes on meanwhile. Gaps are skipped in the video, the proxy skips every held frame. A time lapse
+       recording starts without them: its accumulators belong to the acquisition thread */
+    void Kinect2Recorder::InnerFlushPreHold()
+    {
+        std::shared_ptr<PreRollBuffer::HeldFrames> pFrames = std::make_shared<PreRollBuffer::HeldFrames>();
+        _preRoll.Take(*pFrames);
+        size_t frameNumber = pFrames->GetFrameNumber();
+        std::vector<int> videoStreamNumbers(MODES_NUMBER, -1);
+        int videoStreamNumber = 0;
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            if (_modesActivity[i])
+            {
+                if (_pTimeLapseAccumulators[i] != nullptr)
+                {
+                    frameNumber = 0;
+                }
+                videoStreamNumbers[i] = videoStreamNumber;
+                videoStreamNumber++;
+            }
+        }
+        if (frameNumber == 0)
+        {
+            _preRoll.ReportFlush(0, 0.0);
+            return;
+        }
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            if (videoStreamNumbers[i] >= 0)
+            {
+                _segmentFrameNumbers[i] += static_cast<long long>(pFrames->GetFrameNumber(i));
+                _segmentTickNumbers[i] += static_cast<long long>(frameNumber);
+                for (size_t n = 0; _proxyEnabled && n < frameNumber; n++)
+                {
+                    _proxyWriter.Skip(videoStreamNumbers[i]);
+                }
+            }
+        }
+        video_io::VideoWriter * pVideoWriter = _pVideoWriter;
+        PreRollBuffer * pPreRoll = &_preRoll;
+        _encodeQueue.Call([pFrames, pVideoWriter, videoStreamNumbers, pPreRoll]()
+        {
+            std::chrono::steady_clock::time_point flushStart = std::chrono::steady_clock::now();
+            long long writtenNumber = 0;
+            std::vector<cv::Mat> mats;
+            try
+            {
+                while (pFrames->Pop(mats))
+                {
+                    bool written = false;
+                    for (int i = 0; i < MODES_NUMBER; i++)
+                    {
+                        if (videoStreamNumbers[i] < 0)
+                        {
+                            continue;
+                        }
+                        if (static_cast<size_t>(i) < mats.size() && !mats[i].empty())
+                        {
+                            pVideoWriter->write(mats[i], videoStreamNumbers[i]);
+                            written = true;
+                        }
+                        else
+                        {
+                            pVideoWriter->skip(videoStreamNumbers[i]);
+                        }
+                    }
+                    if (written)
+                    {
+                        writtenNumber++;
+                    }
+                }
+            }
+            catch (...)
+            {
+                /* The writer is failed, close() reports it */
+            }
+            std::chrono::duration<double, std::milli> flushTime = std::chrono::steady_clock::now() - flushStart;
+            pPreRoll->ReportFlush(writtenNumber, flushTime.count());
+        });
+    }
+
+    void Kinect2Recorder::InnerUpdateTrigger(cv::Mat * mats[])
+    {
+        bool activity = false;
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            if (_modes[i] == MODE_DEPTH && mats[i] != nullptr)
+            {
+                activity = _pActivityDetector->Update(*(mats[i]), _triggerThreshold) > _triggerThreshold;
+            }
+        }
+        if (!_writing)
         {
-            _mseconds = 1000 * seconds;
-            _elapsedTimer.restart();
-            _isTimer = true;
+            if (!activity)
+            {
+                InnerPushPreHold(mats);
+                return;
+            }
+            if (!InnerStart())
+            {
+                InnerDisarmTrigger();
+                return;
+            }
             _writing = true;
             _logger.LogStart(_lastPath);
+            InnerFlushPreHold();
+        }
+        if (activity)
+        {
+            _triggerActivityTimestamp = _frameTimestamp;
+        }
+        InnerWrite(mats);
+        InnerFinishLiveFrame();
+        if (_writing && !activity && _frameTimestamp - _triggerActivityTimestamp >= 1000000LL * _triggerPostSeconds)
+        {
+            InnerStop();
         }
-        _mutex.unlock();
     }
 
-    void Kinect2Recorder::Stop()
+    void Kinect2Recorder::InnerDisarmTrigger()
     {
-        _mutex.lock();
-        InnerStop();
-        _mutex.unlock();
+        _triggerArmed = false;
+        _preRoll.Clear();
+        InnerUpdatePreRollCapacity();
+        if (_writing)
+        {
+            InnerStop();
+        }
+        _logger.LogTriggerOff();
     }
 
-    void Kinect2Recorder::Deactivate()
+    void Kinect2Recorder::Update()
     {
-        _mutex.lock();
-        InnerDeactivate();
-        _mutex.unlock();
+        ApplyCommands();
+        if (!_active)
+        {
+            return;
+        }
+        std::chrono::steady_clock::time_point updateStart = std::chrono::steady_clock::now();
+        for(int i = 0; i < MODES_NUMBER; i++)
+        {
+            if (_oldModesActivity[i] != _modesActivity[i])
+            {
+                if (_oldModesActivity[i])
+                {
+                    _preview.Close(_previewWindows[i]);
+                }
+                _oldModesActivity[i] = _modesActivity[i];
+            }
+        }
+        try
+        {
+            if (_pKinect2Wrapper != nullptr)
+            {
+                _pKinect2Wrapper->Update();
+            }
+            else
+            {
+                _pSyntheticSource->Update();
+            }
+        }
+        catch(kinect2reader::Kinect2WrapperFailedException)
+        {
+            _logger.LogKinectOff();
+            InnerDeactivate();
+            return;
+        }
+        /* Synthetic: how late the loop woke up after the frame time, Kinect2: time away from the polling loop */
+        if (_pSyntheticSource != nullptr)
+        {
+            _stats.wakeupLatency.Add(_pSyntheticSource->GetWakeupLatency());
+        }
+        else if (_updateEnded)
+        {
+            _stats.wakeupLatency.Add(std::chrono::duration_cast<std::chrono::microseconds>(updateStart - _updateEnd).count());
+        }
+        cv::Mat * mats[MODES_NUMBER];
+        bool allMats = true;
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            mats[i] = nullptr;
+            if (_modesActivity[i])
+            {
+                cv::Mat * pMat = _pFrameStreams[i]->GetMat();
+                if (pMat != nullptr)
+                {
+                    mats[i] = pMat;
+                }
+                else
+                {
+                    allMats = false;
+                }
+            }
+        }
+        /* The device buffers are copied once, the copy is shared by the pipeline and the encode queue */
+        bool pipelineActive = InnerIsPipelineActive();
+        _matsAdopted = pipelineActive || _writing;
+        for (int i = 0; _matsAdopted && i < MODES_NUMBER; i++)
+        {
+            if (mats[i] != nullptr)
+            {
+                *(mats[i]) = Pipeline::Adopt(*(mats[i]));
+            }
+        }
+        if (pipelineActive)
+        {
+            InnerPushPipeline(mats);
+        }
+        if (allMats)
+        {
+            InnerUpdateSchedule(mats);
+        }
+        if (_triggerArmed && allMats)
+        {
+            InnerUpdateTrigger(mats);
+        }
+        else if (_writing && allMats)
+        {
+            InnerWrite(mats);
+            InnerFinishLiveFrame();
+        }
+        else if (allMats)
+        {
+            InnerPushPreHold(mats);
+        }
+        InnerUpdateSegment();
+        InnerPollEncodeQueue();
+        InnerPollFinalizer();
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            if (mats[i] != nullptr)
+            {
+                delete(mats[i]);
+                mats[i] = nullptr;
+            }
+        }
+        _updateEnd = std::chrono::steady_clock::now();
+        _updateEnded = true;
+        std::chrono::duration<double, std::milli> updateTime = _updateEnd - updateStart;
+        _stats.updateNumber++;
+        _stats.updateTimeSumMs += updateTime.count();
+        if (updateTime.count() > _stats.updateTimeMaxMs)
+        {
+            _stats.updateTimeMaxMs = updateTime.count();
+        }
+        PublishStatus();
+    }
+
+    void Kinect2Recorder::ApplyStart()
+    {
+        if (_triggerArmed || _startTimestamp >= 0)
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        if (InnerStart())
+        {
+            _logger.LogStart(_lastPath);
+            _writing = true;
+            InnerFlushPreHold();
+        }
+    }
+
+    void Kinect2Recorder::ApplyStart(int seconds)
+    {
+        if (seconds <= 0)
+        {
+            _logger.LogFailedStartWhenIncorrectTime();
+            return;
+        }
+        if (_triggerArmed || _startTimestamp >= 0)
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        if (InnerStart())
+        {
+            _writing = true;
+            _logger.LogStart(_lastPath);
+            InnerFlushPreHold();
+            /* Counted from the device time of the first live frame, the pre-roll is not counted */
+            _stopDuration = 1000000LL * seconds;
+        }
+    }
+
+    void Kinect2Recorder::ApplyStartAt(long long timestamp)
+    {
+        if (InnerIsBusy())
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        if (timestamp < 0)
+        {
+            _logger.LogFailedSchedule();
+            return;
+        }
+        _startTimestamp = timestamp;
+        _logger.LogStartScheduled(timestamp);
+    }
+
+    void Kinect2Recorder::ApplyStartFrames(long long frameNumber)
+    {
+        if (frameNumber <= 0)
+        {
+            _logger.LogFailedSchedule();
+            return;
+        }
+        if (_triggerArmed || _startTimestamp >= 0)
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        /* Without the pre-roll, exactly frameNumber live frames are written */
+        if (InnerStart())
+        {
+            _writing = true;
+            _frameLimit = frameNumber;
+            _logger.LogStart(_lastPath);
+        }
+    }
+
+    void Kinect2Recorder::ApplyStopAt(long long timestamp)
+    {
+        if (_triggerArmed || (!_writing && _startTimestamp < 0))
+        {
+            _logger.LogFailedWhenWritingOff();
+            return;
+        }
+        if (timestamp < 0)
+        {
+            _logger.LogFailedSchedule();
+            return;
+        }
+        _stopDuration = -1;
+        _stopTimestamp = timestamp;
+        _logger.LogStopScheduled(timestamp);
+    }
+
+    bool Kinect2Recorder::InnerIsBusy()
+    {
+        return _writing || _triggerArmed || _startTimestamp >= 0;
+    }
+
+    /* Depth time is used when depth is recorded, Kinect2 delivers color and depth of one frame together */
+    long long Kinect2Recorder::InnerGetFrameTimestamp(cv::Mat * mats[])
+    {
+        long long timestamp = -1;
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            if (mats[i] != nullptr && (timestamp < 0 || _modes[i] == MODE_DEPTH))
+            {
+                timestamp = _pFrameStreams[i]->GetTimestamp();
+            }
+        }
+        return timestamp;
+    }
+
+    /* A scheduled start takes the first frame at or after its time, a scheduled stop excludes the first frame at or after its time */
+    void Kinect2Recorder::InnerUpdateSchedule(cv::Mat * mats[])
+    {
+        long long timestamp = InnerGetFrameTimestamp(mats);
+        if (timestamp < 0)
+        {
+            return;
+        }
+        /* Device frames lost between this frame and the previous one */
+        long long period = 1000000LL / _fps;
+        _frameLostNumber = 0;
+        if (_frameTimestamp >= 0 && timestamp - _frameTimestamp > period * 3 / 2)
+        {
+            _frameLostNumber = (timestamp - _frameTimestamp + period / 2) / period - 1;
+        }
+        _frameTimestamp = timestamp;
+        if (_startTimestamp >= 0 && timestamp >= _startTimestamp)
+        {
+            _startTimestamp = -1;
+            if (InnerStart())
+            {
+                _writing = true;
+                _logger.LogStart(_lastPath);
+            }
+            else
+            {
+                _stopTimestamp = -1;
+            }
+        }
+        if (!_writing || _triggerArmed)
+        {
+            return;
+        }
+        if (_stopDuration >= 0)
+        {
+            _stopTimestamp = timestamp + _stopDuration;
+            _stopDuration = -1;
+        }
+        if (_stopTimestamp >= 0 && timestamp >= _stopTimestamp)
+        {
+            InnerStop();
+        }
+    }
+
+    int Kinect2Recorder::InnerGetVideoStreamNumber(int modeNumber)
+    {
+        if (!_modesActivity[modeNumber])
+        {
+            return -1;
+        }
+        int videoStreamNumber = 0;
+        for (int i = 0; i < modeNumber; i++)
+        {
+            if (_modesActivity[i])
+            {
+                videoStreamNumber++;
+            }
+        }
+        return videoStreamNumber;
+    }
+
+    /* encodeTimeMs - encode time of the slowest stream since the previous frame, measured by the writer */
+    void Kinect2Recorder::InnerUpdateGovernor(double encodeTimeMs)
+    {
+        _lostFrameNumber += _frameLostNumber;
+        _stats.lostFrameNumber += _frameLostNumber;
+        if (!_governorEnabled)
+        {
+            return;
+        }
+        int oldLevel = _qualityGovernor.GetLevel();
+        /* The bit rate changes only with the next file */
+        _qualityGovernor.SetLevelUsed(QualityGovernor::LEVEL_LOW_BIT_RATE,
+            !_segmentFailed && (_segmentSeconds > 0 || _segmentMegabytes > 0));
+        bool backlog = _encodeQueue.GetSpilledPendingNumber() > 0 ||
+            _encodeQueue.GetBytes() > static_cast<size_t>(_encodeQueueMegabytes) * 1024 * 1024 / 2;
+        if (_qualityGovernor.Update(encodeTimeMs, 1000.0 / _fps, _frameLostNumber, backlog))
+        {
+            InnerApplyQualityLevel();
+            _logger.LogQualityLevel(oldLevel, _qualityGovernor.GetLevel(), _qualityGovernor.GetLoad(),
+                _lostFrameNumber, _governorSkippedNumber);
+        }
+    }
+
+    /* Depth is never degraded */
+    void Kinect2Recorder::InnerApplyQualityLevel()
+    {
+        int level = _qualityGovernor.GetLevel();
+        int colorStreamNumber = InnerGetVideoStreamNumber(0);
+        if (_pVideoWriter != nullptr && colorStreamNumber >= 0)
+        {
+            /* The writer belongs to the encoder thread, the change applies from the next queued frame */
+            video_io::VideoWriter * pVideoWriter = _pVideoWriter;
+            int interp = level >= QualityGovernor::LEVEL_FAST_CONVERSION ? video_io::INTERP_FAST_BILINEAR : CONVERSION_INTERP;
+            _encodeQueue.Call([pVideoWriter, colorStreamNumber, interp]()
+            {
+                pVideoWriter->setInterp(colorStreamNumber, interp);
+            });
+        }
+        _preview.SetRate(level >= QualityGovernor::LEVEL_LOW_PREVIEW_RATE ?
+            std::min(_previewRate, static_cast<int>(GOVERNOR_PREVIEW_RATE)) : _previewRate);
+        _colorRateDivisor = 1;
+        if (level >= QualityGovernor::LEVEL_HALF_COLOR_RATE)
+        {
+            _colorRateDivisor = 2;
+        }
+        if (level >= QualityGovernor::LEVEL_THIRD_COLOR_RATE)
+        {
+            _colorRateDivisor = 3;
+        }
+    }
+
+    /* After every InnerWrite of live frames, also in the trigger path: the governor, the frame count and the frame limit */
+    void Kinect2Recorder::InnerFinishLiveFrame()
+    {
+        InnerUpdateGovernor(_encodeQueue.TakeEncodeTimeMs());
+        if (_firstFrameTimestamp < 0)
+        {
+            _firstFrameTimestamp = _frameTimestamp;
+        }
+        _lastFrameTimestamp = _frameTimestamp;
+        _liveFrameNumber++;
+        if (_frameLimit > 0 && _liveFrameNumber >= _frameLimit)
+        {
+            InnerStop();
+        }
+    }
+
+    void Kinect2Recorder::ApplyStartTriggered()
+    {
+        if (InnerIsBusy())
+        {
+            _logger.LogFailedWhenWritingOn();
+            return;
+        }
+        bool depth = false;
+        for (int i = 0; i < MODES_NUMBER; i++)
+        {
+            if (_modes[i] == MODE_DEPTH && _modesActivity[i])
+            {
+                depth = true;
+            }
+        }
+        if (!depth)
+        {
+            _logger.LogFailedTriggerWhenNoDepth();
+            return;
+        }
+        if (_pActivityDetector == nullptr)
+        {
+            _pActivityDetector = new ActivityDetector();
+        }
+        _pActivityDetector->Reset();
+        _triggerArmed = true;
+        InnerUpdatePreRollCapacity();
+        _logger.LogTriggerOn();
+    }
+
+    void Kinect2Recorder::ApplyStop()
+    {
+        if (_startTimestamp >= 0 && !_writing)
+        {
+            _startTimestamp = -1;
+            _stopTimestamp = -1;
+            _logger.LogScheduleCanceled();
+        }
+        else if (_triggerArmed)
+        {
+            InnerDisarmTrigger();
+        }
+        else
+        {
+            InnerStop();
+        }
     }
 
 }
@@ -7,11 +7,35 @@
 #pragma once
 #include "Kinect2RecorderLogger.h"
 #include "Kinect2RecorderInitException.h"
+#include "Kinect2RecorderStatus.h"
+#include "Kinect2RecorderStats.h"
 #include "kinect2-reader/Kinect2Wrapper.h"
 #include "Kinect2RecorderInitException.h"
+#include "command/CommandQueue.h"
 #include "mat-stream/MatStream.h"
+#include "mat-stream/SyntheticSource.h"
+#include "time-lapse/TimeLapseAccumulator.h"
+#include "activity/ActivityDetector.h"
+#include "duplicate/DuplicateFrameFilter.h"
+#include "preview/Preview.h"
+#include "pre-roll/PreRollBuffer.h"
+#include "segment/WriterPreparer.h"
+#include "finalizer/WriterFinalizer.h"
+#include "governor/QualityGovernor.h"
+#include "encode/EncodeQueue.h"
+#include "thread-budget/ThreadBudget.h"
+#include "thread-placement/ThreadPlacement.h"
+#include "pipeline/Pipeline.h"
+#include "pipeline/ResizeNode.h"
+#include "pipeline/ImageExportNode.h"
+#include "subscribe/FrameSubscribers.h"
+#include "shared-memory/SharedFrameSinkNode.h"
+#include "proxy/ProxyWriter.h"
 #include "VideoIO/VideoWriter.h"
-#include<mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
 #include <QElapsedTimer>
 
 namespace kinect2recorder
@@ -42,12 +66,76 @@ namespace kinect2recorder
             "yuv420p",
             "gray16"
         };
+        /* As acquired, converted by the writer in one pass */
+        const std::string _input_pix_fmt_names[MODES_NUMBER] =
+        {
+            "bgra",
+            "gray16"
+        };
         const std::string _windowNames[MODES_NUMBER] =
         {
             "Color",
             "Depth",
         };
+        const std::string _pre_roll_extensions[MODES_NUMBER] =
+        {
+            ".jpg",
+            ".png"
+        };
+        const std::string _spill_file_name = "kinect2-recorder.spill";
+        /* Proxy stream widths: color 480x270, depth 256x212. The halvings are chosen from the stream size when the
+           proxy opens (1920x1080 color - 2, 960x540 - 1) */
+        const int _proxy_widths[MODES_NUMBER] =
+        {
+            480,
+            256
+        };
+        const std::string _proxy_suffix = "-proxy";
+        /* Color codec with the live output: a low latency stream the network muxers accept */
+        const std::string _live_codec_name = "mpeg4";
         const static int DEFAULT_FPS = 29;
+        /* Pixel format conversion: same size, only the chroma is subsampled, so bilinear without accurate rounding
+           is expected to be close to lanczos and much cheaper. Not measured yet: run VideoIO/tests/ConversionBench
+           on the recording machine and pick the setting from its time and PSNR table */
+        const static int CONVERSION_INTERP = video_io::INTERP_BILINEAR;
+        const static bool CONVERSION_ACCURATE_ROUNDING = false;
+        /* Frames queued to every stream encoder thread: color and depth encode in parallel, the encode queue
+           only copies the frame */
+        const static int ENCODER_FRAMES_IN_FLIGHT = 2;
+        const static int MAX_TIME_LAPSE_SECONDS = 3600;
+        const static int MAX_TIME_LAPSE_MEDIAN_FACTOR = 64;
+        const static int DEFAULT_TRIGGER_THRESHOLD = 60;
+        const static int DEFAULT_TRIGGER_PRE_SECONDS = 2;
+        const static int DEFAULT_TRIGGER_POST_SECONDS = 5;
+        const static int MAX_TRIGGER_HOLD_SECONDS = 60;
+        const static int MAX_PREVIEW_RATE = 60;
+        const static int MIN_PREVIEW_WIDTH = 16;
+        const static int MAX_PRE_ROLL_SECONDS = 60;
+        const static int DEFAULT_PRE_ROLL_MAX_MEGABYTES = 512;
+        const static int PRE_ROLL_JPEG_QUALITY = 90;
+        const static int PRE_ROLL_PNG_COMPRESSION = 1;
+        const static int MIN_SEGMENT_SECONDS = 5;
+        const static int SEGMENT_PREPARE_LEAD_MSECONDS = 2000;
+        const static int SEGMENT_PREPARE_PERCENT = 90;
+        /* A file is encoded this long before its measured costs may start the next segment for a new thread split */
+        const static int RESPLIT_MIN_MSECONDS = 10000;
+        const static int MAX_PENDING_FINALIZATIONS = 3;
+        const static int GOVERNOR_PREVIEW_RATE = 2;
+        const static int DEFAULT_ENCODE_QUEUE_MEGABYTES = 256;
+        const static int DEFAULT_SPILL_MAX_MEGABYTES = 16384;
+        const static int MAX_CODEC_THREADS = 64;
+        const static int PIPELINE_THREAD_NUMBER = 2;
+        const static int PIPELINE_INPUT_QUEUE = 4;
+        const static int PIPELINE_PREVIEW_QUEUE = 1;
+        const static int PIPELINE_EXPORT_QUEUE = 8;
+        const static int PIPELINE_SUBSCRIBERS_QUEUE = 4;
+        const static int DEFAULT_SUBSCRIBER_QUEUE = 2;
+        const static int PIPELINE_SHARED_MEMORY_QUEUE = 1;
+        const static int PROXY_MAX_FRAMES = 16;
+        const static int SYNTHETIC_COLOR_WIDTH = 1920;
+        const static int SYNTHETIC_COLOR_HEIGHT = 1080;
+        const static int SYNTHETIC_DEPTH_WIDTH = 512;
+        const static int SYNTHETIC_DEPTH_HEIGHT = 424;
         const std::string DEFAULT_DIRECTORY_PATH = ".\\";
         bool _active;
         bool _writing;
@@ -62,46 +150,272 @@ namespace kinect2recorder
             false
         };
         kinect2reader::Kinect2Wrapper * _pKinect2Wrapper;
+        SyntheticSource * _pSyntheticSource;
         MatStream * _pFrameStreams [MODES_NUMBER] =
         {
             nullptr,
             nullptr
         };
         int _fps;
+        int _timeLapseFactor;
+        int _timeLapseMethod;
+        TimeLapseAccumulator * _pTimeLapseAccumulators[MODES_NUMBER] =
+        {
+            nullptr,
+            nullptr
+        };
+        bool _triggerArmed;
+        int _triggerThreshold;
+        int _triggerPreSeconds;
+        int _triggerPostSeconds;
+        ActivityDetector * _pActivityDetector;
+        /* Device time (us) of the last frame with activity, the post hold is counted from it */
+        long long _triggerActivityTimestamp;
+        PreRollBuffer _preRoll;
+        int _preRollSeconds;
+        int _preRollMaxMegabytes;
+        double _duplicateThreshold;
+        DuplicateFrameFilter * _pDuplicateFrameFilters[MODES_NUMBER] =
+        {
+            nullptr,
+            nullptr
+        };
         std::string _directoryPath;
         std::string _lastPath;
+        std::string _liveUrl;
+        std::string _liveFormat;
+        std::string _mirrorDirectoryPath;
         video_io::VideoWriter * _pVideoWriter;
+        int _segmentSeconds;
+        int _segmentMegabytes;
+        QElapsedTimer _segmentTimer;
+        /* Timestamp of the first frame of every mode in the current file */
+        double _segmentStartTimes[MODES_NUMBER] =
+        {
+            0.0,
+            0.0
+        };
+        bool _segmentFailed;
+        /* The thread split of the current file is stale: the next segment is started early, or it is reported once */
+        bool _resplitPending;
+        bool _resplitReported;
+        /* Frames queued to the current file (written, and written + skipped), the encoder may be behind */
+        long long _segmentFrameNumbers[MODES_NUMBER] =
+        {
+            0,
+            0
+        };
+        long long _segmentTickNumbers[MODES_NUMBER] =
+        {
+            0,
+            0
+        };
+        double _writingFrameRate;
+        WriterPreparer _writerPreparer;
+        WriterFinalizer _writerFinalizer;
+        EncodeQueue _encodeQueue;
+        ProxyWriter _proxyWriter;
+        bool _proxyEnabled;
+        int _encodeQueueMegabytes;
+        std::string _spillDirectoryPath;
+        int _spillMaxMegabytes;
+        bool _spilling;
+        long long _spillFrameNumber;
+        long long _droppingNumber;
+        ThreadBudget _threadBudget;
+        /* Codec threads of the streams of the current file, 0 - no file */
+        int _streamThreadNumbers[MODES_NUMBER] =
+        {
+            0,
+            0
+        };
+        /* End of the previous Update(), for the wakeup latency of the Kinect2 polling loop */
+        std::chrono::steady_clock::time_point _updateEnd;
+        bool _updateEnded;
 		Kinect2RecorderLogger& _logger;
-		int _mseconds;
-        QElapsedTimer _elapsedTimer;
-        bool _isTimer;
-        std::mutex _mutex;
+        /* Device time (us), -1 - not set */
+        long long _frameTimestamp;
+        long long _startTimestamp;
+        long long _stopTimestamp;
+        long long _stopDuration;
+        long long _frameLimit;
+        long long _liveFrameNumber;
+        long long _firstFrameTimestamp;
+        long long _lastFrameTimestamp;
+        Preview _preview;
+        int _previewWindows[MODES_NUMBER];
+        int _previewRate;
+        /* Preview and export nodes get every acquired frame, see the constructor */
+        Pipeline _pipeline;
+        int _pipelineInput;
+        long long _pipelineFrameNumber;
+        ResizeNode * _pExportResizeNode;
+        ImageExportNode * _pImageExportNode;
+        FrameSubscribers * _pFrameSubscribers;
+        SharedFrameSinkNode * _pSharedFrameSinkNode;
+        /* The mats of the current frame own their pixels (adopted once), the encode queue shares them */
+        bool _matsAdopted;
+        QualityGovernor _qualityGovernor;
+        bool _governorEnabled;
+        /* Color bit rate of the first file, the next segments are opened with a half of it at LEVEL_LOW_BIT_RATE */
+        int _colorBitRate;
+        int _colorRateDivisor;
+        long long _colorFrameCounter;
+        long long _frameLostNumber;
+        long long _lostFrameNumber;
+        long long _governorSkippedNumber;
+        struct Command
+        {
+            std::function<void()> function;
+            std::chrono::steady_clock::time_point postTime;
+        };
+        const static unsigned STATUS_ACTIVE = 1;
+        const static unsigned STATUS_WRITING = 2;
+        const static unsigned STATUS_TRIGGER_ARMED = 4;
+        const static int STATUS_MODE_SHIFT = 8;
+        std::atomic<bool> _deactivating;
+        std::atomic<unsigned> _status;
+        CommandQueue<Command> _commandQueue;
+        /* Time the posting threads spend in Post, any thread */
+        std::atomic<long long> _postNumber;
+        std::atomic<long long> _postTimeSumNs;
+        std::atomic<long long> _postTimeMaxNs;
+        Kinect2RecorderStats _stats;
+
+        void Post(std::function<void()> function);
 
-        /* USE ONLY INSIDE OF _mutex.lock() and _mutex.unlock() OR IN DESTRUCTOR */
+        /* USE ONLY IN Update() (ACQUISITION THREAD) OR IN DESTRUCTOR */
         void InnerDeactivate();
-        /*************************************************************************/
+        /*************************************************************/
 
-		/* USE ONLY INSIDE OF _mutex.lock() and _mutex.unlock() */
+		/* USE ONLY IN Update() (ACQUISITION THREAD) */
+		void ApplyCommands();
+		void PublishStatus();
 		bool InnerStart();
 		bool InnerStop();
-		/********************************************************/
+		bool InnerIsBusy();
+		long long InnerGetFrameTimestamp(cv::Mat * mats[]);
+		void InnerUpdateSchedule(cv::Mat * mats[]);
+		void InnerFinishLiveFrame();
+		int InnerGetVideoStreamNumber(int modeNumber);
+		void InnerUpdateGovernor(double encodeTimeMs);
+		void InnerApplyQualityLevel();
+		std::string InnerNextPath();
+		video_io::Metadata InnerGetMetadata();
+		std::vector<video_io::VideoWriter::VideoStreamParams> InnerGetVideoStreamParams(std::vector<int>& streamModeNumbers);
+		void InnerLogSegment();
+		void InnerUpdateSegment();
+		void InnerSwitchSegment();
+		void InnerPollFinalizer();
+		void InnerPollEncodeQueue();
+		void InnerSetStreamThreadNumbers();
+		void InnerCheckThreadSplit();
+		void InnerWriteMat(int modeNumber, int videoStreamNumber, const cv::Mat& mat, bool share);
+		void InnerSkipMat(int modeNumber, int videoStreamNumber);
+		void DeleteTimeLapseAccumulators();
+		void DeleteDuplicateFrameFilters();
+		void InnerWrite(cv::Mat * mats[]);
+		void InnerUpdateTrigger(cv::Mat * mats[]);
+		void InnerPushPreHold(cv::Mat * mats[]);
+		void InnerFlushPreHold();
+		void InnerDisarmTrigger();
+		void InnerUpdatePreRollCapacity();
+		void ApplySetDirectoryPath(std::string directoryPath);
+		void ApplySetMode(int mode);
+		void ApplySetSize(int mode, int width, int height);
+		void ApplySetFPS(int fps);
+		void ApplySetTimeLapse(int factor, int method);
+		void ApplySetTrigger(int threshold, int preSeconds, int postSeconds);
+		void ApplySetDuplicateThreshold(double threshold);
+		void ApplySetSegment(int seconds, int megabytes);
+		void ApplySetPreRoll(int seconds, int maxMegabytes);
+		void ApplySetEncodeQueue(int megabytes);
+		void ApplySetSpill(std::string directoryPath, int maxMegabytes);
+		void ApplySetThreads(int threadNumber);
+		void ApplySetAcquisitionThread(int core, bool highPriority);
+		void ApplySetExport(std::string directoryPath, int interval, int width);
+		void ApplySetSharedMemory(bool enabled);
+		void ApplySetLive(std::string url, std::string format);
+		void ApplySetMirror(std::string directoryPath);
+		void ApplySetProxy(bool enabled);
+		void InnerOpenProxy(const std::string& path, const std::vector<double>& startTimes);
+		void InnerAddOutputs(video_io::VideoWriter * pVideoWriter, const std::string& path);
+		void InnerPushPipeline(cv::Mat * mats[]);
+		bool InnerIsPipelineActive();
+		void ApplyStart();
+		void ApplyStart(int seconds);
+		void ApplyStartTriggered();
+		void ApplyStartAt(long long timestamp);
+		void ApplyStartFrames(long long frameNumber);
+		void ApplyStopAt(long long timestamp);
+		void ApplyStop();
+		void ApplySetPreview(bool enabled);
+		void ApplySetPreviewRate(int rate, int width);
+		void ApplySetGovernor(bool enabled);
+		void ApplyLogStats();
+		/*********************************************/
 
     public:
         const static int MODE_NONE = 0;
         const static int MODE_COLOR = 1;
         const static int MODE_DEPTH = 2;
-        Kinect2Recorder(Kinect2RecorderLogger& kinect2RecorderLogger);
+        /* synthetic - SyntheticMatStream frames instead of Kinect2 (no device needed),
+           headless - the preview is not started (no windows), 'preview on' starts it later */
+        Kinect2Recorder(Kinect2RecorderLogger& kinect2RecorderLogger, bool synthetic = false, bool headless = false);
         ~Kinect2Recorder();
+        /* Commands and status are thread-safe: commands are queued and applied by Update at a frame boundary */
         bool IsActive();
+        Kinect2RecorderStatus GetStatus();
         void Update();
         void SetDirectoryPath(std::string directoryPath);
         void SetMode(int mode);
         void SetSize(int mode, int width, int height);
         void SetFPS(int fps);
+        void SetTimeLapse(int factor, int method);
+        void SetTrigger(int threshold, int preSeconds, int postSeconds);
+        /* -1 - off, 0 - exact duplicates, > 0 - also frames within this mean absolute difference */
+        void SetDuplicateThreshold(double threshold);
+        /* A new file every SECONDS and/or MEGABYTES, 0 - no limit */
+        void SetSegment(int seconds, int megabytes);
+        /* 0 seconds turns the pre-roll off, 0 megabytes keeps the current memory ceiling */
+        void SetPreRoll(int seconds, int maxMegabytes);
+        /* Memory for frames waiting for the encoder */
+        void SetEncodeQueue(int megabytes);
+        /* Frames above the encode queue memory go to a file in the directory, empty path turns the spill off */
+        void SetSpill(std::string directoryPath, int maxMegabytes);
+        /* Codec threads of all streams, split by their measured cost when a file (segment) is opened, 0 - VideoIO default */
+        void SetThreads(int threadNumber);
+        /* The thread calling Update() gets its own core (-1 - any) and/or a higher priority, see ThreadPlacement */
+        void SetAcquisitionThread(int core, bool highPriority);
+        /* Every interval-th frame as PNG images downscaled to width (0 - full size), empty path turns it off */
+        void SetExport(std::string directoryPath, int interval, int width);
+        /* Any thread, not queued. The callback gets the frames of the mode (MODE_COLOR or MODE_DEPTH) in the format
+           (FrameSubscribers::FORMAT_*) at most rate per second (0 - every frame) in its own thread; at most maxQueue
+           frames wait for it (0 - default), older ones are dropped. Returns the subscription id, -1 - bad arguments */
+        int Subscribe(int mode, int format, int rate, int maxQueue, const FrameCallback& callback);
+        void Unsubscribe(int id);
+        /* Live frames for other processes in shared memory rings, see SharedFrameReader */
+        void SetSharedMemory(bool enabled);
+        /* The encoded color packets are also sent to url (format - ffmpeg muxer: mpegts, rtp_mpegts), empty url turns it off */
+        void SetLive(std::string url, std::string format);
+        /* A copy of every file in the directory from the same encode (another disk), empty path turns it off */
+        void SetMirror(std::string directoryPath);
+        /* A low resolution proxy file next to every file, see ProxyWriter */
+        void SetProxy(bool enabled);
+        void SetPreview(bool enabled);
+        void SetPreviewRate(int rate, int width);
+        /* Lowers color quality under overload, see QualityGovernor */
+        void SetGovernor(bool enabled);
 		void Start();
 		void Start(int seconds);
+        void StartTriggered();
+        /* Timestamps are device time (us), see 'stats' */
+        void StartAt(long long timestamp);
+        void StartFrames(long long frameNumber);
+        void StopAt(long long timestamp);
         void Stop();
         void Deactivate();
+        void LogStats();
     };
 
 }
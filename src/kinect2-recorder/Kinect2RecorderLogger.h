@@ -5,6 +5,7 @@
 */
 
 #pragma once
+#include "Kinect2RecorderStats.h"
 #include <iostream>
 
 namespace kinect2recorder
@@ -26,6 +27,57 @@ namespace kinect2recorder
 		virtual void LogFailedSetSize() = 0;
         virtual void LogSetFPS() = 0;
         virtual void LogSetFailedFPSWhenIncorrectValue() = 0;
+        virtual void LogSetTimeLapse(int factor) = 0;
+        virtual void LogFailedSetTimeLapse() = 0;
+        virtual void LogSetTrigger() = 0;
+        virtual void LogFailedSetTrigger() = 0;
+        virtual void LogTriggerOn() = 0;
+        virtual void LogTriggerOff() = 0;
+        virtual void LogFailedTriggerWhenNoDepth() = 0;
+        virtual void LogSetDuplicateThreshold() = 0;
+        virtual void LogFailedSetDuplicateThreshold() = 0;
+        virtual void LogSkippedFrames(const std::string& path, int modeNumber, long long number) = 0;
+        virtual void LogStats(const Kinect2RecorderStats& stats) = 0;
+        virtual void LogSetPreview() = 0;
+        virtual void LogFailedSetPreview() = 0;
+        virtual void LogSetSegment() = 0;
+        virtual void LogFailedSetSegment() = 0;
+        virtual void LogSegment(const std::string& path, int modeNumber, long long frameNumber, double startTime, double endTime) = 0;
+        virtual void LogFailedSegment(const std::string& path) = 0;
+        virtual void LogFinalized(const std::string& path, double closeTimeMs) = 0;
+        virtual void LogStartScheduled(long long timestamp) = 0;
+        virtual void LogStopScheduled(long long timestamp) = 0;
+        virtual void LogScheduleCanceled() = 0;
+        virtual void LogFailedSchedule() = 0;
+        virtual void LogRecordedFrames(const std::string& path, long long frameNumber, long long firstTimestamp, long long lastTimestamp) = 0;
+        virtual void LogSetGovernor() = 0;
+        virtual void LogQualityLevel(int oldLevel, int level, double load, long long lostFrameNumber, long long skippedFrameNumber) = 0;
+        virtual void LogSetPreRoll() = 0;
+        virtual void LogFailedSetPreRoll() = 0;
+        virtual void LogPreRollFlush(const std::string& path, long long frameNumber, double timeMs) = 0;
+        virtual void LogSetEncodeQueue() = 0;
+        virtual void LogFailedSetEncodeQueue() = 0;
+        virtual void LogSetSpill() = 0;
+        virtual void LogFailedSetSpill(const std::string& directoryPath) = 0;
+        virtual void LogFailedSetSpillWhenEncoding(long long spilledPendingNumber) = 0;
+        virtual void LogSpill(const std::string& path) = 0;
+        virtual void LogSpillDrained(const std::string& path, long long frameNumber) = 0;
+        virtual void LogEncodeDroppedFrames(const std::string& path, long long frameNumber) = 0;
+        virtual void LogSetThreads() = 0;
+        virtual void LogFailedSetThreads() = 0;
+        virtual void LogCodecThreads(const std::string& path, int modeNumber, int threadNumber, double costMs) = 0;
+        virtual void LogCodecThreadsStale(const std::string& path, bool rotating) = 0;
+        virtual void LogSetAcquisitionThread(int core, bool isolated, bool highPriority) = 0;
+        virtual void LogFailedSetAcquisitionThread(int core) = 0;
+        virtual void LogSetExport() = 0;
+        virtual void LogFailedSetExport() = 0;
+        virtual void LogSetSharedMemory(bool enabled) = 0;
+        virtual void LogSetLive(std::string url, std::string format) = 0;
+        virtual void LogFailedSetLive() = 0;
+        virtual void LogSetMirror(std::string directoryPath) = 0;
+        virtual void LogFailedAddOutput(std::string path) = 0;
+        virtual void LogSetProxy(bool enabled) = 0;
+        virtual void LogFailedProxy(std::string path) = 0;
 		virtual void LogKinectOff() = 0;
 		virtual void LogFailedWrite(const std::string& path, int modeNumber) = 0;
 		virtual void LogStart(const std::string& path) = 0;
@@ -0,0 +1,137 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include "latency/LatencyHistogram.h"
+#include "pipeline/PipelineNodeStats.h"
+#include <vector>
+
+namespace kinect2recorder
+{
+
+    struct Kinect2RecorderStats
+    {
+        /* Time from posting a command to applying it by Update */
+        long long commandNumber;
+        double commandLatencySumMs;
+        double commandLatencyMaxMs;
+        /* Time the posting thread spends in Post, it replaces waiting for the recorder mutex */
+        long long postNumber;
+        double postTimeSumUs;
+        double postTimeMaxUs;
+        /* Acquisition loop (Update) time */
+        bool preview;
+        long long updateNumber;
+        double updateTimeSumMs;
+        double updateTimeMaxMs;
+        /* Pre-roll ring: current size, compression cost in the worker thread and flush time at start */
+        long long preRollFrameNumber;
+        long long preRollBytes;
+        long long preRollEncodedNumber;
+        long long preRollDroppedNumber;
+        double preRollEncodeTimeSumMs;
+        long long preRollFlushNumber;
+        double preRollFlushTimeMaxMs;
+        /* Writers closed in the finalizer thread */
+        long long finalizedNumber;
+        double finalizeTimeMaxMs;
+        long long finalizePendingNumber;
+        /* Device time (us) of the last frame, for 'start at' and 'stop at' */
+        long long frameTimestamp;
+        /* Quality governor: current level and load (write time / frame time), device frames lost, color frames skipped */
+        int qualityLevel;
+        double qualityLoad;
+        long long lostFrameNumber;
+        long long governorSkippedNumber;
+        /* Encode queue: memory and spill file in use now, frames spilled and dropped (spill file full) */
+        long long encodeQueueBytes;
+        long long encodeSpillBytes;
+        long long encodeSpilledNumber;
+        long long encodeDroppedNumber;
+        /* Codec thread budget, encoded frames, encode time and codec threads of every mode (color, depth) */
+        int threadBudget;
+        long long encodedNumbers[2];
+        double encodeTimeSumsMs[2];
+        int encodeThreadNumbers[2];
+        /* Acquisition loop wakeups (us): after the frame time (synthetic source) or between loop iterations (Kinect2) */
+        LatencyHistogram wakeupLatency;
+        /* Every node of the preview/export pipeline */
+        std::vector<PipelineNodeStats> pipelineNodes;
+        /* Frames of all the frame subscribers */
+        long long subscriberDeliveredNumber;
+        long long subscriberDroppedNumber;
+        long long subscriberFailedNumber;
+        /* Frames not published to shared memory: the ring can not be created, or a reader keeps an older, smaller one open */
+        long long sharedMemoryFailedNumber;
+        /* Live output: frame queued for encoding to its packet sent (us), packets sent;
+           errors of the additional outputs (live, mirror) */
+        LatencyHistogram liveLatency;
+        long long livePacketNumber;
+        long long outputErrorNumber;
+        /* Proxy frames written and skipped (the proxy thread was behind) */
+        long long proxyWrittenNumber;
+        long long proxyDroppedNumber;
+        /* Muxer interleaving buffer of the current file: bytes and packets now (all streams),
+           packets written without waiting for the other stream since the file start */
+        long long interleaveBytes;
+        long long interleavePacketNumber;
+        long long interleaveFlushedNumber;
+        Kinect2RecorderStats() :
+            commandNumber(0),
+            commandLatencySumMs(0.0),
+            commandLatencyMaxMs(0.0),
+            postNumber(0),
+            postTimeSumUs(0.0),
+            postTimeMaxUs(0.0),
+            preview(false),
+            updateNumber(0),
+            updateTimeSumMs(0.0),
+            updateTimeMaxMs(0.0),
+            preRollFrameNumber(0),
+            preRollBytes(0),
+            preRollEncodedNumber(0),
+            preRollDroppedNumber(0),
+            preRollEncodeTimeSumMs(0.0),
+            preRollFlushNumber(0),
+            preRollFlushTimeMaxMs(0.0),
+            finalizedNumber(0),
+            finalizeTimeMaxMs(0.0),
+            finalizePendingNumber(0),
+            frameTimestamp(-1),
+            qualityLevel(0),
+            qualityLoad(0.0),
+            lostFrameNumber(0),
+            governorSkippedNumber(0),
+            encodeQueueBytes(0),
+            encodeSpillBytes(0),
+            encodeSpilledNumber(0),
+            encodeDroppedNumber(0),
+            threadBudget(0),
+            wakeupLatency(),
+            pipelineNodes(),
+            subscriberDeliveredNumber(0),
+            subscriberDroppedNumber(0),
+            subscriberFailedNumber(0),
+            sharedMemoryFailedNumber(0),
+            liveLatency(),
+            livePacketNumber(0),
+            outputErrorNumber(0),
+            proxyWrittenNumber(0),
+            proxyDroppedNumber(0),
+            interleaveBytes(0),
+            interleavePacketNumber(0),
+            interleaveFlushedNumber(0)
+        {
+            for (int i = 0; i < 2; i++)
+            {
+                encodedNumbers[i] = 0;
+                encodeTimeSumsMs[i] = 0.0;
+                encodeThreadNumbers[i] = 0;
+            }
+        }
+    };
+
+}
@@ -0,0 +1,20 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+
+namespace kinect2recorder
+{
+
+    struct Kinect2RecorderStatus
+    {
+        bool active;
+        bool writing;
+        bool triggerArmed;
+        int mode;
+    };
+
+}
@@ -0,0 +1,70 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "ActivityDetector.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+
+namespace kinect2recorder
+{
+
+    ActivityDetector::ActivityDetector() :
+        _small(),
+        _smallFloat(),
+        _background(),
+        _valid(),
+        _invalid(),
+        _unknown(),
+        _diff(),
+        _changed(),
+        _unchanged(),
+        _blocks(),
+        _initialized(false)
+    {
+    }
+
+    ActivityDetector::~ActivityDetector()
+    {
+    }
+
+    double ActivityDetector::Update(const cv::Mat& depth, double threshold)
+    {
+        int height = depth.rows * DETECTION_WIDTH / depth.cols;
+        cv::Size size(DETECTION_WIDTH, std::max(BLOCK_SIZE, height / BLOCK_SIZE * BLOCK_SIZE));
+        /* Nearest neighbour keeps invalid (zero) depth from blending into valid pixels */
+        cv::resize(depth, _small, size, 0, 0, cv::INTER_NEAREST);
+        _small.convertTo(_smallFloat, CV_32F);
+        if (!_initialized || _background.size() != size)
+        {
+            _smallFloat.copyTo(_background);
+            _initialized = true;
+            return 0.0;
+        }
+        cv::compare(_small, cv::Scalar(0), _valid, cv::CMP_NE);
+        cv::compare(_background, cv::Scalar(0), _unknown, cv::CMP_EQ);
+        cv::bitwise_and(_unknown, _valid, _unknown);
+        _smallFloat.copyTo(_background, _unknown);
+        cv::absdiff(_smallFloat, _background, _diff);
+        cv::bitwise_not(_valid, _invalid);
+        _diff.setTo(cv::Scalar(0), _invalid);
+        /* Area interpolation with an integer factor is the mean of every block */
+        cv::resize(_diff, _blocks, cv::Size(size.width / BLOCK_SIZE, size.height / BLOCK_SIZE), 0, 0, cv::INTER_AREA);
+        /* Invalid pixels have no change, so the changed pixels are a part of the valid ones */
+        cv::compare(_diff, cv::Scalar(std::max(threshold, 0.0)), _changed, cv::CMP_GT);
+        cv::bitwise_xor(_valid, _changed, _unchanged);
+        cv::accumulateWeighted(_smallFloat, _background, LEARNING_RATE, _unchanged);
+        cv::accumulateWeighted(_smallFloat, _background, CHANGED_LEARNING_RATE, _changed);
+        double maxScore = 0.0;
+        cv::minMaxLoc(_blocks, nullptr, &maxScore);
+        return maxScore;
+    }
+
+    void ActivityDetector::Reset()
+    {
+        _initialized = false;
+    }
+
+}
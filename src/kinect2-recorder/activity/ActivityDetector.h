@@ -0,0 +1,44 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include <opencv2/core/core.hpp>
+
+namespace kinect2recorder
+{
+
+    /* Scores depth frames against a slowly updated background, per block of a downscaled frame. Changed pixels are
+       learned much slower, so a person standing still stays active for minutes, a moved object is learned in the end */
+    class ActivityDetector
+    {
+    private:
+        const static int DETECTION_WIDTH = 128;
+        const static int BLOCK_SIZE = 8;
+        /* Time constant about 17 s at 30 fps */
+        const double LEARNING_RATE = 0.002;
+        /* Pixels changed by more than the threshold: about 3 min */
+        const double CHANGED_LEARNING_RATE = 0.0002;
+        cv::Mat _small;
+        cv::Mat _smallFloat;
+        cv::Mat _background;
+        cv::Mat _valid;
+        cv::Mat _invalid;
+        cv::Mat _unknown;
+        cv::Mat _diff;
+        cv::Mat _changed;
+        cv::Mat _unchanged;
+        cv::Mat _blocks;
+        bool _initialized;
+    public:
+        ActivityDetector();
+        ~ActivityDetector();
+        /* Returns the highest per-block mean absolute depth change (depth units),
+           threshold - pixel change (depth units) learned at CHANGED_LEARNING_RATE */
+        double Update(const cv::Mat& depth, double threshold);
+        void Reset();
+    };
+
+}
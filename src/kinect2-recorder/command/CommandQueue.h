@@ -0,0 +1,73 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include <atomic>
+#include <utility>
+
+namespace kinect2recorder
+{
+
+    /* Lock-free multiple producers single consumer queue (intrusive Vyukov queue with a stub node) */
+    template<class T>
+    class CommandQueue
+    {
+    private:
+        struct Node
+        {
+            std::atomic<Node *> next;
+            T value;
+            Node() : next(nullptr), value() {}
+            explicit Node(T&& value) : next(nullptr), value(std::move(value)) {}
+        };
+        std::atomic<Node *> _head;
+        Node * _tail;
+        CommandQueue(const CommandQueue&);
+        CommandQueue& operator=(const CommandQueue&);
+    public:
+        CommandQueue() :
+            _head(nullptr),
+            _tail(nullptr)
+        {
+            Node * pStub = new Node();
+            _head.store(pStub);
+            _tail = pStub;
+        }
+
+        ~CommandQueue()
+        {
+            T value;
+            while (Pop(value))
+            {
+            }
+            delete(_tail);
+            _tail = nullptr;
+        }
+
+        /* Any thread. The only allocation is the node, the value is moved into it */
+        void Push(T value)
+        {
+            Node * pNode = new Node(std::move(value));
+            Node * pPrevious = _head.exchange(pNode, std::memory_order_acq_rel);
+            pPrevious->next.store(pNode, std::memory_order_release);
+        }
+
+        /* Consumer thread only. May miss an element whose Push has not completed yet */
+        bool Pop(T& value)
+        {
+            Node * pNext = _tail->next.load(std::memory_order_acquire);
+            if (pNext == nullptr)
+            {
+                return false;
+            }
+            value = std::move(pNext->value);
+            delete(_tail);
+            _tail = pNext;
+            return true;
+        }
+    };
+
+}
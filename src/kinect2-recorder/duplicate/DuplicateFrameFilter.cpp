@@ -0,0 +1,161 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "DuplicateFrameFilter.h"
+#include <cstring>
+
+namespace kinect2recorder
+{
+
+    namespace
+    {
+
+        const unsigned long long PRIME64_1 = 11400714785074694791ULL;
+        const unsigned long long PRIME64_2 = 14029467366897019727ULL;
+        const unsigned long long PRIME64_3 = 1609587929392839161ULL;
+        const unsigned long long PRIME64_4 = 9650029242287828579ULL;
+        const unsigned long long PRIME64_5 = 2870177450012600261ULL;
+        const size_t WORD_SIZE = 8;
+        const size_t STRIPE_WORDS = 4;
+
+        inline unsigned long long RotateLeft(unsigned long long value, int bits)
+        {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        inline unsigned long long Read64(const unsigned char * p)
+        {
+            unsigned long long value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        inline unsigned long long Read32(const unsigned char * p)
+        {
+            unsigned int value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        inline unsigned long long Round(unsigned long long acc, unsigned long long input)
+        {
+            acc += input * PRIME64_2;
+            acc = RotateLeft(acc, 31);
+            return acc * PRIME64_1;
+        }
+
+        inline unsigned long long Merge(unsigned long long acc, unsigned long long value)
+        {
+            acc ^= Round(0, value);
+            return acc * PRIME64_1 + PRIME64_4;
+        }
+
+    }
+
+    DuplicateFrameFilter::DuplicateFrameFilter(double threshold) :
+        _threshold(threshold),
+        _hasLast(false),
+        _lastHash(0),
+        _last(),
+        _skipped(0)
+    {
+    }
+
+    DuplicateFrameFilter::~DuplicateFrameFilter()
+    {
+    }
+
+    /* xxHash64 over 8-byte words: four independent lanes over 4-word stripes keep the multipliers busy, the words
+       left after the last stripe and then the bytes left after the last word are mixed in by the tail loops */
+    unsigned long long DuplicateFrameFilter::Hash(const void * data, size_t size)
+    {
+        const unsigned char * bytes = static_cast<const unsigned char *>(data);
+        const size_t wordNumber = size / WORD_SIZE;
+        size_t word = 0;
+        unsigned long long hash;
+        if (wordNumber >= STRIPE_WORDS)
+        {
+            unsigned long long v1 = PRIME64_1 + PRIME64_2;
+            unsigned long long v2 = PRIME64_2;
+            unsigned long long v3 = 0;
+            unsigned long long v4 = 0 - PRIME64_1;
+            for (; word + STRIPE_WORDS <= wordNumber; word += STRIPE_WORDS)
+            {
+                const unsigned char * stripe = bytes + word * WORD_SIZE;
+                v1 = Round(v1, Read64(stripe));
+                v2 = Round(v2, Read64(stripe + 8));
+                v3 = Round(v3, Read64(stripe + 16));
+                v4 = Round(v4, Read64(stripe + 24));
+            }
+            hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+            hash = Merge(hash, v1);
+            hash = Merge(hash, v2);
+            hash = Merge(hash, v3);
+            hash = Merge(hash, v4);
+        }
+        else
+        {
+            hash = PRIME64_5;
+        }
+        hash += static_cast<unsigned long long>(size);
+        for (; word < wordNumber; word++)
+        {
+            hash ^= Round(0, Read64(bytes + word * WORD_SIZE));
+            hash = RotateLeft(hash, 27) * PRIME64_1 + PRIME64_4;
+        }
+        size_t byte = wordNumber * WORD_SIZE;
+        if (byte + 4 <= size)
+        {
+            hash ^= Read32(bytes + byte) * PRIME64_1;
+            hash = RotateLeft(hash, 23) * PRIME64_2 + PRIME64_3;
+            byte += 4;
+        }
+        for (; byte < size; byte++)
+        {
+            hash ^= bytes[byte] * PRIME64_5;
+            hash = RotateLeft(hash, 11) * PRIME64_1;
+        }
+        hash ^= hash >> 33;
+        hash *= PRIME64_2;
+        hash ^= hash >> 29;
+        hash *= PRIME64_3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    bool DuplicateFrameFilter::IsDuplicate(const cv::Mat& mat)
+    {
+        cv::Mat continuous = mat.isContinuous() ? mat : mat.clone();
+        unsigned long long hash = Hash(continuous.data, continuous.total() * continuous.elemSize());
+        if (_hasLast && hash == _lastHash)
+        {
+            _skipped++;
+            return true;
+        }
+        if (_threshold > 0)
+        {
+            if (_hasLast && _last.size() == mat.size() && _last.type() == mat.type())
+            {
+                double difference = cv::norm(mat, _last, cv::NORM_L1) / (mat.total() * mat.channels());
+                if (difference <= _threshold)
+                {
+                    _skipped++;
+                    return true;
+                }
+            }
+            mat.copyTo(_last);
+        }
+        _lastHash = hash;
+        _hasLast = true;
+        return false;
+    }
+
+    long long DuplicateFrameFilter::GetSkipped()
+    {
+        return _skipped;
+    }
+
+}
@@ -0,0 +1,32 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include <opencv2/core/core.hpp>
+
+namespace kinect2recorder
+{
+
+    /* Detects frames which are equal (or nearly equal) to the last accepted frame */
+    class DuplicateFrameFilter
+    {
+    private:
+        double _threshold;
+        bool _hasLast;
+        unsigned long long _lastHash;
+        cv::Mat _last;
+        long long _skipped;
+    public:
+        /* threshold: mean absolute difference per element for near duplicates, 0 - exact duplicates only */
+        DuplicateFrameFilter(double threshold);
+        ~DuplicateFrameFilter();
+        /* Remembers mat as the last accepted frame when it is not a duplicate */
+        bool IsDuplicate(const cv::Mat& mat);
+        long long GetSkipped();
+        static unsigned long long Hash(const void * data, size_t size);
+    };
+
+}
@@ -0,0 +1,639 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "EncodeQueue.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace kinect2recorder
+{
+
+    EncodeQueue::EncodeQueue() :
+        _writerStreams(),
+        _entries(),
+        _maxBytes(0),
+        _bytes(0),
+        _spillPath(),
+        _maxSpillBytes(0),
+        _spillOut(),
+        _spillIn(),
+        _spillBytes(0),
+        _spilledPendingNumber(0),
+        _spillWrites(),
+        _spillNumber(0),
+        _spillDoneNumber(0),
+        _spillFailedNumbers(),
+        _spillRunning(false),
+        _spillCondition(),
+        _spillThread(),
+        _spillEnd(0),
+        _pLastVideoWriter(nullptr),
+        _bytesWritten(0),
+        _modeEncodeTimesMs(),
+        _spilledNumber(0),
+        _droppedNumber(0),
+        _failedModeNumbers(),
+        _modeEncodeTimeSumsMs(),
+        _modeEncodedNumbers(),
+        _liveLatency(),
+        _livePacketNumber(0),
+        _outputErrorNumber(0),
+        _busy(false),
+        _running(false),
+        _mutex(),
+        _condition(),
+        _idleCondition(),
+        _thread()
+    {
+    }
+
+    EncodeQueue::~EncodeQueue()
+    {
+        Stop();
+        CloseSpill();
+    }
+
+    void EncodeQueue::Start()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_running)
+        {
+            return;
+        }
+        _running = true;
+        _thread = std::thread(&EncodeQueue::ThreadFunction, this);
+    }
+
+    void EncodeQueue::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_running)
+            {
+                return;
+            }
+            _running = false;
+        }
+        _condition.notify_all();
+        _thread.join();
+    }
+
+    void EncodeQueue::SetMaxBytes(size_t maxBytes)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _maxBytes = maxBytes;
+    }
+
+    bool EncodeQueue::SetSpill(const std::string& path, long long maxBytes)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_spilledPendingNumber > 0)
+            {
+                return false;
+            }
+        }
+        /* No spilled entry is left, so the encoder thread does not read the file */
+        CloseSpill();
+        if (path.empty())
+        {
+            return true;
+        }
+        _spillOut.open(path, std::ios::binary | std::ios::trunc);
+        _spillIn.open(path, std::ios::binary);
+        if (!_spillOut.is_open() || !_spillIn.is_open())
+        {
+            CloseSpill();
+            std::remove(path.c_str());
+            return false;
+        }
+        _spillPath = path;
+        _maxSpillBytes = maxBytes;
+        _spillEnd = 0;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _spillRunning = true;
+        }
+        _spillThread = std::thread(&EncodeQueue::SpillThreadFunction, this);
+        return true;
+    }
+
+    /* The spill thread writes everything handed to it before it ends */
+    void EncodeQueue::CloseSpill()
+    {
+        if (_spillThread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _spillRunning = false;
+            }
+            _spillCondition.notify_all();
+            _spillThread.join();
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _spillFailedNumbers.clear();
+        }
+        if (_spillOut.is_open())
+        {
+            _spillOut.close();
+        }
+        if (_spillIn.is_open())
+        {
+            _spillIn.close();
+        }
+        if (!_spillPath.empty())
+        {
+            std::remove(_spillPath.c_str());
+        }
+        _spillPath.clear();
+        _spillBytes = 0;
+    }
+
+    void EncodeQueue::Push(Entry& entry)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _entries.push_back(Entry());
+            std::swap(_entries.back(), entry);
+        }
+        _condition.notify_one();
+    }
+
+    bool EncodeQueue::Write(video_io::VideoWriter * pVideoWriter, int videoStreamNumber, int modeNumber, const cv::Mat& mat,
+        cv::Mat * pCopy, bool share)
+    {
+        Entry entry;
+        entry.kind = ENTRY_WRITE;
+        entry.pVideoWriter = pVideoWriter;
+        entry.videoStreamNumber = videoStreamNumber;
+        entry.modeNumber = modeNumber;
+        entry.bytes = mat.total() * mat.elemSize();
+        entry.spilled = false;
+        entry.spillOffset = 0;
+        entry.spillNumber = -1;
+        entry.rows = mat.rows;
+        entry.cols = mat.cols;
+        entry.type = mat.type();
+        entry.queueTime = std::chrono::steady_clock::now();
+        bool memory;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            memory = _bytes + entry.bytes <= _maxBytes;
+            if (memory)
+            {
+                /* Reserved before the copy, the encoder thread only decreases it */
+                _bytes += entry.bytes;
+            }
+        }
+        if (memory)
+        {
+            entry.mat = share ? mat : mat.clone();
+            if (pCopy != nullptr)
+            {
+                *pCopy = entry.mat;
+            }
+        }
+        else if (Spill(mat, entry))
+        {
+            entry.spilled = true;
+        }
+        else
+        {
+            Skip(pVideoWriter, videoStreamNumber);
+            std::lock_guard<std::mutex> lock(_mutex);
+            _droppedNumber++;
+            return false;
+        }
+        Push(entry);
+        return true;
+    }
+
+    /* Reserves the place of the raw pixels and hands a copy to the spill thread. The file is started over once every
+       spilled frame is encoded */
+    bool EncodeQueue::Spill(const cv::Mat& mat, Entry& entry)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_spillRunning || _spillWrites.size() >= MAX_SPILL_WRITES)
+            {
+                return false;
+            }
+            if (_spilledPendingNumber == 0)
+            {
+                _spillBytes = 0;
+            }
+            if (_spillBytes + static_cast<long long>(entry.bytes) > _maxSpillBytes)
+            {
+                return false;
+            }
+            entry.spillOffset = _spillBytes;
+            entry.spillNumber = _spillNumber++;
+            _spillBytes += entry.bytes;
+            _spilledPendingNumber++;
+            _spilledNumber++;
+        }
+        SpillWrite write;
+        write.mat = mat.clone();
+        write.offset = entry.spillOffset;
+        write.number = entry.spillNumber;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _spillWrites.push_back(write);
+        }
+        _spillCondition.notify_all();
+        return true;
+    }
+
+    /* Waits until the spill thread has written and flushed the frame */
+    bool EncodeQueue::ReadSpilled(Entry& entry)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (_spillDoneNumber <= entry.spillNumber)
+            {
+                _spillCondition.wait(lock);
+            }
+            if (_spillFailedNumbers.erase(entry.spillNumber) > 0)
+            {
+                return false;
+            }
+        }
+        entry.mat.create(entry.rows, entry.cols, entry.type);
+        _spillIn.clear();
+        _spillIn.seekg(entry.spillOffset);
+        _spillIn.read(reinterpret_cast<char *>(entry.mat.data), entry.bytes);
+        return _spillIn.good();
+    }
+
+    void EncodeQueue::Skip(video_io::VideoWriter * pVideoWriter, int videoStreamNumber)
+    {
+        Entry entry;
+        entry.kind = ENTRY_SKIP;
+        entry.pVideoWriter = pVideoWriter;
+        entry.videoStreamNumber = videoStreamNumber;
+        entry.modeNumber = -1;
+        entry.bytes = 0;
+        entry.spilled = false;
+        entry.spillOffset = 0;
+        entry.spillNumber = -1;
+        Push(entry);
+    }
+
+    void EncodeQueue::Call(const std::function<void()>& function)
+    {
+        Entry entry;
+        entry.kind = ENTRY_CALL;
+        entry.pVideoWriter = nullptr;
+        entry.videoStreamNumber = -1;
+        entry.modeNumber = -1;
+        entry.bytes = 0;
+        entry.spilled = false;
+        entry.spillOffset = 0;
+        entry.spillNumber = -1;
+        entry.function = function;
+        Push(entry);
+    }
+
+    bool EncodeQueue::IsIdle()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return !_busy && _entries.empty();
+    }
+
+    void EncodeQueue::WaitForBytes(size_t bytes)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (_running && _bytes > 0 && _bytes + bytes > _maxBytes)
+        {
+            _idleCondition.wait(lock);
+        }
+    }
+
+    size_t EncodeQueue::GetBytes()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _bytes;
+    }
+
+    long long EncodeQueue::GetSpillBytes()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _spilledPendingNumber > 0 ? _spillBytes : 0;
+    }
+
+    long long EncodeQueue::GetSpilledPendingNumber()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _spilledPendingNumber;
+    }
+
+    long long EncodeQueue::GetBytesWritten(video_io::VideoWriter * pVideoWriter)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return pVideoWriter == _pLastVideoWriter ? _bytesWritten : 0;
+    }
+
+    double EncodeQueue::TakeEncodeTimeMs()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        double encodeTimeMs = 0.0;
+        for (size_t i = 0; i < _modeEncodeTimesMs.size(); i++)
+        {
+            encodeTimeMs = std::max(encodeTimeMs, _modeEncodeTimesMs[i]);
+            _modeEncodeTimesMs[i] = 0.0;
+        }
+        return encodeTimeMs;
+    }
+
+    bool EncodeQueue::TakeFailure(int& modeNumber)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_failedModeNumbers.empty())
+        {
+            return false;
+        }
+        modeNumber = _failedModeNumbers.front();
+        _failedModeNumbers.pop_front();
+        return true;
+    }
+
+    void EncodeQueue::TakeStats(long long& spilledNumber, long long& droppedNumber)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        spilledNumber = _spilledNumber;
+        droppedNumber = _droppedNumber;
+        _spilledNumber = 0;
+        _droppedNumber = 0;
+    }
+
+    void EncodeQueue::TakeModeStats(std::vector<double>& encodeTimeSumsMs, std::vector<long long>& encodedNumbers)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        encodeTimeSumsMs.swap(_modeEncodeTimeSumsMs);
+        encodedNumbers.swap(_modeEncodedNumbers);
+        _modeEncodeTimeSumsMs.clear();
+        _modeEncodedNumbers.clear();
+    }
+
+    void EncodeQueue::TakeOutputStats(LatencyHistogram& liveLatency, long long& livePacketNumber, long long& outputErrorNumber)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        liveLatency = _liveLatency;
+        livePacketNumber = _livePacketNumber;
+        outputErrorNumber = _outputErrorNumber;
+        _liveLatency = LatencyHistogram();
+        _livePacketNumber = 0;
+        _outputErrorNumber = 0;
+    }
+
+    /* A failed write (disk full) fails only its frame, it is skipped in the video. The file is flushed when the
+       queue is empty or every MAX_SPILL_WRITES frames, not after every frame */
+    void EncodeQueue::SpillThreadFunction()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        long long writtenNumber = _spillDoneNumber;
+        while (true)
+        {
+            while (_spillRunning && _spillWrites.empty())
+            {
+                _spillCondition.wait(lock);
+            }
+            if (_spillWrites.empty())
+            {
+                break;
+            }
+            SpillWrite write = _spillWrites.front();
+            _spillWrites.pop_front();
+            lock.unlock();
+            if (write.offset == 0 && _spillEnd > 0)
+            {
+                _spillOut.close();
+                _spillOut.open(_spillPath, std::ios::binary | std::ios::trunc);
+                _spillEnd = 0;
+            }
+            size_t bytes = write.mat.total() * write.mat.elemSize();
+            _spillOut.seekp(write.offset);
+            _spillOut.write(reinterpret_cast<const char *>(write.mat.data), bytes);
+            bool good = _spillOut.good();
+            _spillOut.clear();
+            if (good)
+            {
+                _spillEnd = std::max(_spillEnd, write.offset + static_cast<long long>(bytes));
+            }
+            write.mat.release();
+            lock.lock();
+            if (!good)
+            {
+                _spillFailedNumbers.insert(write.number);
+            }
+            writtenNumber = write.number + 1;
+            if (_spillWrites.empty() || writtenNumber - _spillDoneNumber >= static_cast<long long>(MAX_SPILL_WRITES))
+            {
+                lock.unlock();
+                _spillOut.flush();
+                bool flushed = _spillOut.good();
+                _spillOut.clear();
+                lock.lock();
+                for (long long number = _spillDoneNumber; !flushed && number < writtenNumber; number++)
+                {
+                    _spillFailedNumbers.insert(number);
+                }
+                _spillDoneNumber = writtenNumber;
+                _spillCondition.notify_all();
+            }
+        }
+    }
+
+    /* With frames in flight write() returns before the frame is encoded, so the time spent here is a hand-off.
+       The encode time and the sent packets are the writer own counters, their changes since the previous entry
+       are added to the statistics */
+    void EncodeQueue::PollWriter(const Entry& entry, bool written)
+    {
+        if (!_writerStreams.empty() && _writerStreams.front().pVideoWriter != entry.pVideoWriter)
+        {
+            _writerStreams.clear();
+        }
+        size_t n = 0;
+        while (n < _writerStreams.size() && _writerStreams[n].videoStreamNumber != entry.videoStreamNumber)
+        {
+            n++;
+        }
+        if (n == _writerStreams.size())
+        {
+            WriterStream stream;
+            stream.pVideoWriter = entry.pVideoWriter;
+            stream.videoStreamNumber = entry.videoStreamNumber;
+            stream.modeNumber = -1;
+            stream.encodeTime = entry.pVideoWriter->encodeTime(entry.videoStreamNumber);
+            stream.encodedNumber = entry.pVideoWriter->encodedFrameNumber(entry.videoStreamNumber);
+            /* Without B-frames a written frame gives one packet: the earlier frames are counted as sent */
+            stream.sentNumber = entry.pVideoWriter->frameNumber(entry.videoStreamNumber) - (written ? 1 : 0);
+            _writerStreams.push_back(stream);
+        }
+        if (entry.modeNumber >= 0)
+        {
+            _writerStreams[n].modeNumber = entry.modeNumber;
+        }
+        if (written && entry.pVideoWriter->liveStream(entry.videoStreamNumber))
+        {
+            _writerStreams[n].queueTimes.push_back(entry.queueTime);
+        }
+        for (size_t i = 0; i < _writerStreams.size(); i++)
+        {
+            WriterStream& stream = _writerStreams[i];
+            double encodeTime = entry.pVideoWriter->encodeTime(stream.videoStreamNumber);
+            long long encodedNumber = entry.pVideoWriter->encodedFrameNumber(stream.videoStreamNumber);
+            std::chrono::steady_clock::time_point sentTime;
+            long long sentNumber = entry.pVideoWriter->sentPacketNumber(stream.videoStreamNumber, sentTime);
+            double encodeTimeMs = (encodeTime - stream.encodeTime) * 1000.0;
+            long long encodedDelta = encodedNumber - stream.encodedNumber;
+            long long latencyUs = -1;
+            if (sentNumber > stream.sentNumber && !stream.queueTimes.empty())
+            {
+                /* Only the packet sent last has its time, it belongs to the frame with its number */
+                size_t sent = static_cast<size_t>(std::min(sentNumber - stream.sentNumber,
+                    static_cast<long long>(stream.queueTimes.size())));
+                latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(sentTime - stream.queueTimes[sent - 1]).count();
+                stream.queueTimes.erase(stream.queueTimes.begin(), stream.queueTimes.begin() + sent);
+            }
+            stream.encodeTime = encodeTime;
+            stream.encodedNumber = encodedNumber;
+            stream.sentNumber = std::max(stream.sentNumber, sentNumber);
+            if (stream.modeNumber < 0)
+            {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (latencyUs >= 0)
+            {
+                _liveLatency.Add(latencyUs);
+            }
+            if (_modeEncodedNumbers.size() <= static_cast<size_t>(stream.modeNumber))
+            {
+                _modeEncodeTimeSumsMs.resize(stream.modeNumber + 1, 0.0);
+                _modeEncodedNumbers.resize(stream.modeNumber + 1, 0);
+            }
+            if (_modeEncodeTimesMs.size() <= static_cast<size_t>(stream.modeNumber))
+            {
+                _modeEncodeTimesMs.resize(stream.modeNumber + 1, 0.0);
+            }
+            _modeEncodeTimeSumsMs[stream.modeNumber] += encodeTimeMs;
+            _modeEncodedNumbers[stream.modeNumber] += encodedDelta;
+            _modeEncodeTimesMs[stream.modeNumber] += encodeTimeMs;
+        }
+    }
+
+    /* Everything queued is encoded before the thread ends */
+    void EncodeQueue::ThreadFunction()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true)
+        {
+            while (_running && _entries.empty())
+            {
+                _condition.wait(lock);
+            }
+            if (_entries.empty())
+            {
+                break;
+            }
+            Entry entry;
+            std::swap(entry, _entries.front());
+            _entries.pop_front();
+            _busy = true;
+            lock.unlock();
+            bool spillRead = !entry.spilled || ReadSpilled(entry);
+            bool failed = false;
+            long long bytesWritten = 0;
+            long long livePacketNumber = 0;
+            long long outputErrorNumber = 0;
+            try
+            {
+                long long livePacketsBefore = 0;
+                long long outputErrorsBefore = 0;
+                if (entry.pVideoWriter != nullptr)
+                {
+                    livePacketsBefore = entry.pVideoWriter->livePacketNumber();
+                    outputErrorsBefore = entry.pVideoWriter->outputErrorNumber();
+                }
+                if (entry.kind == ENTRY_WRITE)
+                {
+                    if (!spillRead)
+                    {
+                        /* Not written by the spill thread (disk full): dropped as if the spill file had no room */
+                        entry.pVideoWriter->skip(entry.videoStreamNumber);
+                    }
+                    else
+                    {
+                        entry.pVideoWriter->write(entry.mat, entry.videoStreamNumber);
+                    }
+                }
+                else if (entry.kind == ENTRY_SKIP)
+                {
+                    entry.pVideoWriter->skip(entry.videoStreamNumber);
+                }
+                else
+                {
+                    entry.function();
+                }
+                if (entry.pVideoWriter != nullptr)
+                {
+                    bytesWritten = entry.pVideoWriter->bytesWritten();
+                    livePacketNumber = entry.pVideoWriter->livePacketNumber() - livePacketsBefore;
+                    outputErrorNumber = entry.pVideoWriter->outputErrorNumber() - outputErrorsBefore;
+                }
+            }
+            catch (...)
+            {
+                failed = true;
+            }
+            entry.mat.release();
+            if (entry.kind == ENTRY_CALL)
+            {
+                /* A call may close or delete the writer, its counters are not read any more */
+                _writerStreams.clear();
+            }
+            else
+            {
+                PollWriter(entry, entry.kind == ENTRY_WRITE && spillRead && !failed);
+            }
+            lock.lock();
+            _livePacketNumber += livePacketNumber;
+            _outputErrorNumber += outputErrorNumber;
+            if (entry.kind == ENTRY_WRITE)
+            {
+                if (entry.spilled)
+                {
+                    _spilledPendingNumber--;
+                }
+                else
+                {
+                    _bytes -= entry.bytes;
+                }
+            }
+            if (entry.pVideoWriter != nullptr)
+            {
+                _pLastVideoWriter = entry.pVideoWriter;
+                _bytesWritten = bytesWritten;
+            }
+            if (!spillRead)
+            {
+                _droppedNumber++;
+            }
+            if (failed && entry.modeNumber >= 0)
+            {
+                _failedModeNumbers.push_back(entry.modeNumber);
+            }
+            _busy = false;
+            _idleCondition.notify_all();
+        }
+        _busy = false;
+        _idleCondition.notify_all();
+    }
+
+}
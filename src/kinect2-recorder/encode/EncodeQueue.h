@@ -0,0 +1,158 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include "VideoIO/VideoWriter.h"
+#include "../latency/LatencyHistogram.h"
+#include <opencv2/core/core.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace kinect2recorder
+{
+
+    /* Encodes frames in its own thread in the order they are queued. Frames above the memory limit are
+       appended raw to the spill file by the spill thread and read back when their turn comes, a frame is dropped
+       (skipped in the video) only when the spill file or the spill thread queue is full too.
+       Write, Skip, Call and the setters - from one thread */
+    class EncodeQueue
+    {
+    private:
+        const static int ENTRY_WRITE = 0;
+        const static int ENTRY_SKIP = 1;
+        const static int ENTRY_CALL = 2;
+        /* Frames waiting for the spill thread, the file is flushed at least once per this number of frames */
+        const static size_t MAX_SPILL_WRITES = 8;
+        struct Entry
+        {
+            int kind;
+            video_io::VideoWriter * pVideoWriter;
+            int videoStreamNumber;
+            int modeNumber;
+            cv::Mat mat;
+            size_t bytes;
+            /* The pixels are in the spill file */
+            bool spilled;
+            long long spillOffset;
+            long long spillNumber;
+            int rows;
+            int cols;
+            int type;
+            std::function<void()> function;
+            std::chrono::steady_clock::time_point queueTime;
+        };
+        /* Counters of a writer stream read last time, the writer encodes and sends packets in its own threads */
+        struct WriterStream
+        {
+            video_io::VideoWriter * pVideoWriter;
+            int videoStreamNumber;
+            int modeNumber;
+            double encodeTime;
+            long long encodedNumber;
+            long long sentNumber;
+            /* Queue time of every written frame of a live stream which packet is not sent yet */
+            std::deque<std::chrono::steady_clock::time_point> queueTimes;
+        };
+        struct SpillWrite
+        {
+            cv::Mat mat;
+            long long offset;
+            long long number;
+        };
+        /* Encoder thread only */
+        std::vector<WriterStream> _writerStreams;
+        std::deque<Entry> _entries;
+        size_t _maxBytes;
+        size_t _bytes;
+        std::string _spillPath;
+        long long _maxSpillBytes;
+        std::ofstream _spillOut;
+        std::ifstream _spillIn;
+        long long _spillBytes;
+        long long _spilledPendingNumber;
+        std::deque<SpillWrite> _spillWrites;
+        long long _spillNumber;
+        /* Spill writes done and flushed, the encoder thread reads only those */
+        long long _spillDoneNumber;
+        std::set<long long> _spillFailedNumbers;
+        bool _spillRunning;
+        std::condition_variable _spillCondition;
+        std::thread _spillThread;
+        /* Spill thread only */
+        long long _spillEnd;
+        video_io::VideoWriter * _pLastVideoWriter;
+        long long _bytesWritten;
+        std::vector<double> _modeEncodeTimesMs;
+        long long _spilledNumber;
+        long long _droppedNumber;
+        std::deque<int> _failedModeNumbers;
+        std::vector<double> _modeEncodeTimeSumsMs;
+        std::vector<long long> _modeEncodedNumbers;
+        LatencyHistogram _liveLatency;
+        long long _livePacketNumber;
+        long long _outputErrorNumber;
+        bool _busy;
+        bool _running;
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        std::condition_variable _idleCondition;
+        std::thread _thread;
+        void ThreadFunction();
+        void SpillThreadFunction();
+        void Push(Entry& entry);
+        bool Spill(const cv::Mat& mat, Entry& entry);
+        bool ReadSpilled(Entry& entry);
+        void CloseSpill();
+        void PollWriter(const Entry& entry, bool written);
+    public:
+        EncodeQueue();
+        ~EncodeQueue();
+        void Start();
+        /* Encodes everything queued before return */
+        void Stop();
+        void SetMaxBytes(size_t maxBytes);
+        /* Empty path - no spill file. Fails while spilled frames are not encoded or when the file can not be created */
+        bool SetSpill(const std::string& path, long long maxBytes);
+        /* Returns false when the frame is dropped (memory and spill file are full), a skip is queued instead.
+           pCopy - the queued copy kept in memory, shared (empty when spilled or dropped), it must not be changed.
+           share - the mat owns its pixels and nobody changes them, it is queued without a copy */
+        bool Write(video_io::VideoWriter * pVideoWriter, int videoStreamNumber, int modeNumber, const cv::Mat& mat,
+            cv::Mat * pCopy = nullptr, bool share = false);
+        void Skip(video_io::VideoWriter * pVideoWriter, int videoStreamNumber);
+        /* The function is called in the encoder thread after everything queued before it */
+        void Call(const std::function<void()>& function);
+        /* Nothing is queued or being encoded */
+        bool IsIdle();
+        /* Waits until the memory queue has room for bytes (or is empty), for writing faster than real time */
+        void WaitForBytes(size_t bytes);
+        size_t GetBytes();
+        long long GetSpillBytes();
+        long long GetSpilledPendingNumber();
+        /* Output size of the writer after its last encoded frame, 0 - nothing encoded yet */
+        long long GetBytesWritten(video_io::VideoWriter * pVideoWriter);
+        /* Encode time of the slowest stream since the previous call, every stream has its own encoder thread
+           in the writer */
+        double TakeEncodeTimeMs();
+        /* Modes of the frames failed to encode */
+        bool TakeFailure(int& modeNumber);
+        /* Counters since the previous call */
+        void TakeStats(long long& spilledNumber, long long& droppedNumber);
+        /* Encode time and number of the frames of every mode since the previous call, indexed by modeNumber */
+        void TakeModeStats(std::vector<double>& encodeTimeSumsMs, std::vector<long long>& encodedNumbers);
+        /* Writer outputs since the previous call: time (us) from Write() to the packet of the frame sent by the
+           writer muxer thread (live streams), live packets, errors of all the additional outputs (live, mirror) */
+        void TakeOutputStats(LatencyHistogram& liveLatency, long long& livePacketNumber, long long& outputErrorNumber);
+    };
+
+}
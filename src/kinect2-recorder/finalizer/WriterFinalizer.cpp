@@ -0,0 +1,146 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "WriterFinalizer.h"
+#include <chrono>
+
+namespace kinect2recorder
+{
+
+    WriterFinalizer::WriterFinalizer(size_t maxPending) :
+        _maxPending(maxPending),
+        _pending(),
+        _results(),
+        _busy(false),
+        _running(false),
+        _mutex(),
+        _condition(),
+        _spaceCondition(),
+        _thread()
+    {
+    }
+
+    WriterFinalizer::~WriterFinalizer()
+    {
+        Stop();
+    }
+
+    void WriterFinalizer::Start()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_running)
+        {
+            return;
+        }
+        _running = true;
+        _thread = std::thread(&WriterFinalizer::ThreadFunction, this);
+    }
+
+    void WriterFinalizer::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_running)
+            {
+                return;
+            }
+            _running = false;
+        }
+        _condition.notify_all();
+        _thread.join();
+    }
+
+    void WriterFinalizer::Finalize(video_io::VideoWriter * pVideoWriter, const std::string& path)
+    {
+        Pending pending;
+        pending.pVideoWriter = pVideoWriter;
+        pending.path = path;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (_running && _pending.size() + (_busy ? 1 : 0) >= _maxPending)
+            {
+                _spaceCondition.wait(lock);
+            }
+            if (_running)
+            {
+                _pending.push_back(pending);
+                lock.unlock();
+                _condition.notify_one();
+                return;
+            }
+        }
+        /* No thread, the writer is closed here */
+        Result result = Close(pending);
+        std::lock_guard<std::mutex> lock(_mutex);
+        _results.push_back(result);
+    }
+
+    WriterFinalizer::Result WriterFinalizer::Close(Pending& pending)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Result result;
+        result.path = pending.path;
+        result.closed = true;
+        try
+        {
+            pending.pVideoWriter->close();
+        }
+        catch (...)
+        {
+            result.closed = false;
+        }
+        delete(pending.pVideoWriter);
+        pending.pVideoWriter = nullptr;
+        std::chrono::duration<double, std::milli> closeTime = std::chrono::steady_clock::now() - start;
+        result.closeTimeMs = closeTime.count();
+        return result;
+    }
+
+    bool WriterFinalizer::Poll(Result& result)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_results.empty())
+        {
+            return false;
+        }
+        result = _results.front();
+        _results.pop_front();
+        return true;
+    }
+
+    size_t WriterFinalizer::GetPendingNumber()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _pending.size() + (_busy ? 1 : 0);
+    }
+
+    void WriterFinalizer::ThreadFunction()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true)
+        {
+            while (_running && _pending.empty())
+            {
+                _condition.wait(lock);
+            }
+            /* Writers handed over before Stop() are closed anyway */
+            if (_pending.empty())
+            {
+                break;
+            }
+            Pending pending = _pending.front();
+            _pending.pop_front();
+            _busy = true;
+            lock.unlock();
+            Result result = Close(pending);
+            lock.lock();
+            _results.push_back(result);
+            _busy = false;
+            _spaceCondition.notify_all();
+        }
+    }
+
+}
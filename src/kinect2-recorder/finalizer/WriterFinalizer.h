@@ -0,0 +1,57 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include "VideoIO/VideoWriter.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace kinect2recorder
+{
+
+    /* Closes writers (encoder flush, trailer, file close) in its own thread, results are taken by Poll() */
+    class WriterFinalizer
+    {
+    public:
+        struct Result
+        {
+            std::string path;
+            bool closed;
+            double closeTimeMs;
+        };
+    private:
+        struct Pending
+        {
+            video_io::VideoWriter * pVideoWriter;
+            std::string path;
+        };
+        size_t _maxPending;
+        std::deque<Pending> _pending;
+        std::deque<Result> _results;
+        bool _busy;
+        bool _running;
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        std::condition_variable _spaceCondition;
+        std::thread _thread;
+        void ThreadFunction();
+        static Result Close(Pending& pending);
+    public:
+        WriterFinalizer(size_t maxPending);
+        ~WriterFinalizer();
+        void Start();
+        /* Closes every pending writer before return */
+        void Stop();
+        /* Takes the writer, waits while maxPending writers are being closed */
+        void Finalize(video_io::VideoWriter * pVideoWriter, const std::string& path);
+        bool Poll(Result& result);
+        size_t GetPendingNumber();
+    };
+
+}
@@ -0,0 +1,118 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "QualityGovernor.h"
+
+namespace kinect2recorder
+{
+
+    QualityGovernor::QualityGovernor() :
+        _load(0.0),
+        _level(LEVEL_NORMAL),
+        _overloadedFrames(0),
+        _idleFrames(0),
+        _cooldownFrames(0),
+        _skippedLevels(0)
+    {
+    }
+
+    void QualityGovernor::Reset()
+    {
+        _load = 0.0;
+        _level = LEVEL_NORMAL;
+        _overloadedFrames = 0;
+        _idleFrames = 0;
+        _cooldownFrames = 0;
+    }
+
+    void QualityGovernor::SetLevelUsed(int level, bool used)
+    {
+        if (level <= LEVEL_NORMAL || level >= LEVEL_NUMBER)
+        {
+            return;
+        }
+        if (used)
+        {
+            _skippedLevels &= ~(1 << level);
+        }
+        else
+        {
+            _skippedLevels |= 1 << level;
+        }
+    }
+
+    /* The next used level, the same level at the top of the ladder */
+    int QualityGovernor::Step(int level, int step)
+    {
+        int next = level + step;
+        while (next > LEVEL_NORMAL && next < LEVEL_NUMBER && (_skippedLevels & (1 << next)) != 0)
+        {
+            next += step;
+        }
+        return next < LEVEL_NUMBER ? next : level;
+    }
+
+    bool QualityGovernor::Update(double frameTimeMs, double budgetMs, long long lostFrameNumber, bool backlog)
+    {
+        if (budgetMs <= 0)
+        {
+            return false;
+        }
+        _load += LOAD_ALPHA * (frameTimeMs / budgetMs - _load);
+        if (_cooldownFrames > 0)
+        {
+            /* The effect of the previous change is not measured yet */
+            _cooldownFrames--;
+            return false;
+        }
+        /* Kinect2 also loses frames in low light, it is an overload only when writing is slow too */
+        bool lost = lostFrameNumber > 0 && _load > LOW_LOAD;
+        if (lost || backlog || _load > HIGH_LOAD)
+        {
+            _overloadedFrames++;
+            _idleFrames = 0;
+        }
+        else if (_load < LOW_LOAD)
+        {
+            _idleFrames++;
+            _overloadedFrames = 0;
+        }
+        else
+        {
+            _overloadedFrames = 0;
+            _idleFrames = 0;
+        }
+        int level = _level;
+        if (_overloadedFrames >= DOWN_HOLD_FRAMES || lost)
+        {
+            level = Step(_level, 1);
+        }
+        else if (_idleFrames >= UP_HOLD_FRAMES && _level > LEVEL_NORMAL)
+        {
+            level = Step(_level, -1);
+        }
+        if (level == _level)
+        {
+            return false;
+        }
+        _level = level;
+        _overloadedFrames = 0;
+        _idleFrames = 0;
+        _cooldownFrames = COOLDOWN_FRAMES;
+        return true;
+    }
+
+    int QualityGovernor::GetLevel()
+    {
+        return _level;
+    }
+
+    double QualityGovernor::GetLoad()
+    {
+        return _load;
+    }
+
+}
@@ -0,0 +1,55 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+
+namespace kinect2recorder
+{
+
+    /* Chooses a quality level from the encode time of every frame, the encoder backlog and the frames lost by the device,
+       the level goes down at once under overload and goes up only after a long enough headroom */
+    class QualityGovernor
+    {
+    private:
+        const static int DOWN_HOLD_FRAMES = 5;
+        const static int UP_HOLD_FRAMES = 90;
+        const static int COOLDOWN_FRAMES = 30;
+        const double LOAD_ALPHA = 0.1;
+        const double HIGH_LOAD = 0.9;
+        const double LOW_LOAD = 0.5;
+        double _load;
+        int _level;
+        int _overloadedFrames;
+        int _idleFrames;
+        int _cooldownFrames;
+        /* Bit of every level the ladder steps over */
+        int _skippedLevels;
+        int Step(int level, int step);
+    public:
+        const static int LEVEL_NORMAL = 0;
+        /* Color: fast pixel format conversion */
+        const static int LEVEL_FAST_CONVERSION = 1;
+        /* Color: half bit rate from the next segment file, the rate control of the codecs reads the bit rate
+           only when the file is opened */
+        const static int LEVEL_LOW_BIT_RATE = 2;
+        const static int LEVEL_LOW_PREVIEW_RATE = 3;
+        /* Color: every 2nd, then 2 of 3 frames are skipped, depth is never skipped */
+        const static int LEVEL_HALF_COLOR_RATE = 4;
+        const static int LEVEL_THIRD_COLOR_RATE = 5;
+        const static int LEVEL_NUMBER = 6;
+        QualityGovernor();
+        void Reset();
+        /* An unused level (no effect now) is stepped over, the current level is kept */
+        void SetLevelUsed(int level, bool used);
+        /* budgetMs - time of one frame, backlog - the encoder is behind (spill file in use or memory queue half full),
+           returns true when the level is changed */
+        bool Update(double frameTimeMs, double budgetMs, long long lostFrameNumber, bool backlog);
+        int GetLevel();
+        /* Smoothed frame time / budget */
+        double GetLoad();
+    };
+
+}
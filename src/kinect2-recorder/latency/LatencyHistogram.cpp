@@ -0,0 +1,84 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "LatencyHistogram.h"
+
+namespace kinect2recorder
+{
+
+    LatencyHistogram::LatencyHistogram() :
+        _number(0),
+        _max(0)
+    {
+        for (int i = 0; i < BUCKET_NUMBER; i++)
+        {
+            _counts[i] = 0;
+        }
+    }
+
+    void LatencyHistogram::Add(long long latency)
+    {
+        if (latency < 0)
+        {
+            latency = 0;
+        }
+        int bucket = 0;
+        while (bucket < BUCKET_NUMBER - 1 && latency >= GetBucketLimit(bucket))
+        {
+            bucket++;
+        }
+        _counts[bucket]++;
+        _number++;
+        if (latency > _max)
+        {
+            _max = latency;
+        }
+    }
+
+    long long LatencyHistogram::GetNumber() const
+    {
+        return _number;
+    }
+
+    long long LatencyHistogram::GetMax() const
+    {
+        return _max;
+    }
+
+    long long LatencyHistogram::GetCount(int bucket) const
+    {
+        return _counts[bucket];
+    }
+
+    long long LatencyHistogram::GetBucketLimit(int bucket)
+    {
+        return 1LL << bucket;
+    }
+
+    long long LatencyHistogram::GetPercentile(double percentile) const
+    {
+        if (_number == 0)
+        {
+            return 0;
+        }
+        long long rank = static_cast<long long>(_number * percentile / 100.0 + 0.5);
+        if (rank < 1)
+        {
+            rank = 1;
+        }
+        long long number = 0;
+        for (int i = 0; i < BUCKET_NUMBER - 1; i++)
+        {
+            number += _counts[i];
+            if (number >= rank)
+            {
+                return GetBucketLimit(i) < _max ? GetBucketLimit(i) : _max;
+            }
+        }
+        return _max;
+    }
+
+}
@@ -0,0 +1,33 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+
+namespace kinect2recorder
+{
+
+    /* Latencies (us) in power of 2 buckets: bucket N holds [2^(N-1), 2^N), the last one - everything above */
+    class LatencyHistogram
+    {
+    public:
+        const static int BUCKET_NUMBER = 24;
+    private:
+        long long _counts[BUCKET_NUMBER];
+        long long _number;
+        long long _max;
+    public:
+        LatencyHistogram();
+        void Add(long long latency);
+        long long GetNumber() const;
+        long long GetMax() const;
+        long long GetCount(int bucket) const;
+        /* Upper bound (us) of the bucket */
+        static long long GetBucketLimit(int bucket);
+        /* Upper bound of the bucket holding the percentile, 0 < percentile <= 100 */
+        long long GetPercentile(double percentile) const;
+    };
+
+}
@@ -16,7 +16,8 @@ namespace kinect2recorder
     Gray16MatStream::Gray16MatStream(kinect2reader::Kinect2Accessor * pKinect2Accessor) :
         _buffer(nullptr),
         _pKinect2Accessor(nullptr),
-        _size(cv::Size(WIDTH, HEIGHT))
+        _size(cv::Size(WIDTH, HEIGHT)),
+        _timestamp(0)
     {
         if (pKinect2Accessor == nullptr)
         {
@@ -58,6 +59,11 @@ namespace kinect2recorder
         }
         SafeRelease(pFrameDescription);
         pFrameDescription = nullptr;
+        TIMESPAN relativeTime = 0;
+        if (SUCCEEDED(hr))
+        {
+            hr = pDepthFrame->get_RelativeTime(&relativeTime);
+        }
         if (SUCCEEDED(hr) && width == WIDTH && height == HEIGHT)
         {
             UINT16 * tmpBuffer = nullptr;
@@ -72,6 +78,8 @@ namespace kinect2recorder
         }
         if (correct)
         {
+            /* TIMESPAN is in 100 ns */
+            _timestamp = relativeTime / 10;
             cv::Mat * pMat = new cv::Mat(HEIGHT, WIDTH, CV_16UC1, reinterpret_cast<void*>(_buffer));
             cv::resize(*pMat, *pMat, _size);
             return pMat;
@@ -94,4 +102,9 @@ namespace kinect2recorder
         return _size.height;
     }
 
+    long long Gray16MatStream::GetTimestamp()
+    {
+        return _timestamp;
+    }
+
 }
@@ -21,6 +21,7 @@ namespace kinect2recorder
         UINT16 * _buffer;
         kinect2reader::Kinect2Accessor * _pKinect2Accessor;
         cv::Size _size;
+        long long _timestamp;
     public:
         Gray16MatStream(kinect2reader::Kinect2Accessor * pKinect2Accessor);
         ~Gray16MatStream();
@@ -28,6 +29,7 @@ namespace kinect2recorder
         void SetSize(cv::Size size);
         int GetWidth();
         int GetHeight();
+        long long GetTimestamp();
     };
 
 }
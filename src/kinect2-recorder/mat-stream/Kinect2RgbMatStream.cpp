@@ -15,7 +15,8 @@ namespace kinect2recorder
     RgbMatStream::RgbMatStream(kinect2reader::Kinect2Accessor * pKinect2Accessor) :
         _buffer(nullptr),
         _pKinect2Accessor(nullptr),
-        _size(cv::Size(WIDTH, HEIGHT))
+        _size(cv::Size(WIDTH, HEIGHT)),
+        _timestamp(0)
     {
         if (pKinect2Accessor == nullptr)
         {
@@ -61,6 +62,11 @@ namespace kinect2recorder
         {
             hr = pColorFrame->get_RawColorImageFormat(&imageFormat);
         }
+        TIMESPAN relativeTime = 0;
+        if (SUCCEEDED(hr))
+        {
+            hr = pColorFrame->get_RelativeTime(&relativeTime);
+        }
         if (SUCCEEDED(hr) && width == WIDTH && height == HEIGHT)
         {
             if (imageFormat == ColorImageFormat_Bgra)
@@ -83,9 +89,11 @@ namespace kinect2recorder
         }
         if (correct)
         {
+            /* TIMESPAN is in 100 ns */
+            _timestamp = relativeTime / 10;
             cv::Mat * pMat = new cv::Mat(HEIGHT, WIDTH, CV_8UC4, reinterpret_cast<void*>(_buffer));
+            /* BGRA goes to the writer as is, it converts to the codec format in one pass */
             cv::resize(*pMat, *pMat, _size);
-            cv::cvtColor(*pMat, *pMat, CV_RGBA2RGB);
             return pMat;
         }
         return nullptr;
@@ -106,4 +114,9 @@ namespace kinect2recorder
         return _size.height;
     }
 
+    long long RgbMatStream::GetTimestamp()
+    {
+        return _timestamp;
+    }
+
 }
@@ -21,6 +21,7 @@ namespace kinect2recorder
         BYTE * _buffer;
         kinect2reader::Kinect2Accessor * _pKinect2Accessor;
         cv::Size _size;
+        long long _timestamp;
     public:
         RgbMatStream(kinect2reader::Kinect2Accessor * pKinect2Accessor);
         ~RgbMatStream();
@@ -28,6 +29,7 @@ namespace kinect2recorder
         void SetSize(cv::Size size);
         int GetWidth();
         int GetHeight();
+        long long GetTimestamp();
     };
 
 }
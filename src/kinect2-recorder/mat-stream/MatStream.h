@@ -14,7 +14,10 @@ namespace kinect2recorder
     {
     public:
         MatStream() {}
+        virtual ~MatStream() {}
         virtual cv::Mat * GetMat() = 0;
+        /* Device time (us) of the last frame returned by GetMat() */
+        virtual long long GetTimestamp() = 0;
         virtual void SetSize(cv::Size size) = 0;
         virtual int GetWidth() = 0;
         virtual int GetHeight() = 0;
@@ -0,0 +1,96 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "SyntheticMatStream.h"
+#include "MatStreamInitException.h"
+
+namespace kinect2recorder
+{
+
+    SyntheticMatStream::SyntheticMatStream(SyntheticSource * pSyntheticSource, bool depth, cv::Size size) :
+        _pSyntheticSource(nullptr),
+        _depth(depth),
+        _size(size),
+        _timestamp(0),
+        _lastFrameNumber(-1)
+    {
+        if (pSyntheticSource == nullptr)
+        {
+            throw MatStreamInitException("SyntheticMatStream::SyntheticMatStream: pSyntheticSource is nullptr");
+        }
+        _pSyntheticSource = pSyntheticSource;
+    }
+
+    SyntheticMatStream::~SyntheticMatStream()
+    {
+        _pSyntheticSource = nullptr;
+    }
+
+    cv::Mat * SyntheticMatStream::GetMat()
+    {
+        long long frameNumber = _pSyntheticSource->GetFrameNumber();
+        if (frameNumber == _lastFrameNumber)
+        {
+            return nullptr;
+        }
+        _lastFrameNumber = frameNumber;
+        _timestamp = _pSyntheticSource->GetTimestamp();
+        cv::Mat * pMat = nullptr;
+        if (_depth)
+        {
+            /* Moving ramp within the Kinect2 depth range */
+            pMat = new cv::Mat(_size, CV_16UC1);
+            for (int y = 0; y < _size.height; y++)
+            {
+                unsigned short * row = pMat->ptr<unsigned short>(y);
+                for (int x = 0; x < _size.width; x++)
+                {
+                    row[x] = static_cast<unsigned short>(500 + (x + y + frameNumber) % 4000);
+                }
+            }
+            if (_size.width >= 2)
+            {
+                pMat->at<unsigned short>(0, 0) = static_cast<unsigned short>(frameNumber & 0xFFFF);
+                pMat->at<unsigned short>(0, 1) = static_cast<unsigned short>((frameNumber >> 16) & 0xFFFF);
+            }
+        }
+        else
+        {
+            double level = static_cast<double>(frameNumber % 256);
+            pMat = new cv::Mat(_size, CV_8UC4, cv::Scalar(level, level, level, 255.0));
+            if (_size.width >= BIT_SIZE * BIT_NUMBER && _size.height >= BIT_SIZE)
+            {
+                for (int i = 0; i < BIT_NUMBER; i++)
+                {
+                    double value = ((frameNumber >> i) & 1) ? 255.0 : 0.0;
+                    (*pMat)(cv::Rect(i * BIT_SIZE, 0, BIT_SIZE, BIT_SIZE)).setTo(cv::Scalar(value, value, value, 255.0));
+                }
+            }
+        }
+        return pMat;
+    }
+
+    void SyntheticMatStream::SetSize(cv::Size size)
+    {
+        _size = size;
+    }
+
+    int SyntheticMatStream::GetWidth()
+    {
+        return _size.width;
+    }
+
+    int SyntheticMatStream::GetHeight()
+    {
+        return _size.height;
+    }
+
+    long long SyntheticMatStream::GetTimestamp()
+    {
+        return _timestamp;
+    }
+
+}
@@ -0,0 +1,38 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include "MatStream.h"
+#include "SyntheticSource.h"
+
+namespace kinect2recorder
+{
+
+    /* Frames of SyntheticSource with the frame number written into the image:
+       depth - pixels (0, 0) and (0, 1) hold the low and the high 16 bits,
+       color - 32 blocks of BIT_SIZE x BIT_SIZE in the top left corner (white - 1), lowest bit first */
+    class SyntheticMatStream : public MatStream
+    {
+    public:
+        const static int BIT_SIZE = 8;
+        const static int BIT_NUMBER = 32;
+    private:
+        SyntheticSource * _pSyntheticSource;
+        bool _depth;
+        cv::Size _size;
+        long long _timestamp;
+        long long _lastFrameNumber;
+    public:
+        SyntheticMatStream(SyntheticSource * pSyntheticSource, bool depth, cv::Size size);
+        ~SyntheticMatStream();
+        cv::Mat * GetMat();
+        void SetSize(cv::Size size);
+        int GetWidth();
+        int GetHeight();
+        long long GetTimestamp();
+    };
+
+}
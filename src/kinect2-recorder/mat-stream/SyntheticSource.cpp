@@ -0,0 +1,47 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "SyntheticSource.h"
+#include <chrono>
+#include <thread>
+
+namespace kinect2recorder
+{
+
+    SyntheticSource::SyntheticSource(int fps) :
+        _period(1000000LL / (fps > 0 ? fps : DEFAULT_FPS)),
+        _frameNumber(0),
+        _wakeupLatency(0)
+    {
+    }
+
+    void SyntheticSource::Update()
+    {
+        std::chrono::microseconds now = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch());
+        _frameNumber = now.count() / _period + 1;
+        std::chrono::steady_clock::time_point frameTime(std::chrono::microseconds(_frameNumber * _period));
+        std::this_thread::sleep_until(frameTime);
+        _wakeupLatency = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - frameTime).count();
+    }
+
+    long long SyntheticSource::GetFrameNumber()
+    {
+        return _frameNumber;
+    }
+
+    long long SyntheticSource::GetTimestamp()
+    {
+        return _frameNumber * _period;
+    }
+
+    long long SyntheticSource::GetWakeupLatency()
+    {
+        return _wakeupLatency;
+    }
+
+}
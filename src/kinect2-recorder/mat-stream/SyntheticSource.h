@@ -0,0 +1,32 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+
+namespace kinect2recorder
+{
+
+    /* Frame clock instead of Kinect2: frame K has timestamp K * period of the steady clock,
+       so every recorder on the machine sees the same frame numbers at the same timestamps */
+    class SyntheticSource
+    {
+    private:
+        long long _period;
+        long long _frameNumber;
+        long long _wakeupLatency;
+    public:
+        const static int DEFAULT_FPS = 30;
+        SyntheticSource(int fps);
+        /* Waits for the next frame */
+        void Update();
+        long long GetFrameNumber();
+        /* Device time (us) */
+        long long GetTimestamp();
+        /* How late (us) the last Update() woke up after the frame time */
+        long long GetWakeupLatency();
+    };
+
+}
@@ -0,0 +1,62 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "ImageExportNode.h"
+#include <opencv2/highgui/highgui.hpp>
+#include <stdexcept>
+
+namespace kinect2recorder
+{
+
+    ImageExportNode::ImageExportNode() :
+        _directoryPath(),
+        _interval(1),
+        _counter(0),
+        _mutex()
+    {
+    }
+
+    void ImageExportNode::Set(const std::string& directoryPath, int interval)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _directoryPath = directoryPath;
+        _interval = interval > 0 ? interval : 1;
+        _counter = 0;
+    }
+
+    bool ImageExportNode::IsEnabled()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return !_directoryPath.empty();
+    }
+
+    PipelineFramePtr ImageExportNode::Process(const PipelineFramePtr& pFrame)
+    {
+        std::string directoryPath;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_directoryPath.empty() || (_counter++ % _interval) != 0)
+            {
+                return PipelineFramePtr();
+            }
+            directoryPath = _directoryPath;
+        }
+        for (size_t i = 0; i < pFrame->mats.size(); i++)
+        {
+            if (!pFrame->mats[i].empty())
+            {
+                std::string path = directoryPath + "\\" + std::to_string(pFrame->timestamp) + "-" + std::to_string(i) + ".png";
+                if (!cv::imwrite(path, pFrame->mats[i]))
+                {
+                    /* Counted as a failure of the node by the pipeline */
+                    throw std::runtime_error("failed image export: " + path);
+                }
+            }
+        }
+        return PipelineFramePtr();
+    }
+
+}
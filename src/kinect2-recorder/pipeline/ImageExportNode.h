@@ -0,0 +1,32 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include "PipelineNode.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace kinect2recorder
+{
+
+    /* Saves every N-th frame as lossless PNG images, one per mode: DIRECTORY\TIMESTAMP-MODE.png */
+    class ImageExportNode : public PipelineNode
+    {
+    private:
+        std::string _directoryPath;
+        int _interval;
+        long long _counter;
+        std::mutex _mutex;
+    public:
+        ImageExportNode();
+        /* Empty path - off */
+        void Set(const std::string& directoryPath, int interval);
+        bool IsEnabled();
+        PipelineFramePtr Process(const PipelineFramePtr& pFrame);
+    };
+
+}
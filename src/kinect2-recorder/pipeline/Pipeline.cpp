@@ -0,0 +1,196 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "Pipeline.h"
+#include <chrono>
+
+namespace kinect2recorder
+{
+
+    Pipeline::Pipeline() :
+        _nodes(),
+        _ready(),
+        _threads(),
+        _running(false),
+        _mutex(),
+        _condition()
+    {
+    }
+
+    Pipeline::~Pipeline()
+    {
+        Stop();
+        for (size_t i = 0; i < _nodes.size(); i++)
+        {
+            delete(_nodes[i]->pNode);
+            delete(_nodes[i]);
+        }
+        _nodes.clear();
+    }
+
+    int Pipeline::AddNode(const std::string& name, PipelineNode * pNode, size_t maxQueue)
+    {
+        Node * pEntry = new Node();
+        pEntry->pNode = pNode;
+        pEntry->maxQueue = maxQueue > 0 ? maxQueue : 1;
+        pEntry->scheduled = false;
+        pEntry->stats.name = name;
+        _nodes.push_back(pEntry);
+        return static_cast<int>(_nodes.size()) - 1;
+    }
+
+    void Pipeline::Connect(int from, int to)
+    {
+        _nodes[from]->outputs.push_back(to);
+    }
+
+    void Pipeline::Start(int threadNumber)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_running)
+        {
+            return;
+        }
+        _running = true;
+        for (int i = 0; i < threadNumber; i++)
+        {
+            _threads.push_back(std::thread(&Pipeline::ThreadFunction, this));
+        }
+    }
+
+    void Pipeline::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_running)
+            {
+                return;
+            }
+            _running = false;
+        }
+        _condition.notify_all();
+        for (size_t i = 0; i < _threads.size(); i++)
+        {
+            _threads[i].join();
+        }
+        _threads.clear();
+        std::lock_guard<std::mutex> lock(_mutex);
+        _ready.clear();
+        for (size_t i = 0; i < _nodes.size(); i++)
+        {
+            _nodes[i]->queue.clear();
+            _nodes[i]->scheduled = false;
+        }
+    }
+
+    void Pipeline::Push(int node, const PipelineFramePtr& pFrame)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_running)
+        {
+            Enqueue(node, pFrame);
+        }
+    }
+
+    /* Under _mutex */
+    void Pipeline::Enqueue(int node, const PipelineFramePtr& pFrame)
+    {
+        Node * pEntry = _nodes[node];
+        if (pEntry->queue.size() >= pEntry->maxQueue)
+        {
+            pEntry->queue.pop_front();
+            pEntry->stats.droppedNumber++;
+        }
+        pEntry->queue.push_back(pFrame);
+        if (!pEntry->scheduled)
+        {
+            pEntry->scheduled = true;
+            _ready.push_back(node);
+            _condition.notify_one();
+        }
+    }
+
+    std::vector<PipelineNodeStats> Pipeline::TakeStats()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::vector<PipelineNodeStats> stats;
+        for (size_t i = 0; i < _nodes.size(); i++)
+        {
+            stats.push_back(_nodes[i]->stats);
+            _nodes[i]->stats = PipelineNodeStats();
+            _nodes[i]->stats.name = stats.back().name;
+        }
+        return stats;
+    }
+
+    cv::Mat Pipeline::Adopt(const cv::Mat& mat)
+    {
+        return mat.u == nullptr && !mat.empty() ? mat.clone() : mat;
+    }
+
+    void Pipeline::ThreadFunction()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true)
+        {
+            while (_running && _ready.empty())
+            {
+                _condition.wait(lock);
+            }
+            if (!_running)
+            {
+                break;
+            }
+            int node = _ready.front();
+            _ready.pop_front();
+            Node * pEntry = _nodes[node];
+            PipelineFramePtr pFrame = pEntry->queue.front();
+            pEntry->queue.pop_front();
+            lock.unlock();
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            PipelineFramePtr pOutput;
+            bool failed = false;
+            try
+            {
+                pOutput = pEntry->pNode->Process(pFrame);
+            }
+            catch (...)
+            {
+                failed = true;
+            }
+            std::chrono::duration<double, std::milli> processTime = std::chrono::steady_clock::now() - start;
+            lock.lock();
+            pEntry->stats.processedNumber++;
+            pEntry->stats.timeSumMs += processTime.count();
+            if (processTime.count() > pEntry->stats.timeMaxMs)
+            {
+                pEntry->stats.timeMaxMs = processTime.count();
+            }
+            if (failed)
+            {
+                pEntry->stats.failedNumber++;
+            }
+            if (pOutput && _running)
+            {
+                for (size_t i = 0; i < pEntry->outputs.size(); i++)
+                {
+                    Enqueue(pEntry->outputs[i], pOutput);
+                }
+            }
+            /* Still scheduled: the node goes to the end of the ready list, so other nodes get their turn */
+            if (pEntry->queue.empty())
+            {
+                pEntry->scheduled = false;
+            }
+            else
+            {
+                _ready.push_back(node);
+                _condition.notify_one();
+            }
+        }
+    }
+
+}
@@ -0,0 +1,61 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include "PipelineNode.h"
+#include "PipelineNodeStats.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace kinect2recorder
+{
+
+    /* Dataflow graph of nodes run by a thread pool. Every node has a bounded queue (the oldest frame is dropped
+       when it is full) and is run by one pool thread at a time, so a node sees its frames in order */
+    class Pipeline
+    {
+    private:
+        struct Node
+        {
+            PipelineNode * pNode;
+            std::vector<int> outputs;
+            std::deque<PipelineFramePtr> queue;
+            size_t maxQueue;
+            bool scheduled;
+            PipelineNodeStats stats;
+        };
+        std::vector<Node *> _nodes;
+        std::deque<int> _ready;
+        std::vector<std::thread> _threads;
+        bool _running;
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        void ThreadFunction();
+        void Enqueue(int node, const PipelineFramePtr& pFrame);
+    public:
+        Pipeline();
+        ~Pipeline();
+        /* Before Start(), the pipeline deletes the node */
+        int AddNode(const std::string& name, PipelineNode * pNode, size_t maxQueue);
+        void Connect(int from, int to);
+        void Start(int threadNumber);
+        /* Frames not processed yet are dropped */
+        void Stop();
+        /* Any thread, the frame goes to the node queue */
+        void Push(int node, const PipelineFramePtr& pFrame);
+        /* Counters of every node since the previous call */
+        std::vector<PipelineNodeStats> TakeStats();
+        /* A frame of mats that do not own their pixels (device buffers reused by the next frame) gets a copy,
+           other mats are shared. The acquisition thread adopts a frame once for every consumer (pipeline,
+           encode queue), they must not change it */
+        static cv::Mat Adopt(const cv::Mat& mat);
+    };
+
+}
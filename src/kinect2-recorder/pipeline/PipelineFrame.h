@@ -0,0 +1,34 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include <opencv2/core/core.hpp>
+#include <memory>
+#include <vector>
+
+namespace kinect2recorder
+{
+
+    /* A frame is not changed after it is pushed, so fan-out shares one frame between nodes without copies.
+       A stage makes a new frame, its unchanged mats share pixels with the input */
+    struct PipelineFrame
+    {
+        /* Indexed by mode number, empty - no mat of this mode */
+        std::vector<cv::Mat> mats;
+        /* Device time (us) */
+        long long timestamp;
+        long long number;
+        PipelineFrame() :
+            mats(),
+            timestamp(-1),
+            number(0)
+        {
+        }
+    };
+
+    typedef std::shared_ptr<const PipelineFrame> PipelineFramePtr;
+
+}
@@ -0,0 +1,35 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include "PipelineFrame.h"
+
+namespace kinect2recorder
+{
+
+    /* Source, stage or sink of the Pipeline */
+    class PipelineNode
+    {
+    public:
+        virtual ~PipelineNode()
+        {
+        }
+        /* Called in a pool thread, one frame at a time and in order for every node.
+           Returns the frame for the connected nodes, nullptr - nothing (a sink, a skipped frame) */
+        virtual PipelineFramePtr Process(const PipelineFramePtr& pFrame) = 0;
+    };
+
+    /* Entry of frames pushed by the acquisition thread */
+    class InputNode : public PipelineNode
+    {
+    public:
+        PipelineFramePtr Process(const PipelineFramePtr& pFrame)
+        {
+            return pFrame;
+        }
+    };
+
+}
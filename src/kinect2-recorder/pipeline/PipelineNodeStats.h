@@ -0,0 +1,33 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include <string>
+
+namespace kinect2recorder
+{
+
+    struct PipelineNodeStats
+    {
+        std::string name;
+        long long processedNumber;
+        /* Frames dropped from the node queue when the node does not keep up */
+        long long droppedNumber;
+        long long failedNumber;
+        double timeSumMs;
+        double timeMaxMs;
+        PipelineNodeStats() :
+            name(),
+            processedNumber(0),
+            droppedNumber(0),
+            failedNumber(0),
+            timeSumMs(0.0),
+            timeMaxMs(0.0)
+        {
+        }
+    };
+
+}
@@ -0,0 +1,28 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "PreviewSinkNode.h"
+
+namespace kinect2recorder
+{
+
+    PreviewSinkNode::PreviewSinkNode(Preview& preview, int window, int modeNumber) :
+        _preview(preview),
+        _window(window),
+        _modeNumber(modeNumber)
+    {
+    }
+
+    PipelineFramePtr PreviewSinkNode::Process(const PipelineFramePtr& pFrame)
+    {
+        if (static_cast<size_t>(_modeNumber) < pFrame->mats.size())
+        {
+            _preview.Offer(_window, pFrame->mats[_modeNumber]);
+        }
+        return PipelineFramePtr();
+    }
+
+}
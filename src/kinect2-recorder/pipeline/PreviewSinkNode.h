@@ -0,0 +1,26 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include "PipelineNode.h"
+#include "../preview/Preview.h"
+
+namespace kinect2recorder
+{
+
+    /* Offers one mode of the frames to a Preview window */
+    class PreviewSinkNode : public PipelineNode
+    {
+    private:
+        Preview& _preview;
+        int _window;
+        int _modeNumber;
+    public:
+        PreviewSinkNode(Preview& preview, int window, int modeNumber);
+        PipelineFramePtr Process(const PipelineFramePtr& pFrame);
+    };
+
+}
@@ -0,0 +1,42 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "ResizeNode.h"
+#include <opencv2/imgproc/imgproc.hpp>
+
+namespace kinect2recorder
+{
+
+    ResizeNode::ResizeNode(int width) :
+        _width(width)
+    {
+    }
+
+    void ResizeNode::SetWidth(int width)
+    {
+        _width.store(width);
+    }
+
+    PipelineFramePtr ResizeNode::Process(const PipelineFramePtr& pFrame)
+    {
+        int width = _width.load();
+        if (width <= 0)
+        {
+            return pFrame;
+        }
+        std::shared_ptr<PipelineFrame> pOutput = std::make_shared<PipelineFrame>(*pFrame);
+        for (size_t i = 0; i < pOutput->mats.size(); i++)
+        {
+            const cv::Mat& mat = pFrame->mats[i];
+            if (!mat.empty() && mat.cols > width)
+            {
+                cv::resize(mat, pOutput->mats[i], cv::Size(width, mat.rows * width / mat.cols), 0, 0, cv::INTER_NEAREST);
+            }
+        }
+        return pOutput;
+    }
+
+}
@@ -0,0 +1,26 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include "PipelineNode.h"
+#include <atomic>
+
+namespace kinect2recorder
+{
+
+    /* Downscales every mat to a width keeping the aspect ratio, nearest neighbour (depth values are not mixed) */
+    class ResizeNode : public PipelineNode
+    {
+    private:
+        std::atomic<int> _width;
+    public:
+        /* 0 - frames go through unchanged */
+        ResizeNode(int width);
+        void SetWidth(int width);
+        PipelineFramePtr Process(const PipelineFramePtr& pFrame);
+    };
+
+}
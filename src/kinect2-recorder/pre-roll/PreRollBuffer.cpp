@@ -0,0 +1,351 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "PreRollBuffer.h"
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <chrono>
+
+namespace kinect2recorder
+{
+
+    PreRollBuffer::PreRollBuffer() :
+        _streams(),
+        _pending(),
+        _pendingMatNumber(0),
+        _frames(),
+        _capacity(0),
+        _maxBytes(0),
+        _bytes(0),
+        _busy(false),
+        _running(false),
+        _generation(0),
+        _encodedNumber(0),
+        _droppedNumber(0),
+        _encodeTimeSumMs(0.0),
+        _flushes(),
+        _mutex(),
+        _condition(),
+        _idleCondition(),
+        _thread()
+    {
+    }
+
+    PreRollBuffer::~PreRollBuffer()
+    {
+        Stop();
+    }
+
+    int PreRollBuffer::AddStream(const std::string& extension, const std::vector<int>& params)
+    {
+        Stream stream;
+        stream.extension = extension;
+        stream.params = params;
+        stream.type = -1;
+        _streams.push_back(stream);
+        return static_cast<int>(_streams.size()) - 1;
+    }
+
+    void PreRollBuffer::Start()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_running)
+        {
+            return;
+        }
+        _running = true;
+        _thread = std::thread(&PreRollBuffer::ThreadFunction, this);
+    }
+
+    void PreRollBuffer::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_running)
+            {
+                return;
+            }
+            _running = false;
+        }
+        _condition.notify_all();
+        _thread.join();
+        Clear();
+    }
+
+    void PreRollBuffer::SetCapacity(size_t frames, size_t maxBytes)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _capacity = frames;
+        _maxBytes = maxBytes;
+        Trim();
+    }
+
+    void PreRollBuffer::Trim()
+    {
+        while (!_frames.empty() && (_frames.size() > _capacity || _bytes > _maxBytes))
+        {
+            for (size_t i = 0; i < _frames.front().size(); i++)
+            {
+                _bytes -= _frames.front()[i].size();
+            }
+            _frames.pop_front();
+        }
+    }
+
+    void PreRollBuffer::Push(const std::vector<cv::Mat>& mats)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_running || _capacity == 0)
+            {
+                return;
+            }
+        }
+        std::vector<cv::Mat> copies(mats.size());
+        for (size_t i = 0; i < mats.size(); i++)
+        {
+            if (!mats[i].empty())
+            {
+                copies[i] = mats[i].clone();
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_running || _capacity == 0)
+            {
+                return;
+            }
+            for (size_t i = 0; i < copies.size() && i < _streams.size(); i++)
+            {
+                if (!copies[i].empty())
+                {
+                    _streams[i].type = copies[i].type();
+                }
+            }
+            /* The worker does not keep up, the oldest raw frame is lost rather than stalling acquisition,
+               its place stays as a gap */
+            if (_pendingMatNumber >= MAX_PENDING)
+            {
+                for (size_t i = 0; i < _pending.size(); i++)
+                {
+                    if (!_pending[i].empty())
+                    {
+                        _pending[i].clear();
+                        break;
+                    }
+                }
+                _pendingMatNumber--;
+                _droppedNumber++;
+            }
+            _pending.push_back(copies);
+            _pendingMatNumber++;
+        }
+        _condition.notify_one();
+    }
+
+    void PreRollBuffer::PushGap(size_t number)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_running || _capacity == 0)
+            {
+                return;
+            }
+            /* Older frames are pushed out of the ring anyway */
+            for (size_t i = 0; i < number && i < _capacity; i++)
+            {
+                _pending.push_back(std::vector<cv::Mat>());
+            }
+        }
+        _condition.notify_one();
+    }
+
+    void PreRollBuffer::Take(HeldFrames& frames)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        /* The worker gets nothing new, the frame it compresses is older than the pending ones */
+        std::deque<std::vector<cv::Mat> > pending;
+        pending.swap(_pending);
+        _pendingMatNumber = 0;
+        while (_busy)
+        {
+            _idleCondition.wait(lock);
+        }
+        frames._frames.clear();
+        frames._frames.swap(_frames);
+        frames._rawFrames.swap(pending);
+        frames._types.clear();
+        for (size_t i = 0; i < _streams.size(); i++)
+        {
+            frames._types.push_back(_streams[i].type);
+        }
+        _bytes = 0;
+    }
+
+    size_t PreRollBuffer::HeldFrames::GetFrameNumber() const
+    {
+        return _frames.size() + _rawFrames.size();
+    }
+
+    size_t PreRollBuffer::HeldFrames::GetFrameNumber(size_t streamNumber) const
+    {
+        size_t frameNumber = 0;
+        for (size_t i = 0; i < _frames.size(); i++)
+        {
+            if (streamNumber < _frames[i].size() && !_frames[i][streamNumber].empty())
+            {
+                frameNumber++;
+            }
+        }
+        for (size_t i = 0; i < _rawFrames.size(); i++)
+        {
+            if (streamNumber < _rawFrames[i].size() && !_rawFrames[i][streamNumber].empty())
+            {
+                frameNumber++;
+            }
+        }
+        return frameNumber;
+    }
+
+    bool PreRollBuffer::HeldFrames::Pop(std::vector<cv::Mat>& mats)
+    {
+        if (_frames.empty())
+        {
+            if (_rawFrames.empty())
+            {
+                return false;
+            }
+            mats.swap(_rawFrames.front());
+            _rawFrames.pop_front();
+            return true;
+        }
+        EncodedFrame frame;
+        frame.swap(_frames.front());
+        _frames.pop_front();
+        mats.assign(frame.size(), cv::Mat());
+        for (size_t i = 0; i < frame.size(); i++)
+        {
+            if (!frame[i].empty())
+            {
+                mats[i] = cv::imdecode(frame[i], cv::IMREAD_UNCHANGED);
+                if (i < _types.size() && _types[i] == CV_8UC4 && mats[i].type() == CV_8UC3)
+                {
+                    cv::cvtColor(mats[i], mats[i], cv::COLOR_BGR2BGRA);
+                }
+            }
+        }
+        return true;
+    }
+
+    void PreRollBuffer::Clear()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending.clear();
+        _pendingMatNumber = 0;
+        _frames.clear();
+        _bytes = 0;
+        /* A frame being compressed right now belongs to the old content */
+        _generation++;
+    }
+
+    size_t PreRollBuffer::GetFrameNumber()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _frames.size();
+    }
+
+    size_t PreRollBuffer::GetBytes()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _bytes;
+    }
+
+    void PreRollBuffer::TakeEncodeStats(long long& encodedNumber, long long& droppedNumber, double& encodeTimeSumMs)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        encodedNumber = _encodedNumber;
+        droppedNumber = _droppedNumber;
+        encodeTimeSumMs = _encodeTimeSumMs;
+        _encodedNumber = 0;
+        _droppedNumber = 0;
+        _encodeTimeSumMs = 0.0;
+    }
+
+    void PreRollBuffer::ReportFlush(long long frameNumber, double timeMs)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _flushes.push_back(std::make_pair(frameNumber, timeMs));
+    }
+
+    bool PreRollBuffer::TakeFlush(long long& frameNumber, double& timeMs)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_flushes.empty())
+        {
+            return false;
+        }
+        frameNumber = _flushes.front().first;
+        timeMs = _flushes.front().second;
+        _flushes.pop_front();
+        return true;
+    }
+
+    void PreRollBuffer::ThreadFunction()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true)
+        {
+            while (_running && _pending.empty())
+            {
+                _condition.wait(lock);
+            }
+            if (!_running)
+            {
+                break;
+            }
+            std::vector<cv::Mat> mats;
+            mats.swap(_pending.front());
+            _pending.pop_front();
+            if (!mats.empty())
+            {
+                _pendingMatNumber--;
+            }
+            long long generation = _generation;
+            _busy = true;
+            lock.unlock();
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            EncodedFrame frame(mats.size());
+            size_t bytes = 0;
+            for (size_t i = 0; i < mats.size() && i < _streams.size(); i++)
+            {
+                if (!mats[i].empty())
+                {
+                    cv::imencode(_streams[i].extension, mats[i], frame[i], _streams[i].params);
+                    bytes += frame[i].size();
+                }
+            }
+            std::chrono::duration<double, std::milli> encodeTime = std::chrono::steady_clock::now() - start;
+            lock.lock();
+            if (generation == _generation)
+            {
+                _frames.push_back(EncodedFrame());
+                _frames.back().swap(frame);
+                _bytes += bytes;
+                Trim();
+            }
+            if (!mats.empty())
+            {
+                _encodedNumber++;
+                _encodeTimeSumMs += encodeTime.count();
+            }
+            _busy = false;
+            _idleCondition.notify_all();
+        }
+        _busy = false;
+        _idleCondition.notify_all();
+    }
+
+}
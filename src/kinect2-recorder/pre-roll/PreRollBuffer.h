@@ -0,0 +1,96 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include <opencv2/core/core.hpp>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace kinect2recorder
+{
+
+    /* Bounded ring of the last frames, every stream is compressed by its own image codec in a worker thread.
+       A frame lost by the device or dropped before compression is kept as a gap: its mats are empty */
+    class PreRollBuffer
+    {
+    private:
+        const static size_t MAX_PENDING = 8;
+        struct Stream
+        {
+            std::string extension;
+            std::vector<int> params;
+            /* OpenCV type of the pushed frames, restored on decoding (JPEG has no alpha) */
+            int type;
+        };
+        typedef std::vector<std::vector<unsigned char> > EncodedFrame;
+    public:
+        /* Frames moved out of the buffer in their order, compressed or still raw. Decoded one by one in any thread */
+        class HeldFrames
+        {
+            friend class PreRollBuffer;
+        private:
+            std::deque<EncodedFrame> _frames;
+            std::deque<std::vector<cv::Mat> > _rawFrames;
+            std::vector<int> _types;
+        public:
+            size_t GetFrameNumber() const;
+            /* Frames of the stream which are not gaps */
+            size_t GetFrameNumber(size_t streamNumber) const;
+            /* Removes the oldest frame, compressed ones are decoded with the type the stream was pushed with */
+            bool Pop(std::vector<cv::Mat>& mats);
+        };
+    private:
+        std::vector<Stream> _streams;
+        std::deque<std::vector<cv::Mat> > _pending;
+        /* Pending frames with pixels, the others are gaps */
+        size_t _pendingMatNumber;
+        std::deque<EncodedFrame> _frames;
+        size_t _capacity;
+        size_t _maxBytes;
+        size_t _bytes;
+        bool _busy;
+        bool _running;
+        long long _generation;
+        long long _encodedNumber;
+        long long _droppedNumber;
+        double _encodeTimeSumMs;
+        std::deque<std::pair<long long, double> > _flushes;
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        std::condition_variable _idleCondition;
+        std::thread _thread;
+        void ThreadFunction();
+        void Trim();
+    public:
+        PreRollBuffer();
+        ~PreRollBuffer();
+        /* Before Start(), extension and params are the ones of cv::imencode */
+        int AddStream(const std::string& extension, const std::vector<int>& params);
+        void Start();
+        void Stop();
+        void SetCapacity(size_t frames, size_t maxBytes);
+        /* Empty mats are not stored (inactive streams) */
+        void Push(const std::vector<cv::Mat>& mats);
+        /* Frames lost between the previous push and the next one */
+        void PushGap(size_t number);
+        /* Moves every held frame out, waits only for the frame being compressed */
+        void Take(HeldFrames& frames);
+        void Clear();
+        size_t GetFrameNumber();
+        size_t GetBytes();
+        /* Counters since the previous call */
+        void TakeEncodeStats(long long& encodedNumber, long long& droppedNumber, double& encodeTimeSumMs);
+        /* Written frames and time of a flush, from the thread writing the taken frames */
+        void ReportFlush(long long frameNumber, double timeMs);
+        bool TakeFlush(long long& frameNumber, double& timeMs);
+    };
+
+}
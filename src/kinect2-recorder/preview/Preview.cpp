@@ -0,0 +1,195 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "Preview.h"
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+
+namespace kinect2recorder
+{
+
+    Preview::Preview() :
+        _slots(),
+        _mutex(),
+        _thread(),
+        _running(false),
+        _rate(DEFAULT_RATE),
+        _width(DEFAULT_WIDTH),
+        _depthLut()
+    {
+        cv::Mat gray(1, 256, CV_8UC1);
+        for (int i = 0; i < 256; i++)
+        {
+            gray.ptr<unsigned char>(0)[i] = static_cast<unsigned char>(i);
+        }
+        cv::applyColorMap(gray, _depthLut, cv::COLORMAP_JET);
+        /* Zero depth is invalid */
+        unsigned char * invalid = _depthLut.ptr<unsigned char>(0);
+        invalid[0] = 0;
+        invalid[1] = 0;
+        invalid[2] = 0;
+    }
+
+    Preview::~Preview()
+    {
+        Stop();
+    }
+
+    int Preview::AddWindow(const std::string& windowName, bool depth)
+    {
+        Slot slot;
+        slot.windowName = windowName;
+        slot.depth = depth;
+        slot.hasPending = false;
+        slot.closeRequested = false;
+        slot.windowOpened = false;
+        _slots.push_back(slot);
+        return static_cast<int>(_slots.size()) - 1;
+    }
+
+    void Preview::Start()
+    {
+        if (_running.load())
+        {
+            return;
+        }
+        _running.store(true);
+        _thread = std::thread(&Preview::ThreadFunction, this);
+    }
+
+    void Preview::Stop()
+    {
+        if (!_running.load())
+        {
+            return;
+        }
+        _running.store(false);
+        _thread.join();
+    }
+
+    bool Preview::IsRunning()
+    {
+        return _running.load();
+    }
+
+    void Preview::SetRate(int rate)
+    {
+        _rate.store(rate);
+    }
+
+    int Preview::GetRate()
+    {
+        return _rate.load();
+    }
+
+    void Preview::SetWidth(int width)
+    {
+        _width.store(width);
+    }
+
+    void Preview::Offer(int window, const cv::Mat& mat)
+    {
+        if (!_running.load() || mat.empty())
+        {
+            return;
+        }
+        Slot& slot = _slots[window];
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - slot.lastOfferTime < std::chrono::milliseconds(1000 / _rate.load()))
+        {
+            return;
+        }
+        slot.lastOfferTime = now;
+        int width = std::min(_width.load(), mat.cols);
+        cv::Mat small;
+        cv::resize(mat, small, cv::Size(width, mat.rows * width / mat.cols), 0, 0, cv::INTER_NEAREST);
+        /* The previous frame is still being taken by the preview thread, skip this one */
+        if (!_mutex.try_lock())
+        {
+            return;
+        }
+        slot.pending = small;
+        slot.hasPending = true;
+        _mutex.unlock();
+    }
+
+    void Preview::Close(int window)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _slots[window].pending = cv::Mat();
+        _slots[window].hasPending = false;
+        _slots[window].closeRequested = true;
+    }
+
+    void Preview::Show(Slot& slot, const cv::Mat& mat, cv::Mat& depth8, cv::Mat& depthBgr, cv::Mat& colored)
+    {
+        if (slot.depth && mat.type() == CV_16UC1)
+        {
+            cv::convertScaleAbs(mat, depth8, 255.0 / MAX_DEPTH);
+            cv::cvtColor(depth8, depthBgr, cv::COLOR_GRAY2BGR);
+            cv::LUT(depthBgr, _depthLut, colored);
+            cv::imshow(slot.windowName, colored);
+        }
+        else
+        {
+            cv::imshow(slot.windowName, mat);
+        }
+        slot.windowOpened = true;
+    }
+
+    void Preview::ThreadFunction()
+    {
+        cv::Mat mat;
+        cv::Mat depth8;
+        cv::Mat depthBgr;
+        cv::Mat colored;
+        while (_running.load())
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < _slots.size(); i++)
+            {
+                Slot& slot = _slots[i];
+                bool close = false;
+                bool show = false;
+                _mutex.lock();
+                if (slot.closeRequested)
+                {
+                    slot.closeRequested = false;
+                    close = true;
+                }
+                if (slot.hasPending)
+                {
+                    mat = slot.pending;
+                    slot.pending = cv::Mat();
+                    slot.hasPending = false;
+                    show = true;
+                }
+                _mutex.unlock();
+                if (close && slot.windowOpened)
+                {
+                    cv::destroyWindow(slot.windowName);
+                    slot.windowOpened = false;
+                }
+                if (show)
+                {
+                    Show(slot, mat, depth8, depthBgr, colored);
+                }
+            }
+            cv::waitKey(1);
+            std::this_thread::sleep_until(start + std::chrono::milliseconds(1000 / _rate.load()));
+        }
+        for (size_t i = 0; i < _slots.size(); i++)
+        {
+            if (_slots[i].windowOpened)
+            {
+                cv::destroyWindow(_slots[i].windowName);
+                _slots[i].windowOpened = false;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,61 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include <opencv2/core/core.hpp>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace kinect2recorder
+{
+
+    /* Shows frames in its own thread, the acquisition thread only offers downscaled frames and never waits */
+    class Preview
+    {
+    private:
+        const static int DEFAULT_RATE = 10;
+        const static int DEFAULT_WIDTH = 480;
+        const static int MAX_DEPTH = 4500;
+        struct Slot
+        {
+            std::string windowName;
+            bool depth;
+            cv::Mat pending;
+            bool hasPending;
+            bool closeRequested;
+            bool windowOpened;
+            std::chrono::steady_clock::time_point lastOfferTime;
+        };
+        std::vector<Slot> _slots;
+        std::mutex _mutex;
+        std::thread _thread;
+        std::atomic<bool> _running;
+        std::atomic<int> _rate;
+        std::atomic<int> _width;
+        cv::Mat _depthLut;
+        void ThreadFunction();
+        void Show(Slot& slot, const cv::Mat& mat, cv::Mat& depth8, cv::Mat& depthBgr, cv::Mat& colored);
+    public:
+        Preview();
+        ~Preview();
+        /* Before Start() */
+        int AddWindow(const std::string& windowName, bool depth);
+        void Start();
+        void Stop();
+        bool IsRunning();
+        void SetRate(int rate);
+        int GetRate();
+        void SetWidth(int width);
+        /* Acquisition thread */
+        void Offer(int window, const cv::Mat& mat);
+        void Close(int window);
+    };
+
+}
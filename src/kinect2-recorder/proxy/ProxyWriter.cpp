@@ -0,0 +1,302 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "ProxyWriter.h"
+#include "../segment/WriterPreparer.h"
+#include "../thread-placement/ThreadPlacement.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <algorithm>
+
+namespace kinect2recorder
+{
+
+    ProxyWriter::ProxyWriter(size_t maxFrames) :
+        _maxFrames(maxFrames),
+        _frameNumber(0),
+        _entries(),
+        _failedPaths(),
+        _writtenNumber(0),
+        _droppedNumber(0),
+        _running(false),
+        _mutex(),
+        _condition(),
+        _thread(),
+        _pVideoWriter(nullptr),
+        _path(),
+        _levels()
+    {
+    }
+
+    ProxyWriter::~ProxyWriter()
+    {
+        Stop();
+    }
+
+    void ProxyWriter::Start()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_running)
+        {
+            return;
+        }
+        _running = true;
+        _thread = std::thread(&ProxyWriter::ThreadFunction, this);
+    }
+
+    void ProxyWriter::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_running)
+            {
+                return;
+            }
+            _running = false;
+        }
+        _condition.notify_all();
+        _thread.join();
+    }
+
+    void ProxyWriter::Push(Entry& entry)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (entry.kind == ENTRY_WRITE)
+            {
+                if (_frameNumber >= _maxFrames)
+                {
+                    entry.kind = ENTRY_SKIP;
+                    entry.mat.release();
+                    _droppedNumber++;
+                }
+                else
+                {
+                    _frameNumber++;
+                }
+            }
+            _entries.push_back(Entry());
+            std::swap(_entries.back(), entry);
+        }
+        _condition.notify_one();
+    }
+
+    void ProxyWriter::Open(const std::string& path, const video_io::Metadata& metadata,
+        const std::vector<video_io::VideoWriter::VideoStreamParams>& params, const std::vector<int>& levels,
+        const std::vector<double>& startTimes)
+    {
+        Entry entry;
+        entry.kind = ENTRY_OPEN;
+        entry.path = path;
+        entry.metadata = metadata;
+        entry.params = params;
+        entry.levels = levels;
+        entry.startTimes = startTimes;
+        entry.videoStreamNumber = -1;
+        Push(entry);
+    }
+
+    void ProxyWriter::Write(int videoStreamNumber, const cv::Mat& mat)
+    {
+        Entry entry;
+        entry.kind = ENTRY_WRITE;
+        entry.videoStreamNumber = videoStreamNumber;
+        entry.mat = mat;
+        Push(entry);
+    }
+
+    void ProxyWriter::Skip(int videoStreamNumber)
+    {
+        Entry entry;
+        entry.kind = ENTRY_SKIP;
+        entry.videoStreamNumber = videoStreamNumber;
+        Push(entry);
+    }
+
+    void ProxyWriter::Close()
+    {
+        Entry entry;
+        entry.kind = ENTRY_CLOSE;
+        entry.videoStreamNumber = -1;
+        Push(entry);
+    }
+
+    bool ProxyWriter::TakeFailure(std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_failedPaths.empty())
+        {
+            return false;
+        }
+        path = _failedPaths.front();
+        _failedPaths.pop_front();
+        return true;
+    }
+
+    void ProxyWriter::TakeStats(long long& writtenNumber, long long& droppedNumber)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        writtenNumber = _writtenNumber;
+        droppedNumber = _droppedNumber;
+        _writtenNumber = 0;
+        _droppedNumber = 0;
+    }
+
+    int ProxyWriter::GetSize(int size, int levels)
+    {
+        for (int i = 0; i < levels; i++)
+        {
+            size = (size + 1) / 2;
+        }
+        return std::max(2, size & ~1);
+    }
+
+    int ProxyWriter::GetLevels(int size, int minSize)
+    {
+        int levels = 0;
+        while (GetSize(size, levels + 1) >= minSize && GetSize(size, levels + 1) < GetSize(size, levels))
+        {
+            levels++;
+        }
+        return levels;
+    }
+
+    void ProxyWriter::InnerOpen(Entry& entry)
+    {
+        InnerClose();
+        std::vector<video_io::VideoWriter::VideoStreamParams> params = entry.params;
+        for (size_t i = 0; i < params.size(); i++)
+        {
+            params[i].width = GetSize(params[i].width, entry.levels[i]);
+            params[i].height = GetSize(params[i].height, entry.levels[i]);
+            params[i].nbThreads = 1;
+            params[i].maxFramesInFlight = 0;
+        }
+        int failure;
+        int failedStreamNumber;
+        _pVideoWriter = WriterPreparer::Open(entry.path, entry.metadata, params, failure, failedStreamNumber);
+        _path = entry.path;
+        _levels = entry.levels;
+        if (_pVideoWriter == nullptr)
+        {
+            InnerFail();
+            return;
+        }
+        for (size_t i = 0; i < entry.startTimes.size() && i < params.size(); i++)
+        {
+            _pVideoWriter->setStartTime(static_cast<int>(i), entry.startTimes[i]);
+        }
+    }
+
+    void ProxyWriter::InnerWrite(Entry& entry)
+    {
+        cv::Mat level = entry.mat;
+        cv::Mat nextLevel;
+        for (int i = 0; i < _levels[entry.videoStreamNumber]; i++)
+        {
+            cv::pyrDown(level, nextLevel);
+            level = nextLevel;
+            nextLevel = cv::Mat();
+        }
+        int width = GetSize(entry.mat.cols, _levels[entry.videoStreamNumber]);
+        int height = GetSize(entry.mat.rows, _levels[entry.videoStreamNumber]);
+        cv::Mat proxyMat = level(cv::Rect(0, 0, std::min(width, level.cols), std::min(height, level.rows)));
+        _pVideoWriter->write(proxyMat, entry.videoStreamNumber);
+    }
+
+    void ProxyWriter::InnerClose()
+    {
+        if (_pVideoWriter == nullptr)
+        {
+            return;
+        }
+        try
+        {
+            _pVideoWriter->close();
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _failedPaths.push_back(_path);
+        }
+        delete(_pVideoWriter);
+        _pVideoWriter = nullptr;
+    }
+
+    /* The rest of the file is not written */
+    void ProxyWriter::InnerFail()
+    {
+        if (_pVideoWriter != nullptr)
+        {
+            delete(_pVideoWriter);
+            _pVideoWriter = nullptr;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        _failedPaths.push_back(_path);
+    }
+
+    void ProxyWriter::ThreadFunction()
+    {
+        /* Browsing copy: every other thread of the recorder goes first */
+        ThreadPlacement::LowerCurrentThreadPriority();
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true)
+        {
+            while (_running && _entries.empty())
+            {
+                _condition.wait(lock);
+            }
+            if (_entries.empty())
+            {
+                break;
+            }
+            Entry entry;
+            std::swap(entry, _entries.front());
+            _entries.pop_front();
+            lock.unlock();
+            bool written = false;
+            if (entry.kind == ENTRY_OPEN)
+            {
+                InnerOpen(entry);
+            }
+            else if (entry.kind == ENTRY_CLOSE)
+            {
+                InnerClose();
+            }
+            else if (_pVideoWriter != nullptr)
+            {
+                try
+                {
+                    if (entry.kind == ENTRY_WRITE)
+                    {
+                        InnerWrite(entry);
+                        written = true;
+                    }
+                    else
+                    {
+                        _pVideoWriter->skip(entry.videoStreamNumber);
+                    }
+                }
+                catch (...)
+                {
+                    InnerFail();
+                }
+            }
+            entry.mat.release();
+            lock.lock();
+            if (entry.kind == ENTRY_WRITE)
+            {
+                _frameNumber--;
+            }
+            if (written)
+            {
+                _writtenNumber++;
+            }
+        }
+        lock.unlock();
+        InnerClose();
+    }
+
+}
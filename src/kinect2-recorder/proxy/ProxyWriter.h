@@ -0,0 +1,87 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include "VideoIO/VideoWriter.h"
+#include <opencv2/core/core.hpp>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace kinect2recorder
+{
+
+    /* Low resolution copy of the recording for browsing, written in its own low priority thread. Every frame
+       is halved levels times (image pyramid, every level is made from the previous one) and encoded to the proxy
+       file. Frames above maxFrames waiting are skipped in the proxy, the recording never waits for it.
+       Open, Write, Skip, Close - from one thread */
+    class ProxyWriter
+    {
+    private:
+        const static int ENTRY_OPEN = 0;
+        const static int ENTRY_WRITE = 1;
+        const static int ENTRY_SKIP = 2;
+        const static int ENTRY_CLOSE = 3;
+        struct Entry
+        {
+            int kind;
+            std::string path;
+            video_io::Metadata metadata;
+            std::vector<video_io::VideoWriter::VideoStreamParams> params;
+            std::vector<int> levels;
+            std::vector<double> startTimes;
+            int videoStreamNumber;
+            cv::Mat mat;
+        };
+        size_t _maxFrames;
+        size_t _frameNumber;
+        std::deque<Entry> _entries;
+        std::deque<std::string> _failedPaths;
+        long long _writtenNumber;
+        long long _droppedNumber;
+        bool _running;
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        std::thread _thread;
+        /* Proxy thread */
+        video_io::VideoWriter * _pVideoWriter;
+        std::string _path;
+        std::vector<int> _levels;
+        void ThreadFunction();
+        void Push(Entry& entry);
+        void InnerOpen(Entry& entry);
+        void InnerWrite(Entry& entry);
+        void InnerClose();
+        void InnerFail();
+    public:
+        ProxyWriter(size_t maxFrames);
+        ~ProxyWriter();
+        void Start();
+        /* Writes and closes everything queued before return */
+        void Stop();
+        /* The previous proxy file is closed. params - of the full resolution streams, levels - halvings of every stream,
+           startTimes - of every stream */
+        void Open(const std::string& path, const video_io::Metadata& metadata,
+            const std::vector<video_io::VideoWriter::VideoStreamParams>& params, const std::vector<int>& levels,
+            const std::vector<double>& startTimes);
+        /* The pixels are shared, not copied: the mat must not be changed after */
+        void Write(int videoStreamNumber, const cv::Mat& mat);
+        void Skip(int videoStreamNumber);
+        void Close();
+        /* Proxy files failed to open or to write, the recording goes on without them */
+        bool TakeFailure(std::string& path);
+        /* Counters since the previous call */
+        void TakeStats(long long& writtenNumber, long long& droppedNumber);
+        /* Size after levels halvings, even (the codecs need it) */
+        static int GetSize(int size, int levels);
+        /* Halvings bringing size down to minSize at least, 0 - the stream is not larger */
+        static int GetLevels(int size, int minSize);
+    };
+
+}
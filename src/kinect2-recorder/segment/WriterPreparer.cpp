@@ -0,0 +1,151 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "WriterPreparer.h"
+#include <cstdio>
+
+namespace kinect2recorder
+{
+
+    WriterPreparer::WriterPreparer() :
+        _path(),
+        _metadata(),
+        _params(),
+        _pVideoWriter(nullptr),
+        _failure(FAILED_NONE),
+        _failedStreamNumber(-1),
+        _preparing(false),
+        _ready(false),
+        _thread()
+    {
+    }
+
+    WriterPreparer::~WriterPreparer()
+    {
+        Discard();
+    }
+
+    video_io::VideoWriter * WriterPreparer::Open(const std::string& path, const video_io::Metadata& metadata,
+        const std::vector<video_io::VideoWriter::VideoStreamParams>& params, int& failure, int& failedStreamNumber)
+    {
+        failure = FAILED_NONE;
+        failedStreamNumber = -1;
+        video_io::VideoWriter * pVideoWriter = new video_io::VideoWriter();
+        try
+        {
+            pVideoWriter->open(path.c_str());
+        }
+        catch (...)
+        {
+            failure = FAILED_OPEN;
+            delete(pVideoWriter);
+            return nullptr;
+        }
+        try
+        {
+            failure = FAILED_METADATA;
+            pVideoWriter->setMetadata(metadata);
+            failure = FAILED_ADD_VIDEO_STREAM;
+            for (size_t i = 0; i < params.size(); i++)
+            {
+                failedStreamNumber = static_cast<int>(i);
+                pVideoWriter->addVideoStream(params[i]);
+            }
+            pVideoWriter->setInterleaving(INTERLEAVE_MAX_DELAY_MS / 1000.0,
+                static_cast<long long>(INTERLEAVE_MAX_MEGABYTES) * 1024 * 1024, video_io::INTERLEAVE_FLUSH);
+        }
+        catch (...)
+        {
+            try
+            {
+                pVideoWriter->close();
+            }
+            catch (...)
+            {
+            }
+            delete(pVideoWriter);
+            return nullptr;
+        }
+        failure = FAILED_NONE;
+        failedStreamNumber = -1;
+        return pVideoWriter;
+    }
+
+    void WriterPreparer::Prepare(const std::string& path, const video_io::Metadata& metadata,
+        const std::vector<video_io::VideoWriter::VideoStreamParams>& params)
+    {
+        Discard();
+        _path = path;
+        _metadata = metadata;
+        _params = params;
+        _preparing = true;
+        _ready.store(false);
+        _thread = std::thread(&WriterPreparer::ThreadFunction, this);
+    }
+
+    void WriterPreparer::ThreadFunction()
+    {
+        _pVideoWriter = Open(_path, _metadata, _params, _failure, _failedStreamNumber);
+        _ready.store(true);
+    }
+
+    bool WriterPreparer::IsPreparing()
+    {
+        return _preparing;
+    }
+
+    bool WriterPreparer::IsReady()
+    {
+        return _preparing && _ready.load();
+    }
+
+    const std::string& WriterPreparer::GetPath()
+    {
+        return _path;
+    }
+
+    video_io::VideoWriter * WriterPreparer::Take(int& failure, int& failedStreamNumber)
+    {
+        if (!_preparing)
+        {
+            failure = FAILED_OPEN;
+            failedStreamNumber = -1;
+            return nullptr;
+        }
+        _thread.join();
+        _preparing = false;
+        failure = _failure;
+        failedStreamNumber = _failedStreamNumber;
+        video_io::VideoWriter * pVideoWriter = _pVideoWriter;
+        _pVideoWriter = nullptr;
+        return pVideoWriter;
+    }
+
+    void WriterPreparer::Discard()
+    {
+        if (!_preparing)
+        {
+            return;
+        }
+        int failure;
+        int failedStreamNumber;
+        video_io::VideoWriter * pVideoWriter = Take(failure, failedStreamNumber);
+        if (pVideoWriter != nullptr)
+        {
+            /* Nothing is written yet, so the header is not written either */
+            try
+            {
+                pVideoWriter->close();
+            }
+            catch (...)
+            {
+            }
+            delete(pVideoWriter);
+            std::remove(_path.c_str());
+        }
+    }
+
+}
@@ -0,0 +1,57 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include "VideoIO/VideoWriter.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace kinect2recorder
+{
+
+    /* Opens the next VideoWriter and initializes its codecs in its own thread, so a segment is switched without a pause */
+    class WriterPreparer
+    {
+    private:
+        std::string _path;
+        video_io::Metadata _metadata;
+        std::vector<video_io::VideoWriter::VideoStreamParams> _params;
+        video_io::VideoWriter * _pVideoWriter;
+        int _failure;
+        int _failedStreamNumber;
+        bool _preparing;
+        std::atomic<bool> _ready;
+        std::thread _thread;
+        /* Muxer interleaving: a stalled stream holds the other one at most this long and this much */
+        const static int INTERLEAVE_MAX_DELAY_MS = 2000;
+        const static int INTERLEAVE_MAX_MEGABYTES = 32;
+        void ThreadFunction();
+    public:
+        const static int FAILED_NONE = 0;
+        const static int FAILED_OPEN = 1;
+        const static int FAILED_METADATA = 2;
+        const static int FAILED_ADD_VIDEO_STREAM = 3;
+        WriterPreparer();
+        ~WriterPreparer();
+        /* Opens a writer in the calling thread, nullptr if failed */
+        static video_io::VideoWriter * Open(const std::string& path, const video_io::Metadata& metadata,
+            const std::vector<video_io::VideoWriter::VideoStreamParams>& params, int& failure, int& failedStreamNumber);
+        void Prepare(const std::string& path, const video_io::Metadata& metadata,
+            const std::vector<video_io::VideoWriter::VideoStreamParams>& params);
+        /* Prepare() was called and the writer is not taken yet */
+        bool IsPreparing();
+        /* The thread has finished, Take() will not wait */
+        bool IsReady();
+        const std::string& GetPath();
+        /* Waits for the thread, nullptr if failed */
+        video_io::VideoWriter * Take(int& failure, int& failedStreamNumber);
+        /* Closes the prepared writer and removes its empty file */
+        void Discard();
+    };
+
+}
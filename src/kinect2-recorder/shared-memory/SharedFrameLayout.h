@@ -0,0 +1,77 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+namespace kinect2recorder
+{
+
+    /* Ring of the last frames of one stream in a named file mapping, shared by the recorder (the only writer)
+       and any number of readers in other processes. No locks: every slot is a seqlock.
+       Memory: SharedFrameRing, SLOT_NUMBER SharedFrameSlot, SLOT_NUMBER pixel blocks of slotBytes,
+       every part is aligned to ALIGNMENT */
+    struct SharedFrameRing
+    {
+        unsigned magic;
+        unsigned version;
+        int slotNumber;
+        int reserved;
+        long long slotBytes;
+        /* Sequence number of the last complete frame, -1 - nothing yet */
+        std::atomic<long long> lastSequence;
+        /* The recorder does not publish anymore, a reader closes and opens the ring again */
+        std::atomic<int> closed;
+    };
+
+    struct SharedFrameSlot
+    {
+        /* 2 * sequence + 1 while the slot is written, 2 * sequence + 2 when the frame is complete */
+        std::atomic<long long> state;
+        int width;
+        int height;
+        /* OpenCV type: CV_8UC4 BGRA (color), CV_16UC1 mm (depth) */
+        int type;
+        /* Bytes of a row */
+        int stride;
+        long long number;
+        /* Device time (us) */
+        long long timestamp;
+    };
+
+    class SharedFrameLayout
+    {
+    public:
+        const static unsigned MAGIC = 0x4B324652;
+        const static unsigned VERSION = 1;
+        const static int SLOT_NUMBER = 4;
+        const static size_t ALIGNMENT = 64;
+        static const char * GetName(bool depth)
+        {
+            return depth ? "Local\\Kinect2Recorder.Depth" : "Local\\Kinect2Recorder.Color";
+        }
+        static size_t Align(size_t bytes)
+        {
+            return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        }
+        static size_t GetMappingBytes(int slotNumber, size_t slotBytes)
+        {
+            return Align(sizeof(SharedFrameRing)) + slotNumber * Align(sizeof(SharedFrameSlot)) + slotNumber * Align(slotBytes);
+        }
+        static SharedFrameSlot * GetSlot(void * pView, int slot)
+        {
+            return reinterpret_cast<SharedFrameSlot *>(static_cast<unsigned char *>(pView) +
+                Align(sizeof(SharedFrameRing)) + slot * Align(sizeof(SharedFrameSlot)));
+        }
+        static unsigned char * GetPixels(void * pView, int slotNumber, size_t slotBytes, int slot)
+        {
+            return static_cast<unsigned char *>(pView) + Align(sizeof(SharedFrameRing)) +
+                slotNumber * Align(sizeof(SharedFrameSlot)) + slot * Align(slotBytes);
+        }
+    };
+
+}
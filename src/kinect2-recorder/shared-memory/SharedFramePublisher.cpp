@@ -0,0 +1,154 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "SharedFramePublisher.h"
+#include <Windows.h>
+#include <cstring>
+
+namespace kinect2recorder
+{
+
+    SharedFramePublisher::SharedFramePublisher(const std::string& name) :
+        _name(name),
+        _mapping(nullptr),
+        _pView(nullptr),
+        _slotBytes(0),
+        _sequence(-1),
+        _retryCountdown(0),
+        _failedNumber(0)
+    {
+    }
+
+    SharedFramePublisher::~SharedFramePublisher()
+    {
+        Close();
+    }
+
+    /* A mapping kept by readers after Close() is used again if it is large enough */
+    bool SharedFramePublisher::Open(size_t slotBytes)
+    {
+        const int slotNumber = SharedFrameLayout::SLOT_NUMBER;
+        unsigned long long mappingBytes = SharedFrameLayout::GetMappingBytes(slotNumber, slotBytes);
+        HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+            static_cast<DWORD>(mappingBytes >> 32), static_cast<DWORD>(mappingBytes & 0xFFFFFFFF), _name.c_str());
+        if (mapping == nullptr)
+        {
+            return false;
+        }
+        bool existing = GetLastError() == ERROR_ALREADY_EXISTS;
+        /* The whole object: an existing one may be larger */
+        void * pView = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+        if (pView == nullptr)
+        {
+            CloseHandle(mapping);
+            return false;
+        }
+        SharedFrameRing * pRing = static_cast<SharedFrameRing *>(pView);
+        if (existing && (pRing->magic != SharedFrameLayout::MAGIC || pRing->version != SharedFrameLayout::VERSION ||
+            pRing->slotNumber != slotNumber || pRing->slotBytes < static_cast<long long>(slotBytes)))
+        {
+            UnmapViewOfFile(pView);
+            CloseHandle(mapping);
+            return false;
+        }
+        if (existing)
+        {
+            slotBytes = static_cast<size_t>(pRing->slotBytes);
+            _sequence = pRing->lastSequence.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            pRing->magic = SharedFrameLayout::MAGIC;
+            pRing->version = SharedFrameLayout::VERSION;
+            pRing->slotNumber = slotNumber;
+            pRing->reserved = 0;
+            pRing->slotBytes = static_cast<long long>(slotBytes);
+            pRing->lastSequence.store(-1, std::memory_order_relaxed);
+            for (int i = 0; i < slotNumber; i++)
+            {
+                SharedFrameLayout::GetSlot(pView, i)->state.store(0, std::memory_order_relaxed);
+            }
+            _sequence = -1;
+        }
+        pRing->closed.store(0, std::memory_order_release);
+        _mapping = mapping;
+        _pView = pView;
+        _slotBytes = slotBytes;
+        return true;
+    }
+
+    void SharedFramePublisher::Close()
+    {
+        if (_pView != nullptr)
+        {
+            static_cast<SharedFrameRing *>(_pView)->closed.store(1, std::memory_order_release);
+            UnmapViewOfFile(_pView);
+            _pView = nullptr;
+        }
+        if (_mapping != nullptr)
+        {
+            CloseHandle(_mapping);
+            _mapping = nullptr;
+        }
+        _slotBytes = 0;
+        _retryCountdown = 0;
+    }
+
+    bool SharedFramePublisher::Publish(const cv::Mat& mat, long long number, long long timestamp)
+    {
+        size_t stride = mat.cols * mat.elemSize();
+        size_t bytes = stride * mat.rows;
+        if (_pView == nullptr || bytes > _slotBytes)
+        {
+            if (_retryCountdown > 0)
+            {
+                _retryCountdown--;
+                _failedNumber++;
+                return false;
+            }
+            Close();
+            if (!Open(bytes))
+            {
+                _retryCountdown = OPEN_RETRY_FRAMES;
+                _failedNumber++;
+                return false;
+            }
+        }
+        SharedFrameRing * pRing = static_cast<SharedFrameRing *>(_pView);
+        long long sequence = ++_sequence;
+        int slot = static_cast<int>(sequence % SharedFrameLayout::SLOT_NUMBER);
+        SharedFrameSlot * pSlot = SharedFrameLayout::GetSlot(_pView, slot);
+        pSlot->state.store(2 * sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        pSlot->width = mat.cols;
+        pSlot->height = mat.rows;
+        pSlot->type = mat.type();
+        pSlot->stride = static_cast<int>(stride);
+        pSlot->number = number;
+        pSlot->timestamp = timestamp;
+        unsigned char * pPixels = SharedFrameLayout::GetPixels(_pView, SharedFrameLayout::SLOT_NUMBER, _slotBytes, slot);
+        if (mat.isContinuous())
+        {
+            std::memcpy(pPixels, mat.data, bytes);
+        }
+        else
+        {
+            for (int row = 0; row < mat.rows; row++)
+            {
+                std::memcpy(pPixels + row * stride, mat.ptr(row), stride);
+            }
+        }
+        pSlot->state.store(2 * sequence + 2, std::memory_order_release);
+        pRing->lastSequence.store(sequence, std::memory_order_release);
+        return true;
+    }
+
+    long long SharedFramePublisher::TakeFailedNumber()
+    {
+        return _failedNumber.exchange(0);
+    }
+
+}
@@ -0,0 +1,42 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include "SharedFrameLayout.h"
+#include <opencv2/core/core.hpp>
+#include <atomic>
+#include <string>
+
+namespace kinect2recorder
+{
+
+    /* Writer of a SharedFrameRing. The mapping is created with the first frame and sized for it */
+    class SharedFramePublisher
+    {
+    private:
+        /* Frames between attempts to create the mapping again after a failure */
+        const static int OPEN_RETRY_FRAMES = 30;
+        std::string _name;
+        void * _mapping;
+        void * _pView;
+        size_t _slotBytes;
+        long long _sequence;
+        int _retryCountdown;
+        std::atomic<long long> _failedNumber;
+        bool Open(size_t slotBytes);
+    public:
+        explicit SharedFramePublisher(const std::string& name);
+        ~SharedFramePublisher();
+        /* false - the mapping can not be created (or a reader keeps an older, smaller one open),
+           it is tried again after OPEN_RETRY_FRAMES frames */
+        bool Publish(const cv::Mat& mat, long long number, long long timestamp);
+        /* Any thread: frames not published since the previous call */
+        long long TakeFailedNumber();
+        /* Readers see the ring closed */
+        void Close();
+    };
+
+}
@@ -0,0 +1,148 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "SharedFrameReader.h"
+#include <Windows.h>
+
+namespace kinect2recorder
+{
+
+    SharedFrameReader::SharedFrameReader(const std::string& name) :
+        _name(name),
+        _mapping(nullptr),
+        _pView(nullptr),
+        _lastSequence(-1)
+    {
+    }
+
+    SharedFrameReader::~SharedFrameReader()
+    {
+        Close();
+    }
+
+    bool SharedFrameReader::Open()
+    {
+        Close();
+        HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, _name.c_str());
+        if (mapping == nullptr)
+        {
+            return false;
+        }
+        void * pView = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (pView == nullptr)
+        {
+            CloseHandle(mapping);
+            return false;
+        }
+        const SharedFrameRing * pRing = static_cast<const SharedFrameRing *>(pView);
+        if (pRing->magic != SharedFrameLayout::MAGIC || pRing->version != SharedFrameLayout::VERSION ||
+            pRing->closed.load(std::memory_order_acquire) != 0)
+        {
+            UnmapViewOfFile(pView);
+            CloseHandle(mapping);
+            return false;
+        }
+        _mapping = mapping;
+        _pView = pView;
+        _lastSequence = -1;
+        return true;
+    }
+
+    void SharedFrameReader::Close()
+    {
+        if (_pView != nullptr)
+        {
+            UnmapViewOfFile(_pView);
+            _pView = nullptr;
+        }
+        if (_mapping != nullptr)
+        {
+            CloseHandle(_mapping);
+            _mapping = nullptr;
+        }
+    }
+
+    bool SharedFrameReader::IsOpen()
+    {
+        return _pView != nullptr;
+    }
+
+    bool SharedFrameReader::Acquire(SharedFrameView& view)
+    {
+        if (_pView == nullptr)
+        {
+            return false;
+        }
+        const SharedFrameRing * pRing = static_cast<const SharedFrameRing *>(_pView);
+        if (pRing->closed.load(std::memory_order_acquire) != 0)
+        {
+            Close();
+            return false;
+        }
+        long long sequence = pRing->lastSequence.load(std::memory_order_acquire);
+        if (sequence < 0 || sequence == _lastSequence)
+        {
+            return false;
+        }
+        int slot = static_cast<int>(sequence % pRing->slotNumber);
+        const SharedFrameSlot * pSlot = SharedFrameLayout::GetSlot(_pView, slot);
+        long long state = pSlot->state.load(std::memory_order_acquire);
+        if (state != 2 * sequence + 2)
+        {
+            /* Already overwritten by a newer frame, it is taken next time */
+            return false;
+        }
+        int width = pSlot->width;
+        int height = pSlot->height;
+        int type = pSlot->type;
+        int stride = pSlot->stride;
+        long long number = pSlot->number;
+        long long timestamp = pSlot->timestamp;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (pSlot->state.load(std::memory_order_relaxed) != state)
+        {
+            return false;
+        }
+        unsigned char * pPixels = SharedFrameLayout::GetPixels(_pView, pRing->slotNumber, static_cast<size_t>(pRing->slotBytes), slot);
+        view.mat = cv::Mat(height, width, type, pPixels, stride);
+        view.number = number;
+        view.timestamp = timestamp;
+        view.sequence = sequence;
+        view.missedNumber = _lastSequence >= 0 && sequence > _lastSequence ? sequence - _lastSequence - 1 : 0;
+        view.slot = slot;
+        _lastSequence = sequence;
+        return true;
+    }
+
+    bool SharedFrameReader::IsValid(const SharedFrameView& view)
+    {
+        if (_pView == nullptr)
+        {
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const SharedFrameSlot * pSlot = SharedFrameLayout::GetSlot(_pView, view.slot);
+        return pSlot->state.load(std::memory_order_relaxed) == 2 * view.sequence + 2;
+    }
+
+    bool SharedFrameReader::Read(cv::Mat& mat, long long& number, long long& timestamp)
+    {
+        SharedFrameView view;
+        if (!Acquire(view))
+        {
+            return false;
+        }
+        view.mat.copyTo(mat);
+        if (!IsValid(view))
+        {
+            return false;
+        }
+        number = view.number;
+        timestamp = view.timestamp;
+        return true;
+    }
+
+}
@@ -0,0 +1,54 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include "SharedFrameLayout.h"
+#include <opencv2/core/core.hpp>
+#include <string>
+
+namespace kinect2recorder
+{
+
+    /* A frame in the ring, mat points to the shared memory (no copy) */
+    struct SharedFrameView
+    {
+        cv::Mat mat;
+        long long number;
+        /* Device time (us) */
+        long long timestamp;
+        long long sequence;
+        /* Frames published since the previous view and not seen by the reader */
+        long long missedNumber;
+        int slot;
+    };
+
+    /* Client of a SharedFrameRing for other processes: needs only this class, SharedFrameLayout and OpenCV core.
+       The recorder overwrites a slot SLOT_NUMBER frames later, so a view is used at once
+       (or copied) and checked by IsValid() after use */
+    class SharedFrameReader
+    {
+    private:
+        std::string _name;
+        void * _mapping;
+        void * _pView;
+        long long _lastSequence;
+    public:
+        /* SharedFrameLayout::GetName(depth) */
+        explicit SharedFrameReader(const std::string& name);
+        ~SharedFrameReader();
+        /* false - the recorder does not publish the stream now */
+        bool Open();
+        void Close();
+        bool IsOpen();
+        /* The newest frame not seen yet, never waits. false - no new frame, or the ring is closed (IsOpen() is false then) */
+        bool Acquire(SharedFrameView& view);
+        /* The frame of the view has not been overwritten until now */
+        bool IsValid(const SharedFrameView& view);
+        /* Acquire, copy and check */
+        bool Read(cv::Mat& mat, long long& number, long long& timestamp);
+    };
+
+}
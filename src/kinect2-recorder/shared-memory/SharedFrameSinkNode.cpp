@@ -0,0 +1,83 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "SharedFrameSinkNode.h"
+#include <stdexcept>
+
+namespace kinect2recorder
+{
+
+    SharedFrameSinkNode::SharedFrameSinkNode(const std::vector<bool>& depths) :
+        _publishers(),
+        _enabled(false),
+        _published(false)
+    {
+        for (size_t i = 0; i < depths.size(); i++)
+        {
+            _publishers.push_back(new SharedFramePublisher(SharedFrameLayout::GetName(depths[i])));
+        }
+    }
+
+    SharedFrameSinkNode::~SharedFrameSinkNode()
+    {
+        for (size_t i = 0; i < _publishers.size(); i++)
+        {
+            delete(_publishers[i]);
+        }
+        _publishers.clear();
+    }
+
+    void SharedFrameSinkNode::SetEnabled(bool enabled)
+    {
+        _enabled.store(enabled);
+    }
+
+    bool SharedFrameSinkNode::IsActive()
+    {
+        return _enabled.load() || _published.load();
+    }
+
+    long long SharedFrameSinkNode::TakeFailedNumber()
+    {
+        long long failedNumber = 0;
+        for (size_t i = 0; i < _publishers.size(); i++)
+        {
+            failedNumber += _publishers[i]->TakeFailedNumber();
+        }
+        return failedNumber;
+    }
+
+    PipelineFramePtr SharedFrameSinkNode::Process(const PipelineFramePtr& pFrame)
+    {
+        if (!_enabled.load())
+        {
+            if (_published)
+            {
+                for (size_t i = 0; i < _publishers.size(); i++)
+                {
+                    _publishers[i]->Close();
+                }
+                _published = false;
+            }
+            return PipelineFramePtr();
+        }
+        _published = true;
+        bool failed = false;
+        for (size_t i = 0; i < _publishers.size() && i < pFrame->mats.size(); i++)
+        {
+            if (!pFrame->mats[i].empty() && !_publishers[i]->Publish(pFrame->mats[i], pFrame->number, pFrame->timestamp))
+            {
+                failed = true;
+            }
+        }
+        if (failed)
+        {
+            throw std::runtime_error("Shared memory ring can not be written");
+        }
+        return PipelineFramePtr();
+    }
+
+}
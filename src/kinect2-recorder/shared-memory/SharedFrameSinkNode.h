@@ -0,0 +1,37 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include "SharedFramePublisher.h"
+#include "../pipeline/PipelineNode.h"
+#include <atomic>
+#include <vector>
+
+namespace kinect2recorder
+{
+
+    /* Publishes every mode of the frames to its SharedFrameRing, see SharedFrameReader for the clients */
+    class SharedFrameSinkNode : public PipelineNode
+    {
+    private:
+        std::vector<SharedFramePublisher *> _publishers;
+        std::atomic<bool> _enabled;
+        std::atomic<bool> _published;
+    public:
+        /* depths - a depth mode for every mode number */
+        explicit SharedFrameSinkNode(const std::vector<bool>& depths);
+        ~SharedFrameSinkNode();
+        /* Any thread, the rings are closed with the next frame */
+        void SetEnabled(bool enabled);
+        /* Enabled, or disabled with the rings still open: it needs a frame */
+        bool IsActive();
+        /* Any thread: frames of all modes not published since the previous call */
+        long long TakeFailedNumber();
+        /* Throws std::runtime_error when a ring can not be written */
+        PipelineFramePtr Process(const PipelineFramePtr& pFrame);
+    };
+
+}
@@ -0,0 +1,247 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "FrameSubscribers.h"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <vector>
+
+namespace kinect2recorder
+{
+
+    FrameSubscribers::FrameSubscribers() :
+        _subscribers(),
+        _nextId(0),
+        _deliveredNumber(0),
+        _droppedNumber(0),
+        _failedNumber(0),
+        _detachedNumber(0),
+        _detachedCondition(),
+        _mutex()
+    {
+    }
+
+    FrameSubscribers::~FrameSubscribers()
+    {
+        UnsubscribeAll();
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (_detachedNumber > 0)
+        {
+            _detachedCondition.wait(lock);
+        }
+    }
+
+    int FrameSubscribers::Subscribe(int modeNumber, int mode, int format, int rate, size_t maxQueue, const FrameCallback& callback)
+    {
+        if (format < FORMAT_NATIVE || format > FORMAT_GRAY || rate < 0 || !callback)
+        {
+            return -1;
+        }
+        std::shared_ptr<Subscriber> pSubscriber = std::make_shared<Subscriber>();
+        pSubscriber->modeNumber = modeNumber;
+        pSubscriber->mode = mode;
+        pSubscriber->format = format;
+        pSubscriber->interval = rate > 0 ? 1000000LL / rate : 0;
+        pSubscriber->lastTimestamp = -1;
+        pSubscriber->callback = callback;
+        pSubscriber->maxQueue = maxQueue > 0 ? maxQueue : 1;
+        pSubscriber->running = true;
+        pSubscriber->detached = false;
+        std::lock_guard<std::mutex> lock(_mutex);
+        int id = _nextId++;
+        pSubscriber->thread = std::thread(&FrameSubscribers::ThreadFunction, this, pSubscriber);
+        _subscribers[id] = pSubscriber;
+        return id;
+    }
+
+    void FrameSubscribers::Unsubscribe(int id)
+    {
+        std::shared_ptr<Subscriber> pSubscriber;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::map<int, std::shared_ptr<Subscriber> >::iterator it = _subscribers.find(id);
+            if (it == _subscribers.end())
+            {
+                return;
+            }
+            pSubscriber = it->second;
+            _subscribers.erase(it);
+            pSubscriber->running = false;
+            pSubscriber->queue.clear();
+            if (pSubscriber->thread.get_id() == std::this_thread::get_id())
+            {
+                pSubscriber->detached = true;
+                _detachedNumber++;
+            }
+        }
+        pSubscriber->condition.notify_all();
+        if (pSubscriber->detached)
+        {
+            /* From the callback: the thread ends when the callback returns */
+            pSubscriber->thread.detach();
+        }
+        else
+        {
+            pSubscriber->thread.join();
+        }
+    }
+
+    void FrameSubscribers::UnsubscribeAll()
+    {
+        std::vector<int> ids;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (std::map<int, std::shared_ptr<Subscriber> >::iterator it = _subscribers.begin(); it != _subscribers.end(); ++it)
+            {
+                ids.push_back(it->first);
+            }
+        }
+        for (size_t i = 0; i < ids.size(); i++)
+        {
+            Unsubscribe(ids[i]);
+        }
+    }
+
+    bool FrameSubscribers::HasSubscribers()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return !_subscribers.empty();
+    }
+
+    /* Only frame handles are queued here, conversions are made in the subscriber threads */
+    PipelineFramePtr FrameSubscribers::Process(const PipelineFramePtr& pFrame)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (std::map<int, std::shared_ptr<Subscriber> >::iterator it = _subscribers.begin(); it != _subscribers.end(); ++it)
+        {
+            Subscriber& subscriber = *(it->second);
+            if (static_cast<size_t>(subscriber.modeNumber) >= pFrame->mats.size() || pFrame->mats[subscriber.modeNumber].empty())
+            {
+                continue;
+            }
+            if (subscriber.interval > 0 && subscriber.lastTimestamp >= 0 && pFrame->timestamp >= 0 &&
+                pFrame->timestamp - subscriber.lastTimestamp < subscriber.interval)
+            {
+                continue;
+            }
+            subscriber.lastTimestamp = pFrame->timestamp;
+            if (subscriber.queue.size() >= subscriber.maxQueue)
+            {
+                subscriber.queue.pop_front();
+                _droppedNumber++;
+            }
+            subscriber.queue.push_back(pFrame);
+            subscriber.condition.notify_one();
+        }
+        return PipelineFramePtr();
+    }
+
+    void FrameSubscribers::TakeStats(long long& deliveredNumber, long long& droppedNumber, long long& failedNumber)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        deliveredNumber = _deliveredNumber;
+        droppedNumber = _droppedNumber;
+        failedNumber = _failedNumber;
+        _deliveredNumber = 0;
+        _droppedNumber = 0;
+        _failedNumber = 0;
+    }
+
+    cv::Mat FrameSubscribers::Convert(const cv::Mat& mat, int format)
+    {
+        if (format == FORMAT_NATIVE)
+        {
+            return mat;
+        }
+        cv::Mat gray;
+        if (mat.type() == CV_16UC1)
+        {
+            cv::convertScaleAbs(mat, gray, 255.0 / MAX_DEPTH);
+        }
+        else if (format == FORMAT_BGR && mat.type() == CV_8UC3)
+        {
+            return mat;
+        }
+        else if (format == FORMAT_GRAY && mat.type() == CV_8UC1)
+        {
+            return mat;
+        }
+        else if (format == FORMAT_BGR && mat.type() == CV_8UC4)
+        {
+            cv::Mat bgr;
+            cv::cvtColor(mat, bgr, cv::COLOR_BGRA2BGR);
+            return bgr;
+        }
+        else if (mat.type() == CV_8UC3)
+        {
+            cv::cvtColor(mat, gray, cv::COLOR_BGR2GRAY);
+        }
+        else if (mat.type() == CV_8UC4)
+        {
+            cv::cvtColor(mat, gray, cv::COLOR_BGRA2GRAY);
+        }
+        else
+        {
+            gray = mat;
+        }
+        if (format == FORMAT_GRAY || gray.type() != CV_8UC1)
+        {
+            return gray;
+        }
+        cv::Mat bgr;
+        cv::cvtColor(gray, bgr, cv::COLOR_GRAY2BGR);
+        return bgr;
+    }
+
+    void FrameSubscribers::ThreadFunction(std::shared_ptr<Subscriber> pSubscriber)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (true)
+        {
+            while (pSubscriber->running && pSubscriber->queue.empty())
+            {
+                pSubscriber->condition.wait(lock);
+            }
+            if (!pSubscriber->running)
+            {
+                break;
+            }
+            PipelineFramePtr pFrame = pSubscriber->queue.front();
+            pSubscriber->queue.pop_front();
+            lock.unlock();
+            bool failed = false;
+            try
+            {
+                std::shared_ptr<SubscriberFrame> pSubscriberFrame = std::make_shared<SubscriberFrame>();
+                pSubscriberFrame->mat = Convert(pFrame->mats[pSubscriber->modeNumber], pSubscriber->format);
+                pSubscriberFrame->mode = pSubscriber->mode;
+                pSubscriberFrame->timestamp = pFrame->timestamp;
+                pSubscriberFrame->number = pFrame->number;
+                pFrame.reset();
+                pSubscriber->callback(pSubscriberFrame);
+            }
+            catch (...)
+            {
+                failed = true;
+            }
+            lock.lock();
+            if (failed)
+            {
+                _failedNumber++;
+            }
+            else
+            {
+                _deliveredNumber++;
+            }
+        }
+        /* The last use of this object by a detached thread, the mutex is released on return */
+        if (pSubscriber->detached)
+        {
+            _detachedNumber--;
+            _detachedCondition.notify_all();
+        }
+    }
+
+}
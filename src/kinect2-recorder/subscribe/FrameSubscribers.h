@@ -0,0 +1,77 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include "SubscriberFrame.h"
+#include "../pipeline/PipelineNode.h"
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace kinect2recorder
+{
+
+    /* Pipeline sink calling the subscriber callbacks. Every subscriber has its own thread and bounded queue
+       (the oldest frame is dropped when it is full), so a slow callback delays only its own frames */
+    class FrameSubscribers : public PipelineNode
+    {
+    public:
+        /* As acquired: color - CV_8UC4 BGRA, depth - CV_16UC1 mm. The frame is shared, no copy */
+        const static int FORMAT_NATIVE = 0;
+        /* CV_8UC3, depth is scaled to 0..MAX_DEPTH mm */
+        const static int FORMAT_BGR = 1;
+        /* CV_8UC1, depth is scaled to 0..MAX_DEPTH mm */
+        const static int FORMAT_GRAY = 2;
+        const static int MAX_DEPTH = 4500;
+    private:
+        struct Subscriber
+        {
+            int modeNumber;
+            int mode;
+            int format;
+            /* Device time between delivered frames (us), 0 - every frame */
+            long long interval;
+            long long lastTimestamp;
+            FrameCallback callback;
+            std::deque<PipelineFramePtr> queue;
+            size_t maxQueue;
+            bool running;
+            /* Unsubscribed from its own callback, the thread is detached and counted in _detachedNumber */
+            bool detached;
+            std::condition_variable condition;
+            std::thread thread;
+        };
+        std::map<int, std::shared_ptr<Subscriber> > _subscribers;
+        int _nextId;
+        long long _deliveredNumber;
+        long long _droppedNumber;
+        long long _failedNumber;
+        /* Detached threads still running, they use the mutex and the counters, the destructor waits for them */
+        int _detachedNumber;
+        std::condition_variable _detachedCondition;
+        std::mutex _mutex;
+        void ThreadFunction(std::shared_ptr<Subscriber> pSubscriber);
+        static cv::Mat Convert(const cv::Mat& mat, int format);
+    public:
+        FrameSubscribers();
+        /* Waits for the threads of all subscribers, not from a callback */
+        ~FrameSubscribers();
+        /* Any thread. rate - frames per second at most (0 - every frame), returns the subscription id, -1 - bad format */
+        int Subscribe(int modeNumber, int mode, int format, int rate, size_t maxQueue, const FrameCallback& callback);
+        /* Any thread, also the callback itself. The callback is not called after return (except from its own thread) */
+        void Unsubscribe(int id);
+        void UnsubscribeAll();
+        /* Any thread */
+        bool HasSubscribers();
+        PipelineFramePtr Process(const PipelineFramePtr& pFrame);
+        /* Counters since the previous call */
+        void TakeStats(long long& deliveredNumber, long long& droppedNumber, long long& failedNumber);
+    };
+
+}
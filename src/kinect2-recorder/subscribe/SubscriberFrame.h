@@ -0,0 +1,37 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include <opencv2/core/core.hpp>
+#include <functional>
+#include <memory>
+
+namespace kinect2recorder
+{
+
+    /* One stream of an acquired frame for a subscriber. The pixels may be shared with the recorder and other
+       subscribers, so the mat must not be written (clone it to change it) */
+    struct SubscriberFrame
+    {
+        cv::Mat mat;
+        /* Kinect2Recorder::MODE_COLOR or MODE_DEPTH */
+        int mode;
+        /* Device time (us) */
+        long long timestamp;
+        long long number;
+        SubscriberFrame() :
+            mat(),
+            mode(0),
+            timestamp(-1),
+            number(0)
+        {
+        }
+    };
+
+    typedef std::shared_ptr<const SubscriberFrame> SubscriberFramePtr;
+    typedef std::function<void(const SubscriberFramePtr&)> FrameCallback;
+
+}
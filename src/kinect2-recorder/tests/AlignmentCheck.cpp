@@ -0,0 +1,180 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+/* Alignment check of two '--synthetic' recordings started and stopped on the same device time ('start at',
+   'stop at', 'start frames'), e.g. by two processes: the frame number of the synthetic source is decoded from
+   every frame (depth - pixels (0, 0) and (0, 1), color - the 8x8 blocks), both files must hold the same frames
+   and color must start on the same frame as depth. Record with 'governor off', skipped color frames differ.
+   Usage: AlignmentCheck FILE1 FILE2, exit code 0 - aligned */
+
+#include "../mat-stream/SyntheticMatStream.h"
+#include "VideoIO/VideoReader.h"
+#include <opencv2/core/core.hpp>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+using kinect2recorder::SyntheticMatStream;
+
+const int STREAM_COLOR = 0;
+const int STREAM_DEPTH = 1;
+const int STREAM_NUMBER = 2;
+const char * const STREAM_NAMES[STREAM_NUMBER] = { "color", "depth" };
+
+/* Depth is lossless: the low and the high 16 bits as written */
+long long DecodeDepth(const cv::Mat& mat)
+{
+    if (mat.cols < 2)
+    {
+        return -1;
+    }
+    return static_cast<long long>(mat.at<unsigned short>(0, 0)) | (static_cast<long long>(mat.at<unsigned short>(0, 1)) << 16);
+}
+
+/* Color is lossy: the center of every block is compared with the middle gray */
+long long DecodeColor(const cv::Mat& mat)
+{
+    const int size = SyntheticMatStream::BIT_SIZE;
+    if (mat.cols < size * SyntheticMatStream::BIT_NUMBER || mat.rows < size || mat.channels() < 3)
+    {
+        return -1;
+    }
+    long long number = 0;
+    for (int i = 0; i < SyntheticMatStream::BIT_NUMBER; i++)
+    {
+        const unsigned char * pixel = mat.ptr<unsigned char>(size / 2) + (i * size + size / 2) * mat.channels();
+        if (pixel[0] + pixel[1] + pixel[2] > 3 * 127)
+        {
+            number |= 1LL << i;
+        }
+    }
+    return number;
+}
+
+/* Frame numbers of every stream in the file order, false when the file can not be read */
+bool ReadFrameNumbers(const std::string& path, std::vector<long long> frameNumbers[])
+{
+    try
+    {
+        video_io::VideoReader reader;
+        reader.open(path);
+        cv::Mat mat;
+        while (true)
+        {
+            int id = reader.read(mat);
+            if (id == video_io::STS_EAGAIN)
+            {
+                continue;
+            }
+            if (id < 0)
+            {
+                break;
+            }
+            if (mat.type() == CV_16UC1)
+            {
+                frameNumbers[STREAM_DEPTH].push_back(DecodeDepth(mat));
+            }
+            else
+            {
+                frameNumbers[STREAM_COLOR].push_back(DecodeColor(mat));
+            }
+        }
+        reader.close();
+    }
+    catch (std::exception& e)
+    {
+        std::printf("%s: %s\n", path.c_str(), e.what());
+        return false;
+    }
+    return true;
+}
+
+/* Returns the number of errors */
+int CheckFile(const std::string& path, std::vector<long long> frameNumbers[])
+{
+    int errorNumber = 0;
+    for (int i = 0; i < STREAM_NUMBER; i++)
+    {
+        const std::vector<long long>& numbers = frameNumbers[i];
+        if (numbers.empty())
+        {
+            continue;
+        }
+        std::printf("%s %s: %d frames, %lld..%lld\n", path.c_str(), STREAM_NAMES[i], static_cast<int>(numbers.size()),
+            numbers.front(), numbers.back());
+        for (size_t n = 1; n < numbers.size(); n++)
+        {
+            if (numbers[n] <= numbers[n - 1])
+            {
+                std::printf("%s %s: frame %d has number %lld after %lld\n", path.c_str(), STREAM_NAMES[i],
+                    static_cast<int>(n), numbers[n], numbers[n - 1]);
+                errorNumber++;
+            }
+        }
+    }
+    if (!frameNumbers[STREAM_COLOR].empty() && !frameNumbers[STREAM_DEPTH].empty() &&
+        frameNumbers[STREAM_COLOR].front() != frameNumbers[STREAM_DEPTH].front())
+    {
+        std::printf("%s: color starts on frame %lld, depth on %lld\n", path.c_str(), frameNumbers[STREAM_COLOR].front(),
+            frameNumbers[STREAM_DEPTH].front());
+        errorNumber++;
+    }
+    return errorNumber;
+}
+
+int main(int argc, char * argv[])
+{
+    if (argc < 3)
+    {
+        std::printf("Usage: AlignmentCheck FILE1 FILE2\n");
+        return 2;
+    }
+    std::vector<long long> frameNumbers[2][STREAM_NUMBER];
+    int errorNumber = 0;
+    for (int f = 0; f < 2; f++)
+    {
+        if (!ReadFrameNumbers(argv[f + 1], frameNumbers[f]))
+        {
+            return 1;
+        }
+        errorNumber += CheckFile(argv[f + 1], frameNumbers[f]);
+    }
+    for (int i = 0; i < STREAM_NUMBER; i++)
+    {
+        const std::vector<long long>& first = frameNumbers[0][i];
+        const std::vector<long long>& second = frameNumbers[1][i];
+        if (first.size() != second.size())
+        {
+            std::printf("%s: %d and %d frames\n", STREAM_NAMES[i], static_cast<int>(first.size()), static_cast<int>(second.size()));
+            errorNumber++;
+        }
+        int differentNumber = 0;
+        for (size_t n = 0; n < first.size() && n < second.size(); n++)
+        {
+            if (first[n] != second[n])
+            {
+                if (differentNumber == 0)
+                {
+                    std::printf("%s: frame %d is %lld and %lld\n", STREAM_NAMES[i], static_cast<int>(n), first[n], second[n]);
+                }
+                differentNumber++;
+            }
+        }
+        if (differentNumber > 0)
+        {
+            std::printf("%s: %d frames differ\n", STREAM_NAMES[i], differentNumber);
+            errorNumber++;
+        }
+    }
+    if (errorNumber > 0)
+    {
+        std::printf("NOT ALIGNED: %d errors\n", errorNumber);
+        return 1;
+    }
+    std::printf("ALIGNED\n");
+    return 0;
+}
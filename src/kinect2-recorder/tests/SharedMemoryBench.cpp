@@ -0,0 +1,151 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+/* Shared memory export cost: 1920x1080 BGRA frames are published at 30 fps to a SharedFrameRing, as the recorder
+   does it, while READERS threads take every new frame (copied, or only viewed with 'view' and checked by IsValid()).
+   The time of SharedFramePublisher::Publish() per frame is what the export adds to the recorder, it must stay under 1 ms.
+   Usage: SharedMemoryBench [READERS] [view] (4 readers by default), exit code 0 - under 1 ms on average */
+
+#include "../shared-memory/SharedFramePublisher.h"
+#include "../shared-memory/SharedFrameReader.h"
+#include <opencv2/core/core.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using kinect2recorder::SharedFramePublisher;
+using kinect2recorder::SharedFrameReader;
+using kinect2recorder::SharedFrameView;
+
+const char * const RING_NAME = "Local\\Kinect2Recorder.Bench";
+const int WIDTH = 1920;
+const int HEIGHT = 1080;
+const int FPS = 30;
+const int FRAME_NUMBER = 300;
+const int PATTERN_NUMBER = 8;
+const double MAX_PUBLISH_MS = 1.0;
+
+struct ReaderResult
+{
+    long long readNumber;
+    long long missedNumber;
+    long long invalidNumber;
+    ReaderResult() :
+        readNumber(0),
+        missedNumber(0),
+        invalidNumber(0)
+    {
+    }
+};
+
+void ReaderThreadFunction(std::atomic<bool> * pRunning, bool copy, ReaderResult * pResult)
+{
+    SharedFrameReader reader(RING_NAME);
+    SharedFrameView view;
+    cv::Mat mat;
+    while (pRunning->load())
+    {
+        if (!reader.IsOpen() && !reader.Open())
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        if (!reader.Acquire(view))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        if (copy)
+        {
+            view.mat.copyTo(mat);
+        }
+        if (!reader.IsValid(view))
+        {
+            pResult->invalidNumber++;
+            continue;
+        }
+        pResult->readNumber++;
+        pResult->missedNumber += view.missedNumber;
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    int readerNumber = argc > 1 ? std::atoi(argv[1]) : 4;
+    bool copy = !(argc > 2 && std::strcmp(argv[2], "view") == 0);
+    std::vector<cv::Mat> frames;
+    for (int i = 0; i < PATTERN_NUMBER; i++)
+    {
+        cv::Mat frame(HEIGHT, WIDTH, CV_8UC4);
+        cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(256));
+        frames.push_back(frame);
+    }
+    std::atomic<bool> running(true);
+    std::vector<ReaderResult> results(readerNumber);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < readerNumber; i++)
+    {
+        readers.push_back(std::thread(ReaderThreadFunction, &running, copy, &results[i]));
+    }
+    SharedFramePublisher publisher(RING_NAME);
+    std::vector<double> publishTimesMs;
+    int failedNumber = 0;
+    std::chrono::microseconds period(1000000 / FPS);
+    std::chrono::steady_clock::time_point frameTime = std::chrono::steady_clock::now();
+    for (int n = 0; n < FRAME_NUMBER; n++)
+    {
+        frameTime += period;
+        std::this_thread::sleep_until(frameTime);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool published = publisher.Publish(frames[n % PATTERN_NUMBER], n, n * period.count());
+        std::chrono::duration<double, std::milli> publishTime = std::chrono::steady_clock::now() - start;
+        if (!published)
+        {
+            failedNumber++;
+            continue;
+        }
+        publishTimesMs.push_back(publishTime.count());
+    }
+    publisher.Close();
+    running.store(false);
+    for (size_t i = 0; i < readers.size(); i++)
+    {
+        readers[i].join();
+    }
+    if (publishTimesMs.empty())
+    {
+        std::printf("No frame published, the ring can not be created\n");
+        return 1;
+    }
+    std::sort(publishTimesMs.begin(), publishTimesMs.end());
+    double sumMs = 0.0;
+    for (size_t i = 0; i < publishTimesMs.size(); i++)
+    {
+        sumMs += publishTimesMs[i];
+    }
+    double averageMs = sumMs / publishTimesMs.size();
+    std::printf("%dx%d BGRA, %d frames at %d fps, %d readers (%s)\n", WIDTH, HEIGHT, FRAME_NUMBER, FPS, readerNumber,
+        copy ? "copy" : "view");
+    std::printf("Publish: average %.3f ms, p99 %.3f ms, max %.3f ms, failed %d\n", averageMs,
+        publishTimesMs[publishTimesMs.size() * 99 / 100], publishTimesMs.back(), failedNumber);
+    for (int i = 0; i < readerNumber; i++)
+    {
+        std::printf("Reader %d: %lld frames, missed %lld, overwritten while read %lld\n", i, results[i].readNumber,
+            results[i].missedNumber, results[i].invalidNumber);
+    }
+    if (failedNumber > 0 || averageMs >= MAX_PUBLISH_MS)
+    {
+        std::printf("FAILED: publishing takes %.3f ms on average, limit %.1f ms\n", averageMs, MAX_PUBLISH_MS);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,140 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "ThreadBudget.h"
+#include <algorithm>
+#include <cmath>
+
+namespace kinect2recorder
+{
+
+    ThreadBudget::ThreadBudget(int keyNumber) :
+        _threadNumber(0),
+        _costs(keyNumber, -1.0),
+        _shares()
+    {
+    }
+
+    void ThreadBudget::SetThreadNumber(int threadNumber)
+    {
+        _threadNumber = threadNumber;
+    }
+
+    int ThreadBudget::GetThreadNumber()
+    {
+        return _threadNumber;
+    }
+
+    void ThreadBudget::Report(int key, double frameTimeMs, int threadNumber)
+    {
+        if (frameTimeMs <= 0 || threadNumber <= 0)
+        {
+            return;
+        }
+        double cost = frameTimeMs * threadNumber;
+        if (_costs[key] < 0)
+        {
+            _costs[key] = cost;
+        }
+        else
+        {
+            _costs[key] += COST_ALPHA * (cost - _costs[key]);
+        }
+    }
+
+    std::vector<int> ThreadBudget::Allocate(const std::vector<int>& keys, const std::vector<double>& pixelNumbers)
+    {
+        std::vector<int> threadNumbers(keys.size(), -1);
+        _shares.clear();
+        if (_threadNumber <= 0 || keys.empty())
+        {
+            return threadNumbers;
+        }
+        /* Measured and estimated costs are not comparable, the estimate is used for all until all are measured */
+        _shares = GetShares(keys);
+        bool measured = !_shares.empty();
+        std::vector<double> costs(keys.size());
+        double costSum = 0.0;
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            costs[i] = measured ? _costs[keys[i]] : std::max(1.0, pixelNumbers[i]);
+            costSum += costs[i];
+        }
+        /* Every stream gets at least one thread, the rest goes by the largest remainders */
+        int freeNumber = _threadNumber - static_cast<int>(keys.size());
+        std::vector<double> remainders(keys.size());
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            double share = freeNumber > 0 ? freeNumber * costs[i] / costSum : 0.0;
+            threadNumbers[i] = 1 + static_cast<int>(share);
+            remainders[i] = share - static_cast<int>(share);
+        }
+        int allocatedNumber = 0;
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            allocatedNumber += threadNumbers[i];
+        }
+        while (allocatedNumber < _threadNumber)
+        {
+            size_t best = static_cast<size_t>(std::max_element(remainders.begin(), remainders.end()) - remainders.begin());
+            threadNumbers[best]++;
+            remainders[best] = -1.0;
+            allocatedNumber++;
+        }
+        return threadNumbers;
+    }
+
+    bool ThreadBudget::IsStale(const std::vector<int>& keys)
+    {
+        if (_threadNumber <= 0 || keys.size() < 2)
+        {
+            return false;
+        }
+        std::vector<double> shares = GetShares(keys);
+        if (shares.empty())
+        {
+            return false;
+        }
+        if (_shares.size() != shares.size())
+        {
+            return true;
+        }
+        for (size_t i = 0; i < shares.size(); i++)
+        {
+            if (std::abs(shares[i] - _shares[i]) > STALE_SHARE)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /* Empty when a key is not measured */
+    std::vector<double> ThreadBudget::GetShares(const std::vector<int>& keys)
+    {
+        std::vector<double> shares;
+        double costSum = 0.0;
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if (_costs[keys[i]] <= 0)
+            {
+                return std::vector<double>();
+            }
+            costSum += _costs[keys[i]];
+        }
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            shares.push_back(_costs[keys[i]] / costSum);
+        }
+        return shares;
+    }
+
+    double ThreadBudget::GetCost(int key)
+    {
+        return _costs[key];
+    }
+
+}
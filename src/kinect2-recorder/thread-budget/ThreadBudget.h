@@ -0,0 +1,43 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include <vector>
+
+namespace kinect2recorder
+{
+
+    /* Splits a number of codec threads between streams by their measured cost (encode time of one frame x threads),
+       streams without a measurement are estimated by their pixel number. The split is taken when a file is opened
+       (a codec can not change its threads), IsStale tells when the costs moved away from it */
+    class ThreadBudget
+    {
+    private:
+        const double COST_ALPHA = 0.05;
+        /* Change of the cost share of a stream that makes the split stale */
+        const double STALE_SHARE = 0.1;
+        int _threadNumber;
+        std::vector<double> _costs;
+        /* Cost shares of the last split, empty - the split was estimated */
+        std::vector<double> _shares;
+        std::vector<double> GetShares(const std::vector<int>& keys);
+    public:
+        /* keyNumber - number of streams kinds (recorder modes) */
+        ThreadBudget(int keyNumber);
+        /* 0 - off, every codec uses the VideoIO default */
+        void SetThreadNumber(int threadNumber);
+        int GetThreadNumber();
+        void Report(int key, double frameTimeMs, int threadNumber);
+        /* Thread number of every key, -1 when the budget is off */
+        std::vector<int> Allocate(const std::vector<int>& keys, const std::vector<double>& pixelNumbers);
+        /* All keys are measured and the split from the measurement differs from the last one (it was estimated
+           or a cost share moved by more than STALE_SHARE) */
+        bool IsStale(const std::vector<int>& keys);
+        /* Thread time (ms) of one frame, -1 - not measured */
+        double GetCost(int key);
+    };
+
+}
@@ -0,0 +1,114 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "ThreadPlacement.h"
+#include <Windows.h>
+#include <vector>
+
+namespace kinect2recorder
+{
+
+    namespace
+    {
+        /* Windows 10 and later, looked up at run time so the recorder still starts on older systems */
+        typedef BOOL (WINAPI * GetSystemCpuSetInformationFunction)(PSYSTEM_CPU_SET_INFORMATION, ULONG, PULONG, HANDLE, ULONG);
+        typedef BOOL (WINAPI * SetProcessDefaultCpuSetsFunction)(HANDLE, const ULONG *, ULONG);
+        typedef BOOL (WINAPI * SetThreadSelectedCpuSetsFunction)(HANDLE, const ULONG *, ULONG);
+
+        bool IsolateCurrentThread(int core)
+        {
+            HMODULE kernel = GetModuleHandleW(L"kernel32.dll");
+            if (kernel == nullptr)
+            {
+                return false;
+            }
+            GetSystemCpuSetInformationFunction getSystemCpuSetInformation =
+                reinterpret_cast<GetSystemCpuSetInformationFunction>(GetProcAddress(kernel, "GetSystemCpuSetInformation"));
+            SetProcessDefaultCpuSetsFunction setProcessDefaultCpuSets =
+                reinterpret_cast<SetProcessDefaultCpuSetsFunction>(GetProcAddress(kernel, "SetProcessDefaultCpuSets"));
+            SetThreadSelectedCpuSetsFunction setThreadSelectedCpuSets =
+                reinterpret_cast<SetThreadSelectedCpuSetsFunction>(GetProcAddress(kernel, "SetThreadSelectedCpuSets"));
+            if (getSystemCpuSetInformation == nullptr || setProcessDefaultCpuSets == nullptr || setThreadSelectedCpuSets == nullptr)
+            {
+                return false;
+            }
+            ULONG length = 0;
+            getSystemCpuSetInformation(nullptr, 0, &length, GetCurrentProcess(), 0);
+            if (length == 0)
+            {
+                return false;
+            }
+            std::vector<char> buffer(length);
+            if (!getSystemCpuSetInformation(reinterpret_cast<PSYSTEM_CPU_SET_INFORMATION>(buffer.data()), length, &length, GetCurrentProcess(), 0))
+            {
+                return false;
+            }
+            std::vector<ULONG> ownIds;
+            std::vector<ULONG> otherIds;
+            for (ULONG offset = 0; offset < length; )
+            {
+                PSYSTEM_CPU_SET_INFORMATION pInformation = reinterpret_cast<PSYSTEM_CPU_SET_INFORMATION>(buffer.data() + offset);
+                if (pInformation->Type == CpuSetInformation)
+                {
+                    if (static_cast<int>(pInformation->CpuSet.LogicalProcessorIndex) == core)
+                    {
+                        ownIds.push_back(pInformation->CpuSet.Id);
+                    }
+                    else
+                    {
+                        otherIds.push_back(pInformation->CpuSet.Id);
+                    }
+                }
+                offset += pInformation->Size;
+            }
+            if (ownIds.empty() || otherIds.empty())
+            {
+                return false;
+            }
+            return setThreadSelectedCpuSets(GetCurrentThread(), ownIds.data(), static_cast<ULONG>(ownIds.size())) &&
+                setProcessDefaultCpuSets(GetCurrentProcess(), otherIds.data(), static_cast<ULONG>(otherIds.size()));
+        }
+    }
+
+    int ThreadPlacement::GetCoreNumber()
+    {
+        SYSTEM_INFO systemInfo;
+        GetSystemInfo(&systemInfo);
+        return static_cast<int>(systemInfo.dwNumberOfProcessors);
+    }
+
+    int ThreadPlacement::PlaceCurrentThread(int core, bool highPriority)
+    {
+        int placement = PLACEMENT_PINNED;
+        if (core >= 0)
+        {
+            if (core >= GetCoreNumber() || core >= static_cast<int>(sizeof(DWORD_PTR) * 8))
+            {
+                return PLACEMENT_FAILED;
+            }
+            if (IsolateCurrentThread(core))
+            {
+                placement = PLACEMENT_ISOLATED;
+            }
+            else if (SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << core) == 0)
+            {
+                return PLACEMENT_FAILED;
+            }
+        }
+        /* Not TIME_CRITICAL: the loop polls Kinect2 without sleeping and must not starve the system on a shared core */
+        if (highPriority && !SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST))
+        {
+            return PLACEMENT_FAILED;
+        }
+        return placement;
+    }
+
+    bool ThreadPlacement::LowerCurrentThreadPriority()
+    {
+        return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL) != 0;
+    }
+
+}
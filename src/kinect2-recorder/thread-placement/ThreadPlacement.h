@@ -0,0 +1,29 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+
+namespace kinect2recorder
+{
+
+    /* Puts the calling thread on its own logical core. With Windows 10 CPU sets every other thread of the process
+       (codecs, encode queue, finalizer, preview, OpenCV) is kept on the remaining cores, threads created later too;
+       without them only the calling thread is pinned */
+    class ThreadPlacement
+    {
+    public:
+        const static int PLACEMENT_FAILED = 0;
+        const static int PLACEMENT_PINNED = 1;
+        /* The other threads are confined to the remaining cores */
+        const static int PLACEMENT_ISOLATED = 2;
+        /* core < 0 - no pinning, priority only */
+        static int PlaceCurrentThread(int core, bool highPriority);
+        /* Background work (proxy encoding) that must not delay the recording threads */
+        static bool LowerCurrentThreadPriority();
+        static int GetCoreNumber();
+    };
+
+}
@@ -0,0 +1,198 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#include "TimeLapseAccumulator.h"
+#include <algorithm>
+#include <climits>
+
+namespace kinect2recorder
+{
+
+    namespace
+    {
+
+        /* Integer sums are exact while factor full-scale values fit in int: always for 8 bits, factor < 32768 for 16 bits */
+        int SumDepth(int depth, int factor)
+        {
+            double maxValue = depth == CV_8U ? 255.0 : (depth == CV_16U ? 65535.0 : -1.0);
+            return maxValue > 0 && maxValue * factor <= INT_MAX ? CV_32S : CV_64F;
+        }
+
+        /* window - sorted per element, validCounts - nonzero samples per element, the zeros are sorted first */
+        template<typename T>
+        void SelectValidMedian(const std::vector<cv::Mat>& window, int count, const cv::Mat& validCounts, cv::Mat& result)
+        {
+            std::vector<const T*> rows(count);
+            for (int y = 0; y < result.rows; y++)
+            {
+                for (int k = 0; k < count; k++)
+                {
+                    rows[k] = window[k].ptr<T>(y);
+                }
+                const int * valid = validCounts.ptr<int>(y);
+                T * dst = result.ptr<T>(y);
+                for (int x = 0; x < result.cols; x++)
+                {
+                    /* No valid samples: the last sorted one is zero as well */
+                    int index = std::min(count - valid[x] + valid[x] / 2, count - 1);
+                    dst[x] = rows[index][x];
+                }
+            }
+        }
+
+    }
+
+    TimeLapseAccumulator::TimeLapseAccumulator(int factor, int method, bool ignoreZeros) :
+        _factor(factor > 0 ? factor : 1),
+        _method(method),
+        _ignoreZeros(ignoreZeros),
+        _count(0),
+        _sum(),
+        _weights(),
+        _mask(),
+        _insert(),
+        _window()
+    {
+    }
+
+    TimeLapseAccumulator::~TimeLapseAccumulator()
+    {
+    }
+
+    void TimeLapseAccumulator::AddMean(const cv::Mat& mat)
+    {
+        int sumDepth = SumDepth(mat.depth(), _factor);
+        if (_sum.size() != mat.size() || _sum.channels() != mat.channels() || _sum.depth() != sumDepth)
+        {
+            _sum = cv::Mat::zeros(mat.size(), CV_MAKETYPE(sumDepth, mat.channels()));
+            _weights = cv::Mat::zeros(mat.size(), CV_32SC1);
+        }
+        /* cv::add is vectorized by OpenCV */
+        if (_ignoreZeros && mat.channels() == 1)
+        {
+            cv::compare(mat, cv::Scalar(0), _mask, cv::CMP_NE);
+            cv::add(_sum, mat, _sum, _mask, sumDepth);
+            cv::add(_weights, cv::Scalar(1), _weights, _mask);
+        }
+        else
+        {
+            cv::add(_sum, mat, _sum, cv::Mat(), sumDepth);
+        }
+    }
+
+    void TimeLapseAccumulator::GetMean(cv::Mat& result, int type)
+    {
+        /* Divided in double and rounded once, by the final conversion */
+        cv::Mat mean;
+        if (_ignoreZeros && _sum.channels() == 1)
+        {
+            /* Where no valid samples were seen the sum is zero as well */
+            cv::max(_weights, cv::Scalar(1), _weights);
+            cv::divide(_sum, _weights, mean, 1.0, CV_64F);
+        }
+        else
+        {
+            _sum.convertTo(mean, CV_64F, 1.0 / _count);
+        }
+        mean.convertTo(result, type);
+    }
+
+    /* The new frame sinks through the frames sorted per element so far: count cv::min and cv::max per frame,
+       vectorized by OpenCV, instead of sorting every element of the window at its end */
+    void TimeLapseAccumulator::AddMedian(const cv::Mat& mat)
+    {
+        if ((int)_window.size() < _factor)
+        {
+            _window.resize(_factor);
+        }
+        mat.copyTo(_insert);
+        for (int k = _count; k > 0; k--)
+        {
+            cv::max(_window[k - 1], _insert, _window[k]);
+            cv::min(_window[k - 1], _insert, _insert);
+        }
+        std::swap(_window[0], _insert);
+        if (_ignoreZeros && mat.channels() == 1)
+        {
+            if (_weights.size() != mat.size())
+            {
+                _weights = cv::Mat::zeros(mat.size(), CV_32SC1);
+            }
+            cv::compare(mat, cv::Scalar(0), _mask, cv::CMP_NE);
+            cv::add(_weights, cv::Scalar(1), _weights, _mask);
+        }
+    }
+
+    void TimeLapseAccumulator::GetMedian(cv::Mat& result)
+    {
+        if (!_ignoreZeros || _window[0].channels() != 1)
+        {
+            _window[_count / 2].copyTo(result);
+            return;
+        }
+        result.create(_window[0].size(), _window[0].type());
+        switch (result.depth())
+        {
+        case CV_8U:
+            SelectValidMedian<unsigned char>(_window, _count, _weights, result);
+            break;
+        case CV_16U:
+            SelectValidMedian<unsigned short>(_window, _count, _weights, result);
+            break;
+        default:
+            _window[_count / 2].copyTo(result);
+            break;
+        }
+    }
+
+    bool TimeLapseAccumulator::Add(const cv::Mat& mat, cv::Mat& result)
+    {
+        switch (_method)
+        {
+        case METHOD_MEAN:
+            AddMean(mat);
+            break;
+        case METHOD_MEDIAN:
+            AddMedian(mat);
+            break;
+        default:
+            break;
+        }
+        _count++;
+        if (_count < _factor)
+        {
+            return false;
+        }
+        switch (_method)
+        {
+        case METHOD_MEAN:
+            GetMean(result, mat.type());
+            break;
+        case METHOD_MEDIAN:
+            GetMedian(result);
+            break;
+        default:
+            result = mat;
+            break;
+        }
+        Reset();
+        return true;
+    }
+
+    void TimeLapseAccumulator::Reset()
+    {
+        _count = 0;
+        if (!_sum.empty())
+        {
+            _sum.setTo(cv::Scalar::all(0));
+        }
+        if (!_weights.empty())
+        {
+            _weights.setTo(cv::Scalar::all(0));
+        }
+    }
+
+}
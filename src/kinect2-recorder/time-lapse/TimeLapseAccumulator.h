@@ -0,0 +1,44 @@
+/*
+* Copyright (c) 2017 Alexander Menkin
+* Use of this source code is governed by an MIT-style license that can be found in the LICENSE file at
+* https://github.com/miloiloloo/diploma_2017_kinect2_recorder
+*/
+
+#pragma once
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+namespace kinect2recorder
+{
+
+    /* Reduces every window of factor frames to one output frame */
+    class TimeLapseAccumulator
+    {
+    private:
+        int _factor;
+        int _method;
+        bool _ignoreZeros;
+        int _count;
+        cv::Mat _sum;
+        cv::Mat _weights;
+        cv::Mat _mask;
+        cv::Mat _insert;
+        /* Median: the frames of the window sorted per element */
+        std::vector<cv::Mat> _window;
+        void AddMean(const cv::Mat& mat);
+        void GetMean(cv::Mat& result, int type);
+        void AddMedian(const cv::Mat& mat);
+        void GetMedian(cv::Mat& result);
+    public:
+        const static int METHOD_NTH = 0;
+        const static int METHOD_MEAN = 1;
+        const static int METHOD_MEDIAN = 2;
+        /* ignoreZeros: zero elements are invalid (depth) and are excluded from mean and median */
+        TimeLapseAccumulator(int factor, int method, bool ignoreZeros);
+        ~TimeLapseAccumulator();
+        /* Returns true when the window is complete and result is set */
+        bool Add(const cv::Mat& mat, cv::Mat& result);
+        void Reset();
+    };
+
+}
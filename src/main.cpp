@@ -7,7 +7,11 @@
 #include "console-layer/ConsoleController.h"
 #include "console-layer/ConsoleLogger.h"
 #include "kinect2-recorder/Kinect2Recorder.h"
+#include <atomic>
+#include <cstring>
+#include <string>
 #include <thread>
+#include <vector>
 
 /* To read console */
 void ConsoleReaderThreadFunction(ConsoleController * pConsoleController)
@@ -24,11 +28,71 @@ void ConsoleReaderThreadFunction(ConsoleController * pConsoleController)
     }
 }
 
-int main()
+/* Synthetic CPU contention: spins until the recorder ends */
+void ContentionThreadFunction(std::atomic<bool> * pRunning)
 {
-    Kinect2Recorder * kinect2Recorder = new Kinect2Recorder(ConsoleLogger());
+    volatile unsigned long long counter = 0;
+    while (pRunning->load(std::memory_order_relaxed))
+    {
+        counter++;
+    }
+}
+
+/* --synthetic - record generated frames with frame numbers in the images, no Kinect2 needed
+   --headless - no preview windows at startup ('preview on' opens them)
+   --acquisition-core N - the recording loop gets core N, the other threads get the remaining cores
+   --high-priority - higher priority of the recording loop thread
+   --contention N - N busy threads, to compare the wakeup latency ('stats') with and without the options above */
+int main(int argc, char * argv[])
+{
+    bool synthetic = false;
+    bool headless = false;
+    int acquisitionCore = -1;
+    bool highPriority = false;
+    int contentionThreadNumber = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        try
+        {
+            if (std::strcmp(argv[i], "--synthetic") == 0)
+            {
+                synthetic = true;
+            }
+            else if (std::strcmp(argv[i], "--headless") == 0)
+            {
+                headless = true;
+            }
+            else if (std::strcmp(argv[i], "--acquisition-core") == 0 && i + 1 < argc)
+            {
+                acquisitionCore = std::stoi(argv[++i]);
+            }
+            else if (std::strcmp(argv[i], "--high-priority") == 0)
+            {
+                highPriority = true;
+            }
+            else if (std::strcmp(argv[i], "--contention") == 0 && i + 1 < argc)
+            {
+                contentionThreadNumber = std::stoi(argv[++i]);
+            }
+        }
+        catch(...)
+        {
+        }
+    }
+    ConsoleLogger logger;
+    Kinect2Recorder * kinect2Recorder = new Kinect2Recorder(logger, synthetic, headless);
     ConsoleController * cc = new ConsoleController(kinect2Recorder);
     std::thread thr(ConsoleReaderThreadFunction, cc);
+    if (acquisitionCore >= 0 || highPriority)
+    {
+        kinect2Recorder->SetAcquisitionThread(acquisitionCore, highPriority);
+    }
+    std::atomic<bool> contentionRunning(true);
+    std::vector<std::thread> contentionThreads;
+    for (int i = 0; i < contentionThreadNumber; i++)
+    {
+        contentionThreads.push_back(std::thread(ContentionThreadFunction, &contentionRunning));
+    }
     kinect2Recorder->SetSize(Kinect2Recorder::MODE_COLOR, 960, 540);
     kinect2Recorder->SetSize(Kinect2Recorder::MODE_DEPTH, 512, 424);
     try
@@ -48,6 +112,11 @@ int main()
         {
         }
     }
+    contentionRunning.store(false, std::memory_order_relaxed);
+    for (size_t i = 0; i < contentionThreads.size(); i++)
+    {
+        contentionThreads[i].join();
+    }
     thr.join();
     delete(cc);
     delete(kinect2Recorder);